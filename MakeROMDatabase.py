@@ -0,0 +1,77 @@
+# Builds Source/NES/ROMDatabaseData.hpp from the NES 2.0 XML database (nes20db.xml), for correcting iNES 1.0 headers.
+# Usage: python MakeROMDatabase.py <nes20db.xml>
+# Record layout is described in Source/NES/ROMDatabase.cpp.
+import os
+import struct
+import sys
+import xml.etree.ElementTree as ElementTree
+
+def RAMShift(element):
+    if element is None:
+        return 0
+    size = int(element.get('size', '0'))
+    if size == 0:
+        return 0
+    shift = max((size - 1).bit_length() - 6, 1)
+    assert shift < 16, 'RAM size %d too large' % size
+    return shift
+
+def Mirroring(pcb):
+    # NES 2.0 database mirroring: H/V from the solder pads, 4 for four screen, anything else is mapper controlled.
+    return { 'H': 0, 'V': 1, '4': 2 }.get(pcb.get('mirroring', ''), 3)
+
+def Record(game):
+    rom = game.find('rom')
+    pcb = game.find('pcb')
+    prgrom = game.find('prgrom')
+    chrrom = game.find('chrrom')
+    console = game.find('console')
+    if rom is None or pcb is None or prgrom is None:
+        return None
+
+    prg_size = int(prgrom.get('size'))
+    chr_size = int(chrrom.get('size')) if chrrom is not None else 0
+    if prg_size % 0x4000 or chr_size % 0x2000:
+        return None
+
+    mapper = int(pcb.get('mapper', '0'))
+    submapper = int(pcb.get('submapper', '0'))
+    if mapper > 0xFFF or submapper > 0xF:
+        return None
+
+    flags = Mirroring(pcb) | (4 if pcb.get('battery', '0') == '1' else 0)
+    if console is not None:
+        flags |= (int(console.get('region', '0')) & 3) << 4
+
+    prg_ram = RAMShift(game.find('prgram')) | (RAMShift(game.find('prgnvram')) << 4)
+    chr_ram = RAMShift(game.find('chrram')) | (RAMShift(game.find('chrnvram')) << 4)
+
+    return struct.pack('<IHHHBBB3x', int(rom.get('crc32'), 16), prg_size // 0x4000, chr_size // 0x2000, mapper | (submapper << 12), flags, prg_ram, chr_ram)
+
+def Main():
+    if len(sys.argv) != 2:
+        print('Usage: python MakeROMDatabase.py <nes20db.xml>')
+        sys.exit(1)
+
+    records = set()
+    for game in ElementTree.parse(sys.argv[1]).getroot().iter('game'):
+        record = Record(game)
+        if record:
+            records.add(record)
+
+    # Sorted by CRC32 (the first four bytes, little endian), which is what the lookup's binary search relies on.
+    blob = b''.join(sorted(records, key = lambda record: (struct.unpack_from('<I', record)[0], record)))
+
+    output = os.path.normpath(os.path.join(__file__, '../Source/NES/ROMDatabaseData.hpp'))
+    with open(output, 'w', newline = '\n') as file:
+        file.write(open(os.path.normpath(os.path.join(__file__, '../Source/NES/ROMDatabase.hpp'))).read().split('*/', 1)[0] + '*/\n\n')
+        file.write('/* Generated by MakeROMDatabase.py, don\'t edit by hand. %d ROMs. */\n\n' % (len(blob) // 16))
+        file.write('#ifndef __ROM_DATABASE_DATA_HPP__\n#define __ROM_DATABASE_DATA_HPP__\n\n#include <array>\n#include <cstdint>\n\n')
+        file.write('inline constexpr std::array<uint8_t, %d> rom_database_blob = {\n' % len(blob))
+        for offset in range(0, len(blob), 16):
+            file.write('\t' + ', '.join('0x%02X' % byte for byte in blob[offset:offset + 16]) + ',\n')
+        file.write('};\n\n#endif /* __ROM_DATABASE_DATA_HPP__ */')
+
+    print('Wrote %d ROMs to %s' % (len(blob) // 16, output))
+
+Main()
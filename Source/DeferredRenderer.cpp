@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "DeferredRenderer.hpp"
+
+DeferredRenderer::DeferredRenderer(PPU* ppu, unsigned thread_count) : ppu(ppu),
+	worker_pool(thread_count ? thread_count : std::max(std::thread::hardware_concurrency(), 2u) - 1) {
+
+	render_thread = std::thread(&DeferredRenderer::RenderLoop, this);
+}
+
+DeferredRenderer::~DeferredRenderer() {
+
+	ppu->SetFrameRecord(nullptr);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	frame_ready.notify_one();
+	render_thread.join();
+}
+
+void DeferredRenderer::BeginFrame(bool record) {
+
+	if(has_recorded) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			drawing = &records[recording];
+			drawn = false;
+		}
+
+		frame_ready.notify_one();
+
+		recording ^= 1;
+		has_recorded = false;
+	}
+
+	ppu->SetFrameRecord(record ? &records[recording] : nullptr);
+	is_recording = record;
+}
+
+bool DeferredRenderer::EndFrame() {
+
+	/* The record is complete once the frame has run, stop the PPU writing to it before it is handed over. */
+	ppu->SetFrameRecord(nullptr);
+	has_recorded = is_recording && records[recording].recorded.any();
+	is_recording = false;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if(drawing == nullptr) {
+		return false;
+	}
+
+	frame_done.wait(lock, [this] { return drawn; });
+
+	std::bitset<PPU::ScreenHeight> changed;
+
+	for(uint16_t line = 0; line < PPU::ScreenHeight; line++) {
+		changed[line] = changed_lines[line];
+	}
+
+	ppu->FinishRecordedFrame(changed);
+	frame_number = drawing->frame_number;
+	drawing = nullptr;
+
+	return true;
+}
+
+bool DeferredRenderer::Flush() {
+
+	BeginFrame(false);
+	return EndFrame();
+}
+
+void DeferredRenderer::RenderLoop() {
+
+	while(true) {
+		frame_record_t* record;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			frame_ready.wait(lock, [this] { return stopping || (drawing != nullptr && !drawn); });
+
+			if(stopping) {
+				return;
+			}
+
+			record = drawing;
+		}
+
+		const size_t bands = (PPU::ScreenHeight + LinesPerBand - 1) / LinesPerBand;
+
+		worker_pool.Run(bands, [&](size_t band) {
+			const uint16_t first = band * LinesPerBand;
+			const uint16_t last = std::min<uint16_t>(first + LinesPerBand, PPU::ScreenHeight);
+
+			for(uint16_t line = first; line < last; line++) {
+				changed_lines[line] = record->recorded.test(line) && ppu->RasterizeScanline(record->lines[line]);
+			}
+		});
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			drawn = true;
+		}
+
+		frame_done.notify_one();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,97 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __DEFERRED_RENDERER_HPP__
+#define __DEFERRED_RENDERER_HPP__
+
+#include <bitset>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "NES/PPU.hpp"
+#include "WorkerPool.hpp"
+
+/**
+ * Pipelined frame rendering: while the CPU and PPU run one frame, the frame before it is drawn on other threads.
+ *
+ * The PPU records each visible scanline's registers, secondary OAM, palette and copy-on-write pages of VRAM and CHR into a
+ * frame_record_t (see PPU::SetFrameRecord), and only works out sprite 0 hit as it goes. Recorded scanlines are then drawn
+ * in bands across a worker pool with the same code the PPU uses when drawing scanlines as they happen, so the picture is
+ * identical, just a frame later.
+ *
+ * Call BeginFrame before NESSystem::Frame() and EndFrame after it. The video buffers are only written between the two.
+ */
+class DeferredRenderer {
+
+	public:
+		/* Zero threads picks one per hardware thread, minus the emulation thread. */
+		DeferredRenderer(PPU* ppu, unsigned thread_count = 0);
+		~DeferredRenderer();
+
+		/* Start drawing the last recorded frame, and have the PPU record the coming one unless it is being skipped. */
+		void BeginFrame(bool record);
+
+		/* Wait for the frame started by BeginFrame to be drawn. Returns true if the video buffers now hold a new frame. */
+		bool EndFrame();
+
+		/* Draw the frame that just ran as well, so the video buffers are up to date. Returns true if there was one. */
+		bool Flush();
+
+		/* PPU frame count of the frame in the video buffers. */
+		uint64_t GetFrameNumber() { return frame_number; };
+
+		/* Threads drawing scanlines, including the one handing out the bands. */
+		unsigned GetThreadCount() { return worker_pool.GetThreadCount(); };
+
+		/* Scanlines drawn by each job. */
+		static const uint16_t LinesPerBand { 16 };
+
+	private:
+		void RenderLoop();
+
+		PPU* ppu;
+
+		WorkerPool worker_pool;
+		std::thread render_thread;
+
+		/* One record is filled by the PPU while the other is drawn. */
+		frame_record_t records[2];
+		uint8_t recording { 0 };
+		bool is_recording { false };
+		bool has_recorded { false };
+
+		std::mutex mutex;
+		std::condition_variable frame_ready;
+		std::condition_variable frame_done;
+		bool stopping { false };
+
+		/* Record being drawn, nullptr when idle. */
+		frame_record_t* drawing { nullptr };
+		bool drawn { false };
+
+		/* Whether each scanline changed, written by the bands without sharing words the way a bitset would. */
+		bool changed_lines[PPU::ScreenHeight] { false };
+
+		uint64_t frame_number { 0 };
+};
+
+#endif /* __DEFERRED_RENDERER_HPP__ */
\ No newline at end of file
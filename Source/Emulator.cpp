@@ -18,9 +18,18 @@
  * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <bitset>
+#include <cctype>
+#include <chrono>
 #include <cmath>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <sstream>
 #include <stdio.h>
+#include <vector>
 
 #include <SDL.h>
 
@@ -30,7 +39,12 @@
 #include "NES/APU.hpp"
 #include "NES/CPU.hpp"
 #include "NES/PPU.hpp"
+#include "DeferredRenderer.hpp"
 #include "Emulator.hpp"
+#include "Filters/VideoFilter.hpp"
+#include "PPUViewer.hpp"
+#include "VideoCapture.hpp"
+#include "WorkerPool.hpp"
 
 int TestThread(void* data) {
 	return 0;
@@ -54,6 +68,18 @@ int Emulator::Main(int argc, char** argv) {
 	stored_argc = argc;
 	stored_argv = argv;
 
+	/* Parse arguments. */
+	HandleCommandLine();
+
+	/* Benchmarks run headless, without opening a window or audio device. */
+	if(benchmark_frames > 0) {
+		return Benchmark();
+	}
+
+	if(!regression_file_name.empty()) {
+		return RunRegression();
+	}
+
 	Initialize();
 	Loop();
 	Shutdown();
@@ -62,9 +88,6 @@ int Emulator::Main(int argc, char** argv) {
 }
 
 void Emulator::Initialize() {
-	/* Parse arguments. */
-	HandleCommandLine();
-
 	/* Startup libraries.*/
     SDL_SetMainReady();
 	SDL_Init(SDL_INIT_EVERYTHING);
@@ -79,7 +102,12 @@ void Emulator::Initialize() {
 
 	SDL_DisableScreenSaver();
 
-	sdl_window = SDL_CreateWindow("mattNES", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, PPU::ScreenWidth, PPU::ScreenHeight, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
+	CreateVideoFilters();
+
+	/* The window keeps the picture's aspect ratio, whichever way a filter scales it. */
+	const int window_height = PPU::ScreenHeight * GetOutputWidth() / PPU::ScreenWidth;
+
+	sdl_window = SDL_CreateWindow("mattNES", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, GetOutputWidth(), window_height, SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
 
 	sdl_renderer = SDL_CreateRenderer(sdl_window, -1, SDL_RENDERER_ACCELERATED);
 
@@ -94,7 +122,7 @@ void Emulator::Initialize() {
 
 	std::cout << '\n';
 
-	sdl_texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, PPU::ScreenWidth, PPU::ScreenHeight);
+	sdl_texture = SDL_CreateTexture(sdl_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, GetOutputWidth(), GetOutputHeight());
 
 	/* Open audio. */
 	SDL_AudioSpec want, have;
@@ -170,15 +198,28 @@ void Emulator::Initialize() {
 	// TODO: Seperate Interrupt() into two, one for requesting the interrupt, one for actually handling it, and a bool owned by the class for checking whether an interrupt is pending.
 	// TODO: Illegal opcodes that combine two instructions need to perform Read and Write the correct number of times, not just at the start of the instruction.
 
+	/* A ROM given on the command line takes priority. */
+	if(!command_line_file_name.empty()) {
+		file_name = command_line_file_name;
+	}
+
 	/* Create emulated system. */
 	nes_system = std::make_unique<NESSystem>(NESSystem::CPUEmulationMode::RP2A03, NESSystem::PPUEmulationMode::RP2C02, NESSystem::RegionEmulationMode::NTSC);
 	nes_system->Initialize(file_name);
+	nes_system->SetExactMapperIRQ(exact_mapper_irq);
 
 	/* Set program counter to automated mode for nestest.nes */
 	if(file_name == "Test/other/nestest.nes") {
 		nes_system->GetCPU()->SetProgramCounter(0xC000);
 	}
 
+	if(deferred_rendering) {
+		deferred_renderer = std::make_unique<DeferredRenderer>(nes_system->GetPPU());
+	}
+
+	StartCapture();
+	OpenPPUViewer();
+
 	is_fully_initialized = true;
 }
 
@@ -221,6 +262,20 @@ void Emulator::Loop() {
 				case SDL_DROPFILE:
 					// TODO: Support dragon drop files.
 					break;
+				case SDL_WINDOWEVENT:
+					/* Closing the PPU viewer leaves the emulator running. */
+					if(sdl_event.window.event == SDL_WINDOWEVENT_CLOSE) {
+						if(sdl_viewer_window != nullptr && sdl_event.window.windowID == SDL_GetWindowID(sdl_viewer_window)) {
+							ClosePPUViewer();
+						} else {
+							is_running = false;
+						}
+						break;
+					}
+
+					/* Exposed, resized, restored... */
+					force_present = true;
+					break;
 				default:
 					break;
 			}
@@ -228,15 +283,22 @@ void Emulator::Loop() {
 
 		if(emulation_paused == false) {
 
+			/* Disassembly and the nestest.nes automated run need to see every instruction, otherwise run a whole frame at once. */
 			if(disassemble_cpu) {
 				std::cout << nes_system->GetCPU()->StepDisassembler();
 
 				if(log_to_file) {
 					log_file << nes_system->GetCPU()->StepDisassembler();
 				}
-			}
 
-			nes_system->Frame();
+				nes_system->Step();
+			} else if(file_name == "Test/other/nestest.nes") {
+				nes_system->Step();
+			} else {
+				EmulateFrame(SkipNextFrame(frame_time));
+				CaptureFrame();
+				UpdatePPUViewer();
+			}
 		}
 
 		if(single_step) {
@@ -249,7 +311,7 @@ void Emulator::Loop() {
 				}
 			}
 
-			nes_system->Frame();
+			nes_system->Step();
 
 			single_step = false;
 		}
@@ -259,16 +321,19 @@ void Emulator::Loop() {
 			emulation_paused = true;
 		}
 
-		/* Render graphics. */
-		SDL_RenderClear(sdl_renderer);
-
-		if(display_video) {
-			SDL_UpdateTexture(sdl_texture, NULL, nes_system->GetPPU()->GetVideoBuffer(), (nes_system->GetPPU()->ScreenWidth * 4));
+		/* Render graphics, only when the picture changed or the window needs redrawing. */
+		if(display_video && nes_system->GetPPU()->IsFrameDirty()) {
+			UploadDirtyLines();
+			force_present = true;
 		}
 
-		SDL_RenderCopy(sdl_renderer, sdl_texture, NULL, NULL);
+		if(force_present) {
+			SDL_RenderClear(sdl_renderer);
+			SDL_RenderCopy(sdl_renderer, sdl_texture, NULL, NULL);
+			SDL_RenderPresent(sdl_renderer);
 
-		SDL_RenderPresent(sdl_renderer);
+			force_present = false;
+		}
 
 		frame_end = SDL_GetPerformanceCounter();
 		
@@ -286,6 +351,10 @@ void Emulator::Loop() {
 
 		if(display_framerate) {
 			std::cout << "Frame Time: " << frame_time * 1000.0 << "ms" << '\n';
+
+			if(video_capture) {
+				std::cout << "Capture queue: " << video_capture->GetQueueDepth() << "/" << video_capture->GetQueueCapacity() << ", " << video_capture->GetFramesDropped() << " dropped" << '\n';
+			}
 		}
 
 		//SDL_Delay(1);
@@ -297,6 +366,10 @@ void Emulator::Shutdown() {
 	/* Signal to others application is going down. */
 	is_fully_initialized = false;
 
+	StopCapture();
+	ClosePPUViewer();
+	deferred_renderer.reset();
+
 	/* Shutdown emulated system. */
 	nes_system->Shutdown();
 
@@ -319,18 +392,17 @@ void Emulator::Shutdown() {
 
 void Emulator::HandleInputDown() {
 
-	if(nes_system->GetControllerIO()->IsControllerStrobeLatchHigh()) {
-		switch(sdl_event.key.keysym.sym) {
-			case SDLK_UP:    BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_UP); break;
-			case SDLK_DOWN:  BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_DOWN); break;
-			case SDLK_LEFT:  BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_LEFT); break;
-			case SDLK_RIGHT: BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_RIGHT); break;
-			case SDLK_z:     BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_SELECT); break;
-			case SDLK_x:     BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_START); break;
-			case SDLK_c:     BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_B); break;
-			case SDLK_v:     BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_A); break;
-			default: break;
-		}
+	/* Button states are latched by the game through the controller strobe. */
+	switch(sdl_event.key.keysym.sym) {
+		case SDLK_UP:    BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_UP); break;
+		case SDLK_DOWN:  BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_DOWN); break;
+		case SDLK_LEFT:  BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_LEFT); break;
+		case SDLK_RIGHT: BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_RIGHT); break;
+		case SDLK_z:     BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_SELECT); break;
+		case SDLK_x:     BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_START); break;
+		case SDLK_c:     BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_B); break;
+		case SDLK_v:     BitSet(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_A); break;
+		default: break;
 	}
 
 	switch(sdl_event.key.keysym.sym) {
@@ -362,18 +434,17 @@ void Emulator::HandleInputDown() {
 
 void Emulator::HandleInputUp() {
 
-	if(nes_system->GetControllerIO()->IsControllerStrobeLatchHigh()) {
-		switch(sdl_event.key.keysym.sym) {
-			case SDLK_UP:    BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_UP); break;
-			case SDLK_DOWN:  BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_DOWN); break;
-			case SDLK_LEFT:  BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_LEFT); break;
-			case SDLK_RIGHT: BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_RIGHT); break;
-			case SDLK_z:     BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_SELECT); break;
-			case SDLK_x:     BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_START); break;
-			case SDLK_c:     BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_B); break;
-			case SDLK_v:     BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_A); break;
-			default: break;
-		}
+	/* Button states are latched by the game through the controller strobe. */
+	switch(sdl_event.key.keysym.sym) {
+		case SDLK_UP:    BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_UP); break;
+		case SDLK_DOWN:  BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_DOWN); break;
+		case SDLK_LEFT:  BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_LEFT); break;
+		case SDLK_RIGHT: BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_RIGHT); break;
+		case SDLK_z:     BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_SELECT); break;
+		case SDLK_x:     BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_START); break;
+		case SDLK_c:     BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_B); break;
+		case SDLK_v:     BitClear(nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0, NES_CONTROLLER_A); break;
+		default: break;
 	}
 }
 
@@ -382,7 +453,569 @@ void Emulator::HandleCommandLine() {
 
 	for(size_t i = 1; i < stored_argc; i++) {
 		std::cout << "Argument " << i << ": " << stored_argv[i] << '\n';
+
+		std::string argument = stored_argv[i];
+
+		if(argument == "--benchmark" && (i + 1) < stored_argc) {
+			benchmark_frames = std::strtoull(stored_argv[++i], nullptr, 10);
+		} else if(argument == "--regression" && (i + 1) < stored_argc) {
+			regression_file_name = stored_argv[++i];
+		} else if(argument == "--update-goldens") {
+			update_goldens = true;
+		} else if(argument == "--filter" && (i + 1) < stored_argc) {
+			video_filter_name = stored_argv[++i];
+		} else if(argument == "--ntsc") {
+			video_filter_name = "ntsc";
+		} else if(argument == "--capture" && (i + 1) < stored_argc) {
+			capture_output = stored_argv[++i];
+		} else if(argument == "--ppu-viewer") {
+			/* The scanline to show PPU memory at is optional. */
+			ppu_viewer_scanline = 241;
+
+			if((i + 1) < stored_argc && std::isdigit(static_cast<unsigned char>(stored_argv[i + 1][0]))) {
+				ppu_viewer_scanline = static_cast<int16_t>(std::min(std::strtoul(stored_argv[++i], nullptr, 10), 261ul));
+			}
+		} else if(argument == "--benchmark-filters") {
+			benchmark_filters = true;
+		} else if(argument == "--benchmark-background") {
+			benchmark_background = true;
+		} else if(argument == "--deferred-rendering") {
+			deferred_rendering = true;
+		} else if(argument == "--exact-mapper-irq") {
+			exact_mapper_irq = true;
+		} else if(argument == "--frameskip" && (i + 1) < stored_argc) {
+			std::string ratio = stored_argv[++i];
+
+			if(ratio == "auto") {
+				adaptive_frame_skip = true;
+			} else {
+				frame_skip = std::strtoul(ratio.c_str(), nullptr, 10);
+			}
+		} else {
+			command_line_file_name = argument;
+		}
+	}
+}
+
+int Emulator::Benchmark() {
+
+	if(command_line_file_name.empty()) {
+		std::cout << "Usage: mattNES <ROM file> --benchmark <frames>\n";
+		return 1;
+	}
+
+	file_name = command_line_file_name;
+
+	nes_system = std::make_unique<NESSystem>(NESSystem::CPUEmulationMode::RP2A03, NESSystem::PPUEmulationMode::RP2C02, NESSystem::RegionEmulationMode::NTSC);
+	nes_system->Initialize(file_name);
+	nes_system->SetExactMapperIRQ(exact_mapper_irq);
+
+	const auto start = std::chrono::steady_clock::now();
+
+	/* There is no real time to fall behind here, so adaptive frame skip skips as much as it can. */
+	if(adaptive_frame_skip) {
+		adaptive_frame_skip = false;
+		frame_skip = MaxAdaptiveFrameSkip;
+	}
+
+	CreateVideoFilters();
+	StartCapture();
+
+	if(deferred_rendering) {
+		deferred_renderer = std::make_unique<DeferredRenderer>(nes_system->GetPPU());
+	}
+
+	/* The PPU viewer draws headless too, to measure what it costs. */
+	if(ppu_viewer_scanline >= 0) {
+		ppu_viewer = std::make_unique<PPUViewer>(nes_system->GetPPU()->GetMasterPalette());
+		nes_system->GetPPU()->SetDebugSnapshotScanline(ppu_viewer_scanline);
+	}
+
+	/* Video filters are timed on their own, and always filter the whole frame to measure the worst case. */
+	std::chrono::steady_clock::duration filter_time { 0 };
+	uint64_t filtered_frames = 0;
+
+	for(uint64_t i = 0; i < benchmark_frames; i++) {
+		const bool drawn = EmulateFrame(SkipNextFrame(0.0));
+		CaptureFrame();
+		UpdatePPUViewer();
+
+		if(video_filter && drawn) {
+			const auto filter_start = std::chrono::steady_clock::now();
+			video_filter->FilterBands(worker_pool.get(), GetVideoFrame(), 0, PPU::ScreenHeight, filtered_buffer.data(), GetOutputWidth());
+			filter_time += std::chrono::steady_clock::now() - filter_start;
+			filtered_frames++;
+		}
+	}
+
+	/* With deferred rendering the last frame is still to be drawn. */
+	if(deferred_renderer) {
+		deferred_renderer->Flush();
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+	const double seconds = std::chrono::duration<double>(end - start - filter_time).count();
+
+	std::cout << "Benchmark: " << benchmark_frames << " frames of \"" << file_name << "\" in " << seconds * 1000.0 << "ms ("
+	          << benchmark_frames / seconds << " FPS, " << (seconds * 1000.0) / benchmark_frames << "ms per frame).\n";
+	std::cout << "Sprite 0 polling cycles skipped: " << nes_system->GetCPU()->PollCyclesSkipped() << '\n';
+	std::cout << "PPUDATA writes batched: " << nes_system->GetCPU()->PPUDataWritesBatched() << " ("
+	          << nes_system->GetCPU()->PPUDataWritesBatched() / static_cast<double>(benchmark_frames) << " per frame), reads batched: "
+	          << nes_system->GetCPU()->PPUDataReadsBatched() << " ("
+	          << nes_system->GetCPU()->PPUDataReadsBatched() / static_cast<double>(benchmark_frames) << " per frame).\n";
+
+	if(deferred_renderer) {
+		std::cout << "Deferred rendering on " << deferred_renderer->GetThreadCount() << " threads.\n";
+	}
+
+	if(filtered_frames > 0) {
+		const double filter_seconds = std::chrono::duration<double>(filter_time).count();
+
+		std::cout << "Video filter " << video_filter->GetName() << ": " << filtered_frames << " frames on " << worker_pool->GetThreadCount() << " threads in " << filter_seconds * 1000.0 << "ms ("
+		          << filtered_frames / filter_seconds << " FPS).\n";
+	}
+
+	if(ppu_viewer) {
+		std::cout << "PPU viewer: " << ppu_viewer->GetSnapshotsDrawn() << " snapshots drawn at scanline " << ppu_viewer_scanline << ".\n";
+		ppu_viewer.reset();
+	}
+
+	if(benchmark_filters) {
+		BenchmarkVideoFilters();
+	}
+
+	if(benchmark_background) {
+		BenchmarkBackgroundRendering();
+	}
+
+	StopCapture();
+	deferred_renderer.reset();
+
+	/* Frame skip must not change emulation, so this should match a run without --frameskip. */
+	std::cout << "RAM hash: " << std::hex << nes_system->GetRAMHash() << std::dec << '\n';
+
+	nes_system->Shutdown();
+
+	return 0;
+}
+
+void Emulator::CreateVideoFilters() {
+
+	if(!worker_pool) {
+		worker_pool = std::make_unique<WorkerPool>();
+	}
+
+	if(video_filter_name.empty()) {
+		return;
+	}
+
+	video_filter = VideoFilter::Create(video_filter_name);
+
+	if(!video_filter) {
+		std::cout << "Unknown video filter \"" << video_filter_name << "\", available filters are:";
+
+		for(const std::string& name : VideoFilter::GetFilterNames()) {
+			std::cout << " " << name;
+		}
+
+		std::cout << '\n';
+		return;
+	}
+
+	filtered_buffer.resize(video_filter->GetOutputWidth() * video_filter->GetOutputHeight(), 0);
+}
+
+int Emulator::GetOutputWidth() {
+
+	return video_filter ? video_filter->GetOutputWidth() : PPU::ScreenWidth;
+}
+
+int Emulator::GetOutputHeight() {
+
+	return video_filter ? video_filter->GetOutputHeight() : PPU::ScreenHeight;
+}
+
+video_frame_t Emulator::GetVideoFrame() {
+
+	video_frame_t frame;
+	frame.pixels = nes_system->GetPPU()->GetVideoBuffer();
+	frame.indexed = nes_system->GetPPU()->GetIndexedBuffer();
+	frame.frame_number = deferred_renderer ? deferred_renderer->GetFrameNumber() : nes_system->GetPPU()->FrameCount();
+
+	return frame;
+}
+
+bool Emulator::EmulateFrame(bool skip) {
+
+	nes_system->GetPPU()->SetSkipRendering(skip);
+
+	if(!deferred_renderer) {
+		nes_system->Frame();
+		return !skip;
+	}
+
+	deferred_renderer->BeginFrame(!skip);
+	nes_system->Frame();
+
+	return deferred_renderer->EndFrame();
+}
+
+void Emulator::BenchmarkVideoFilters() {
+
+	/* Every filter gets whole 256x240 frames, split across the worker pool as when playing. */
+	const uint32_t frames = 500;
+
+	std::cout << "Video filters, " << frames << " frames each on " << worker_pool->GetThreadCount() << " threads:\n";
+
+	for(const std::string& name : VideoFilter::GetFilterNames()) {
+		std::unique_ptr<VideoFilter> filter = VideoFilter::Create(name);
+		std::vector<uint32_t> output(filter->GetOutputWidth() * filter->GetOutputHeight());
+
+		const auto start = std::chrono::steady_clock::now();
+
+		for(uint32_t i = 0; i < frames; i++) {
+			filter->FilterBands(worker_pool.get(), GetVideoFrame(), 0, PPU::ScreenHeight, output.data(), filter->GetOutputWidth());
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << "  " << name << " (" << filter->GetOutputWidth() << "x" << filter->GetOutputHeight() << "): " << frames / seconds << " FPS, "
+		          << (seconds * 1000.0) / frames << "ms per frame.\n";
+	}
+}
+
+void Emulator::BenchmarkBackgroundRendering() {
+
+	/* The scanline v points at after the last frame, rendered over and over. */
+	const uint32_t lines = 200000;
+	PPU* ppu = nes_system->GetPPU();
+
+	uint8_t batched[PPU::ScreenWidth];
+	std::memcpy(batched, ppu->BenchmarkBackgroundLine(false), sizeof(batched));
+	const bool identical = std::memcmp(batched, ppu->BenchmarkBackgroundLine(true), sizeof(batched)) == 0;
+
+	std::cout << "Background rendering, " << lines << " scanlines each" << (identical ? "" : " (OUTPUT DIFFERS)") << ":\n";
+
+	for(bool per_dot : { false, true }) {
+		const auto start = std::chrono::steady_clock::now();
+
+		for(uint32_t i = 0; i < lines; i++) {
+			ppu->BenchmarkBackgroundLine(per_dot);
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		std::cout << "  " << (per_dot ? "one dot at a time" : "8 pixels at a time") << ": " << lines / seconds << " scanlines per second, "
+		          << (seconds * 1000000000.0) / lines << "ns per scanline.\n";
+	}
+}
+
+void Emulator::StartCapture() {
+
+	if(capture_output.empty()) {
+		return;
+	}
+
+	video_capture = std::make_unique<VideoCapture>();
+
+	if(!video_capture->Open(capture_output, PPU::ScreenWidth, PPU::ScreenHeight)) {
+		video_capture.reset();
+	}
+}
+
+void Emulator::CaptureFrame() {
+
+	if(video_capture) {
+		video_capture->SubmitFrame(nes_system->GetPPU()->GetVideoBuffer());
+	}
+}
+
+void Emulator::StopCapture() {
+
+	if(!video_capture) {
+		return;
+	}
+
+	video_capture->Close();
+
+	std::cout << "Capture: " << video_capture->GetFramesWritten() << " frames written to \"" << capture_output << "\", " << video_capture->GetFramesDropped() << " dropped, "
+	          << "queue depth peaked at " << video_capture->GetMaxQueueDepth() << "/" << video_capture->GetQueueCapacity() << ".\n";
+
+	video_capture.reset();
+}
+
+void Emulator::OpenPPUViewer() {
+
+	if(ppu_viewer_scanline < 0) {
+		return;
+	}
+
+	sdl_viewer_window = SDL_CreateWindow("mattNES PPU Viewer", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, PPUViewer::CanvasWidth, PPUViewer::CanvasHeight, SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
+	sdl_viewer_renderer = SDL_CreateRenderer(sdl_viewer_window, -1, SDL_RENDERER_ACCELERATED);
+	sdl_viewer_texture = SDL_CreateTexture(sdl_viewer_renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, PPUViewer::CanvasWidth, PPUViewer::CanvasHeight);
+
+	ppu_viewer = std::make_unique<PPUViewer>(nes_system->GetPPU()->GetMasterPalette());
+	nes_system->GetPPU()->SetDebugSnapshotScanline(ppu_viewer_scanline);
+}
+
+void Emulator::UpdatePPUViewer() {
+
+	if(!ppu_viewer) {
+		return;
+	}
+
+	/* Only every few frames, the views don't need to keep up with the game and the upload isn't free. */
+	if(nes_system->GetPPU()->IsDebugSnapshotReady() && (nes_system->GetPPU()->FrameCount() % PPUViewerFrameInterval) == 0) {
+		ppu_viewer->Submit(nes_system->GetPPU()->GetDebugSnapshot());
+		nes_system->GetPPU()->ClearDebugSnapshot();
+	}
+
+	if(sdl_viewer_window != nullptr && ppu_viewer->GetCanvas(ppu_viewer_pixels)) {
+		SDL_UpdateTexture(sdl_viewer_texture, NULL, ppu_viewer_pixels.data(), PPUViewer::CanvasWidth * 4);
+		SDL_RenderClear(sdl_viewer_renderer);
+		SDL_RenderCopy(sdl_viewer_renderer, sdl_viewer_texture, NULL, NULL);
+		SDL_RenderPresent(sdl_viewer_renderer);
+	}
+}
+
+void Emulator::ClosePPUViewer() {
+
+	if(sdl_viewer_window == nullptr) {
+		return;
+	}
+
+	nes_system->GetPPU()->SetDebugSnapshotScanline(-1);
+	ppu_viewer.reset();
+
+	SDL_DestroyTexture(sdl_viewer_texture);
+	SDL_DestroyRenderer(sdl_viewer_renderer);
+	SDL_DestroyWindow(sdl_viewer_window);
+
+	sdl_viewer_texture = nullptr;
+	sdl_viewer_renderer = nullptr;
+	sdl_viewer_window = nullptr;
+}
+
+void Emulator::UploadDirtyLines() {
+
+	const std::bitset<240>& dirty_lines = nes_system->GetPPU()->GetDirtyLines();
+
+	/* Filters that look at neighbouring rows need those rows done again too. */
+	std::bitset<240> lines = dirty_lines;
+
+	if(video_filter) {
+		for(uint8_t reach = 1; reach <= video_filter->GetRowReach(); reach++) {
+			lines |= (dirty_lines << reach) | (dirty_lines >> reach);
+		}
 	}
+
+	const video_frame_t frame = GetVideoFrame();
+	const int width = GetOutputWidth();
+
+	/* Upload each run of changed scanlines as one rectangle. */
+	for(int y = 0; y < PPU::ScreenHeight; y++) {
+
+		if(!lines.test(y)) {
+			continue;
+		}
+
+		int end = y;
+
+		while(end < PPU::ScreenHeight && lines.test(end)) {
+			end++;
+		}
+
+		if(video_filter) {
+			/* Filters write straight into the texture, so the filtered picture is never copied. */
+			const int scale = video_filter->GetRowScale();
+
+			SDL_Rect rows = { 0, y * scale, width, (end - y) * scale };
+			void* pixels = nullptr;
+			int pitch = 0;
+
+			if(SDL_LockTexture(sdl_texture, &rows, &pixels, &pitch) == 0) {
+				video_filter->FilterBands(worker_pool.get(), frame, y, end, static_cast<uint32_t*>(pixels), pitch / sizeof(uint32_t));
+				SDL_UnlockTexture(sdl_texture);
+			}
+		} else {
+			SDL_Rect rows = { 0, y, width, end - y };
+			SDL_UpdateTexture(sdl_texture, &rows, frame.pixels + (y * width), (width * 4));
+		}
+
+		y = end;
+	}
+
+	nes_system->GetPPU()->ClearDirtyLines();
+}
+
+int Emulator::RunRegression() {
+
+	if(command_line_file_name.empty()) {
+		std::cout << "Usage: mattNES <ROM file> --regression <test file> [--update-goldens]\n";
+		return 1;
+	}
+
+	std::ifstream regression_file(regression_file_name);
+
+	if(!regression_file.is_open()) {
+		std::cout << "Could not open regression test file \"" << regression_file_name << "\".\n";
+		return 1;
+	}
+
+	/**
+	 * Regression test files are plain text, one entry per line. Frames count from 1, the first NESSystem::Frame().
+	 *
+	 * input <frame> <buttons>: Controller 1 buttons (hex, bit 0 A to bit 7 Right) held from this frame on.
+	 * frame <frame> <hash>:    Golden hash of the video buffer at the end of this frame.
+	 * sprite0 <frame> <0|1>:   Whether sprite 0 hit is set in PPUSTATUS at the end of this frame, when VBlank starts.
+	 *
+	 * Anything else, such as # comments, is ignored.
+	 */
+	std::vector<std::string> lines;
+	std::map<uint64_t, uint8_t> inputs;
+	std::map<uint64_t, uint64_t> goldens;
+	std::map<uint64_t, bool> sprite_zero_goldens;
+
+	uint64_t last_frame = 0;
+
+	for(std::string line; std::getline(regression_file, line);) {
+		lines.push_back(line);
+
+		std::istringstream entry(line);
+		std::string type;
+		uint64_t frame = 0;
+		uint64_t value = 0;
+
+		if(!(entry >> type >> std::dec >> frame >> std::hex >> value) || frame == 0) {
+			continue;
+		}
+
+		if(type == "input") {
+			inputs[frame] = static_cast<uint8_t>(value);
+		} else if(type == "frame") {
+			goldens[frame] = value;
+			last_frame = std::max(last_frame, frame);
+		} else if(type == "sprite0") {
+			sprite_zero_goldens[frame] = value != 0;
+			last_frame = std::max(last_frame, frame);
+		}
+	}
+
+	regression_file.close();
+
+	file_name = command_line_file_name;
+
+	nes_system = std::make_unique<NESSystem>(NESSystem::CPUEmulationMode::RP2A03, NESSystem::PPUEmulationMode::RP2C02, NESSystem::RegionEmulationMode::NTSC);
+	nes_system->Initialize(file_name);
+	nes_system->SetExactMapperIRQ(exact_mapper_irq);
+	nes_system->GetPPU()->SetFrameHashing(true);
+
+	/* Each frame is drawn before its hash is checked, so this compares deferred rendering against the goldens frame for frame. */
+	if(deferred_rendering) {
+		deferred_renderer = std::make_unique<DeferredRenderer>(nes_system->GetPPU());
+	}
+
+	StartCapture();
+
+	uint64_t failures = 0;
+
+	const auto start = std::chrono::steady_clock::now();
+
+	for(uint64_t frame = 1; frame <= last_frame; frame++) {
+
+		if(inputs.count(frame)) {
+			nes_system->GetControllerIO()->GetControllerState()->controller_state_port1_D0 = inputs[frame];
+		}
+
+		EmulateFrame(false);
+
+		if(deferred_renderer) {
+			deferred_renderer->Flush();
+		}
+
+		CaptureFrame();
+
+		if(sprite_zero_goldens.count(frame)) {
+			const bool hit = nes_system->GetPPU()->IsSpriteZeroHit();
+
+			if(update_goldens) {
+				sprite_zero_goldens[frame] = hit;
+			} else if(hit != sprite_zero_goldens[frame]) {
+				std::cout << "Frame " << frame << ": expected sprite 0 hit " << sprite_zero_goldens[frame] << ", got " << hit << '\n';
+				failures++;
+			}
+		}
+
+		if(!goldens.count(frame)) {
+			continue;
+		}
+
+		const uint64_t hash = nes_system->GetPPU()->GetFrameHash();
+
+		if(update_goldens) {
+			goldens[frame] = hash;
+		} else if(hash != goldens[frame]) {
+			std::cout << "Frame " << frame << ": expected " << std::hex << goldens[frame] << ", got " << hash << std::dec << '\n';
+			failures++;
+		}
+	}
+
+	const auto end = std::chrono::steady_clock::now();
+	const double seconds = std::chrono::duration<double>(end - start).count();
+
+	StopCapture();
+	deferred_renderer.reset();
+
+	nes_system->Shutdown();
+
+	if(update_goldens) {
+		/* Rewrite frame and sprite0 lines with the new results, keeping everything else as it was. */
+		std::ofstream output_file(regression_file_name);
+
+		for(const std::string& line : lines) {
+			std::istringstream entry(line);
+			std::string type;
+			uint64_t frame = 0;
+
+			if((entry >> type >> frame) && type == "frame" && goldens.count(frame)) {
+				output_file << "frame " << frame << " " << std::hex << goldens[frame] << std::dec << '\n';
+			} else if(type == "sprite0" && sprite_zero_goldens.count(frame)) {
+				output_file << "sprite0 " << frame << " " << sprite_zero_goldens[frame] << '\n';
+			} else {
+				output_file << line << '\n';
+			}
+		}
+
+		std::cout << "Regression: updated " << goldens.size() << " golden frames and " << sprite_zero_goldens.size() << " sprite 0 checks in \"" << regression_file_name << "\".\n";
+		return 0;
+	}
+
+	std::cout << "Regression: " << goldens.size() + sprite_zero_goldens.size() - failures << "/" << goldens.size() + sprite_zero_goldens.size() << " golden frames and sprite 0 checks match, "
+	          << last_frame << " frames in " << seconds * 1000.0 << "ms (" << last_frame / seconds << " FPS).\n";
+
+	return failures == 0 ? 0 : 1;
+}
+
+bool Emulator::SkipNextFrame(double last_frame_time) {
+
+	bool skip = false;
+
+	if(adaptive_frame_skip) {
+		/* Keep track of how far behind the NES emulation is, capped so a long stall doesn't skip for seconds. */
+		frame_time_behind = std::min(std::max(frame_time_behind + last_frame_time - NTSCFrameTime, 0.0), NTSCFrameTime * MaxAdaptiveFrameSkip);
+
+		skip = (frame_time_behind > NTSCFrameTime) && (frames_skipped_in_row < MaxAdaptiveFrameSkip);
+	} else {
+		skip = frames_skipped_in_row < frame_skip;
+	}
+
+	if(skip) {
+		frames_skipped_in_row++;
+	} else {
+		frames_skipped_in_row = 0;
+	}
+
+	return skip;
 }
 
 void Emulator::AudioCallback(std::uint8_t* stream, int length) {
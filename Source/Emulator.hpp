@@ -25,16 +25,22 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include <SDL.h>
 
+#include "Filters/VideoFilter.hpp"
 #include "NES/ControllerIO.hpp"
 
 extern "C" {
 	void EmulatorAudioCallback(void* userdata, Uint8 stream, int length);
 }
 
+class DeferredRenderer;
 class NESSystem;
+class PPUViewer;
+class VideoCapture;
+class WorkerPool;
 
 class Emulator {
 
@@ -53,6 +59,48 @@ class Emulator {
 
 		void HandleCommandLine();
 
+		/* Run the ROM given on the command line headless for benchmark_frames frames, and report the speed. */
+		int Benchmark();
+
+		/* Play the ROM given on the command line with the inputs in regression_file_name, and compare frame hashes against the goldens stored there. */
+		int RunRegression();
+
+		/* Set up the video filters chosen on the command line. */
+		void CreateVideoFilters();
+
+		/* Size of the picture after video filters. */
+		int GetOutputWidth();
+		int GetOutputHeight();
+
+		/* The PPU's finished frame, for video filters. */
+		video_frame_t GetVideoFrame();
+
+		/* Run one frame, skipping drawing it if skip is set. Returns true if the video buffers hold a newly drawn frame afterwards,
+		 * which with deferred rendering is the frame before. */
+		bool EmulateFrame(bool skip);
+
+		/* Time every video filter on full frames of the current picture. */
+		void BenchmarkVideoFilters();
+
+		/* Time rendering background scanlines 8 pixels at a time against one dot at a time, and check they match. */
+		void BenchmarkBackgroundRendering();
+
+		/* Start recording to capture_output, queue the frame just finished, and finish the recording and report on it. */
+		void StartCapture();
+		void CaptureFrame();
+		void StopCapture();
+
+		/* Open the PPU viewer window, hand it the PPU's latest snapshot and show what it drew, and close it. */
+		void OpenPPUViewer();
+		void UpdatePPUViewer();
+		void ClosePPUViewer();
+
+		/* Copy the scanlines the PPU has changed into sdl_texture, through the video filter when there is one. */
+		void UploadDirtyLines();
+
+		/* Decide whether the next frame is run without drawing, from the skip ratio or how far behind real time emulation is. */
+		bool SkipNextFrame(double last_frame_time);
+
 		void AudioCallback(std::uint8_t* stream, int length);
 
 	private:
@@ -62,6 +110,10 @@ class Emulator {
 		SDL_Texture*      sdl_texture { nullptr };
 		SDL_AudioDeviceID sdl_audio_device_id { 0 };
 
+		SDL_Window*       sdl_viewer_window { nullptr };
+		SDL_Renderer*     sdl_viewer_renderer { nullptr };
+		SDL_Texture*      sdl_viewer_texture { nullptr };
+
 		SDL_Thread*		  sdl_emulation_thread { nullptr };
 
 		SDL_Event         sdl_event { 0 };
@@ -75,9 +127,69 @@ class Emulator {
 		/* File name of the ROM being run. */
 		std::string file_name;
 
+		/* File name of the ROM given on the command line, if any. */
+		std::string command_line_file_name;
+
+		/* Number of frames to run with --benchmark, zero when not benchmarking. */
+		uint64_t benchmark_frames { 0 };
+
+		/* Regression test file given with --regression, and whether to rewrite its golden hashes instead of checking them (--update-goldens). */
+		std::string regression_file_name;
+		bool update_goldens { false };
+
+		/* Frames skipped after every drawn frame with --frameskip <n>. With --frameskip auto, frames are skipped only while running slower than the NES. */
+		uint32_t frame_skip { 0 };
+		bool adaptive_frame_skip { false };
+		uint32_t frames_skipped_in_row { 0 };
+		double frame_time_behind { 0.0 };
+
+		/* Most frames in a row adaptive frame skip will skip, so the picture never freezes. */
+		static const uint32_t MaxAdaptiveFrameSkip { 8 };
+
+		/* Length of an NTSC frame in seconds. */
+		static constexpr double NTSCFrameTime { 1.0 / 60.0988 };
+
 		/* Return value from emulation thread. */
 		int sdl_emulation_thread_value { 0 };
 
+		/* Video filter chosen with --filter <name> (--ntsc is short for --filter ntsc), which writes straight into the locked texture. */
+		std::string video_filter_name;
+		std::unique_ptr<VideoFilter> video_filter;
+
+		/* Filter output when there is no texture, for benchmarks. */
+		std::vector<uint32_t> filtered_buffer;
+
+		/* Y4M recording of every frame (--capture <file or |command>), which works headless too. */
+		std::string capture_output;
+		std::unique_ptr<VideoCapture> video_capture;
+
+		/* PPU memory viewer (--ppu-viewer [scanline]), drawn from a snapshot taken at ppu_viewer_scanline, -1 when off. */
+		int16_t ppu_viewer_scanline { -1 };
+		std::unique_ptr<PPUViewer> ppu_viewer;
+		std::vector<uint32_t> ppu_viewer_pixels;
+
+		/* Frames between PPU viewer updates. */
+		static const uint32_t PPUViewerFrameInterval { 2 };
+
+		/* Benchmark every video filter after --benchmark (--benchmark-filters). */
+		bool benchmark_filters { false };
+
+		/* Benchmark background rendering after --benchmark (--benchmark-background). */
+		bool benchmark_background { false };
+
+		/* Draw each frame on other threads while the next one runs (--deferred-rendering), a frame behind. */
+		bool deferred_rendering { false };
+		std::unique_ptr<DeferredRenderer> deferred_renderer;
+
+		/* Catch the PPU up on every mapper scanline counter clock instead of only for the predicted IRQ (--exact-mapper-irq). */
+		bool exact_mapper_irq { false };
+
+		/* Threads shared by the video filters. */
+		std::unique_ptr<WorkerPool> worker_pool;
+
+		/* Set when the window has to be presented again even if the picture didn't change. */
+		bool force_present { true };
+
 		bool display_framerate { false };
 		bool display_video { true };
 		bool emulation_paused { false };
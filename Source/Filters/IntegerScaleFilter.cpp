@@ -0,0 +1,70 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define INTEGER_SCALE_FILTER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "IntegerScaleFilter.hpp"
+
+IntegerScaleFilter::IntegerScaleFilter(uint8_t scale) : scale(scale) {
+
+	name = "integer" + std::to_string(scale) + "x";
+}
+
+IntegerScaleFilter::~IntegerScaleFilter() {
+
+}
+
+void IntegerScaleFilter::FilterRows(const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch) {
+
+	for(uint16_t row = first_row; row < last_row; row++) {
+		const uint32_t* input = &frame.pixels[row * PPU::ScreenWidth];
+		uint16_t x = 0;
+
+#ifdef INTEGER_SCALE_FILTER_SSE2
+		/* Doubling is the common case, and just interleaves each pixel with itself. */
+		if(scale == 2) {
+			for(; x < PPU::ScreenWidth; x += 4) {
+				const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&input[x]));
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&output[x * 2]), _mm_unpacklo_epi32(pixels, pixels));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(&output[x * 2 + 4]), _mm_unpackhi_epi32(pixels, pixels));
+			}
+		}
+#endif
+
+		for(; x < PPU::ScreenWidth; x++) {
+			for(uint8_t copy = 0; copy < scale; copy++) {
+				output[x * scale + copy] = input[x];
+			}
+		}
+
+		/* The other rows are the same as the first. */
+		for(uint8_t copy = 1; copy < scale; copy++) {
+			std::memcpy(&output[copy * output_pitch], output, GetOutputWidth() * sizeof(uint32_t));
+		}
+
+		output += output_pitch * scale;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __INTEGER_SCALE_FILTER_HPP__
+#define __INTEGER_SCALE_FILTER_HPP__
+
+#include <cstdint>
+#include <string>
+
+#include "../NES/PPU.hpp"
+#include "VideoFilter.hpp"
+
+/* Nearest neighbour scaling by a whole number, so software renderers only have to copy the texture. */
+class IntegerScaleFilter : public VideoFilter {
+
+	public:
+		IntegerScaleFilter(uint8_t scale);
+		~IntegerScaleFilter();
+
+		const char* GetName() { return name.c_str(); };
+
+		uint16_t GetOutputWidth() { return PPU::ScreenWidth * scale; };
+		uint16_t GetOutputHeight() { return PPU::ScreenHeight * scale; };
+		uint8_t GetRowReach() { return 0; };
+
+		void FilterRows(const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch);
+
+	private:
+		uint8_t scale;
+		std::string name;
+};
+
+#endif /* __INTEGER_SCALE_FILTER_HPP__ */
\ No newline at end of file
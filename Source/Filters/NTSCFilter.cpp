@@ -0,0 +1,199 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NTSC_FILTER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "NTSCFilter.hpp"
+
+/* Composite voltages of the 2C02 for each luma level, the low and high halves of the color wave.
+   From the NTSC video page of the NESdev wiki. */
+static const float SignalLow[4]  { 0.350f, 0.518f, 0.962f, 1.550f };
+static const float SignalHigh[4] { 1.094f, 1.506f, 1.962f, 1.962f };
+static const float SignalBlack { 0.518f };
+static const float SignalWhite { 1.962f };
+static const float EmphasisAttenuation { 0.746f };
+
+static const float Pi { 3.14159265358979f };
+
+NTSCFilter::NTSCFilter() {
+
+	/* Decode every pixel at every phase it can start on (pixels are 8 samples, so rows start at 0, 4 or 8 and so do pixels). */
+	pixel_signals.resize(512 * 3);
+
+	for(uint16_t pixel = 0; pixel < 512; pixel++) {
+		for(uint8_t start = 0; start < 3; start++) {
+			PixelSignal& signal = pixel_signals[pixel * 3 + start];
+
+			for(uint8_t pair = 0; pair < 4; pair++) {
+				signal.y[pair] = signal.i[pair] = signal.q[pair] = 0.0f;
+
+				for(uint8_t sample = pair * 2; sample < pair * 2 + 2; sample++) {
+					const uint8_t phase = (start * 4 + sample) % 12;
+
+					/* Each output pixel averages 12 samples, so the division is done here once. */
+					const float level = (SignalLevel(pixel, phase) - SignalBlack) / (SignalWhite - SignalBlack) / 12.0f;
+					const float angle = Pi * (phase + HueShift) / 6.0f;
+
+					signal.y[pair] += level;
+					signal.i[pair] += level * std::cos(angle);
+					signal.q[pair] += level * std::sin(angle);
+				}
+			}
+		}
+	}
+}
+
+NTSCFilter::~NTSCFilter() {
+
+}
+
+float NTSCFilter::SignalLevel(uint16_t pixel, uint8_t phase) {
+
+	const uint8_t color = pixel & 0x0F;
+	const uint8_t level = (color > 13) ? 1 : ((pixel >> 4) & 0x03);
+	const uint8_t emphasis = (pixel >> 6) & 0x07;
+
+	/* The color wave is high for 6 of every 12 samples, at a phase set by the hue. */
+	auto in_color_phase = [phase](uint8_t hue) { return (hue + phase) % 12 < 6; };
+
+	/* Hue 0 is high all the time and hues 13 - 15 low all the time, giving greys. */
+	float signal;
+
+	if(color == 0) {
+		signal = SignalHigh[level];
+	} else if(color > 12) {
+		signal = SignalLow[level];
+	} else {
+		signal = in_color_phase(color) ? SignalHigh[level] : SignalLow[level];
+	}
+
+	/* Each emphasis bit pulls the signal down for its third of the color wave. */
+	if(((emphasis & 0x01) && in_color_phase(0)) || ((emphasis & 0x02) && in_color_phase(4)) || ((emphasis & 0x04) && in_color_phase(8))) {
+		signal *= EmphasisAttenuation;
+	}
+
+	return signal;
+}
+
+void NTSCFilter::FilterRows(const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch) {
+
+	/* Every scanline is 2728 samples, which moves the color phase by 4 each line, and the frame repeats every 3. */
+	const uint8_t frame_phase = (frame.frame_number % 3) * 4;
+
+	for(uint16_t row = first_row; row < last_row; row++) {
+		FilterRow(&frame.indexed[row * PPU::ScreenWidth], (frame_phase + row * 4) % 12, output);
+		output += output_pitch;
+	}
+}
+
+#ifdef NTSC_FILTER_SSE2
+/* Sums of the 6 pairs starting at pairs[0], pairs[2], pairs[4] and pairs[6]. */
+static inline __m128 WindowSums(const float* pairs) {
+
+	__m128 low = _mm_loadu_ps(pairs);
+	__m128 high = _mm_loadu_ps(pairs + 4);
+
+	for(uint8_t offset = 1; offset < 6; offset++) {
+		low = _mm_add_ps(low, _mm_loadu_ps(pairs + offset));
+		high = _mm_add_ps(high, _mm_loadu_ps(pairs + 4 + offset));
+	}
+
+	return _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+}
+#endif
+
+void NTSCFilter::FilterRow(const uint16_t* indexed, uint8_t phase, uint32_t* output) {
+
+	/* Lay out the signal of the whole row as sample pairs, with silence past either edge. */
+	alignas(16) float pairs_y[PairsPerRow + PairPadding * 2];
+	alignas(16) float pairs_i[PairsPerRow + PairPadding * 2];
+	alignas(16) float pairs_q[PairsPerRow + PairPadding * 2];
+
+	for(uint16_t pair = 0; pair < PairPadding; pair++) {
+		pairs_y[pair] = pairs_i[pair] = pairs_q[pair] = 0.0f;
+		pairs_y[PairPadding + PairsPerRow + pair] = pairs_i[PairPadding + PairsPerRow + pair] = pairs_q[PairPadding + PairsPerRow + pair] = 0.0f;
+	}
+
+	for(uint16_t x = 0; x < PPU::ScreenWidth; x++) {
+		const PixelSignal& signal = pixel_signals[(indexed[x] & 0x1FF) * 3 + phase / 4];
+		const uint16_t position = PairPadding + x * 4;
+
+		std::copy(signal.y, signal.y + 4, &pairs_y[position]);
+		std::copy(signal.i, signal.i + 4, &pairs_i[position]);
+		std::copy(signal.q, signal.q + 4, &pairs_q[position]);
+
+		/* 8 samples per pixel moves the phase on by 8. */
+		phase = (phase + 8) % 12;
+	}
+
+	/* Output pixel x is centred on sample 4x, and its window covers pairs 2x - 3 to 2x + 2. */
+#ifdef NTSC_FILTER_SSE2
+	const __m128 scale = _mm_set1_ps(255.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	for(uint16_t x = 0; x < OutputWidth; x += 4) {
+		const uint16_t window = PairPadding + x * 2 - 3;
+
+		const __m128 y = WindowSums(&pairs_y[window]);
+		const __m128 i = WindowSums(&pairs_i[window]);
+		const __m128 q = WindowSums(&pairs_q[window]);
+
+		/* YIQ to RGB. */
+		__m128 red   = _mm_add_ps(y, _mm_add_ps(_mm_mul_ps(i, _mm_set1_ps(0.946882f)), _mm_mul_ps(q, _mm_set1_ps(0.623557f))));
+		__m128 green = _mm_sub_ps(y, _mm_add_ps(_mm_mul_ps(i, _mm_set1_ps(0.274788f)), _mm_mul_ps(q, _mm_set1_ps(0.635691f))));
+		__m128 blue  = _mm_add_ps(y, _mm_sub_ps(_mm_mul_ps(q, _mm_set1_ps(1.709007f)), _mm_mul_ps(i, _mm_set1_ps(1.108545f))));
+
+		red   = _mm_min_ps(_mm_max_ps(_mm_mul_ps(red, scale), zero), scale);
+		green = _mm_min_ps(_mm_max_ps(_mm_mul_ps(green, scale), zero), scale);
+		blue  = _mm_min_ps(_mm_max_ps(_mm_mul_ps(blue, scale), zero), scale);
+
+		const __m128i pixels = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_cvtps_epi32(red), 16), _mm_slli_epi32(_mm_cvtps_epi32(green), 8)), _mm_cvtps_epi32(blue));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&output[x]), pixels);
+	}
+#else
+	auto to_channel = [](float value) { return static_cast<uint32_t>(std::min(std::max(value * 255.0f, 0.0f), 255.0f) + 0.5f); };
+
+	for(uint16_t x = 0; x < OutputWidth; x++) {
+		const uint16_t window = PairPadding + x * 2 - 3;
+
+		float y = 0.0f, i = 0.0f, q = 0.0f;
+
+		for(uint8_t pair = 0; pair < 6; pair++) {
+			y += pairs_y[window + pair];
+			i += pairs_i[window + pair];
+			q += pairs_q[window + pair];
+		}
+
+		/* YIQ to RGB. */
+		const uint32_t red   = to_channel(y + 0.946882f * i + 0.623557f * q);
+		const uint32_t green = to_channel(y - 0.274788f * i - 0.635691f * q);
+		const uint32_t blue  = to_channel(y - 1.108545f * i + 1.709007f * q);
+
+		output[x] = (red << 16) | (green << 8) | blue;
+	}
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,82 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __NTSC_FILTER_HPP__
+#define __NTSC_FILTER_HPP__
+
+#include <cstdint>
+#include <vector>
+
+#include "../NES/PPU.hpp"
+#include "VideoFilter.hpp"
+
+/**
+ * NTSC composite video filter, run on the PPU's indexed buffer after a frame is drawn.
+ *
+ * Rebuilds the composite signal the PPU would send out (square waves of 12 samples per color cycle, 8 samples per pixel),
+ * and decodes it back to RGB through a 12 sample window, which gives the color bleeding, artifact colors and dot crawl of a TV.
+ * Output is twice as wide as the PPU picture, one pixel every 4 signal samples.
+ *
+ * Since every pixel's signal only depends on its color, emphasis and phase, the filter works from tables of decoded signal
+ * per pixel, so a line is a few table lookups and sums, done 4 pixels at a time with SSE2 where available.
+ */
+class NTSCFilter : public VideoFilter {
+
+	public:
+		NTSCFilter();
+		~NTSCFilter();
+
+		const char* GetName() { return "ntsc"; };
+
+		uint16_t GetOutputWidth() { return OutputWidth; };
+		uint16_t GetOutputHeight() { return PPU::ScreenHeight; };
+		uint8_t GetRowReach() { return 0; };
+
+		/* Works from frame.indexed. frame_number sets the color phase of the frame, for dot crawl. */
+		void FilterRows(const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch);
+
+		static const uint16_t OutputWidth { PPU::ScreenWidth * 2 };
+
+		/* Hue correction in signal samples. */
+		static constexpr float HueShift { 3.9f };
+
+	private:
+		/* Decode one row. phase is the signal phase (0, 4 or 8) of the first sample of the first pixel. */
+		void FilterRow(const uint16_t* indexed, uint8_t phase, uint32_t* output);
+
+		/* Amplitude of the signal for a pixel at a sample phase, scaled so black is 0 and white is 1. */
+		static float SignalLevel(uint16_t pixel, uint8_t phase);
+
+		/* Decoded signal of each pixel (9 bit color and emphasis) at each starting phase, as the sums of its 4 sample pairs
+		   for Y, I and Q. Output pixels sit on sample pairs, so each one is the sum of the 6 pairs under its window. */
+		struct PixelSignal {
+			alignas(16) float y[4];
+			alignas(16) float i[4];
+			alignas(16) float q[4];
+		};
+
+		std::vector<PixelSignal> pixel_signals;
+
+		/* Sample pairs in a row, with 4 pairs of padding on each side for the window at the edges. */
+		static const uint16_t PairsPerRow { PPU::ScreenWidth * 4 };
+		static const uint16_t PairPadding { 4 };
+};
+
+#endif /* __NTSC_FILTER_HPP__ */
\ No newline at end of file
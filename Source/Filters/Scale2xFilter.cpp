@@ -0,0 +1,106 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCALE2X_FILTER_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "Scale2xFilter.hpp"
+
+Scale2xFilter::Scale2xFilter() {
+
+}
+
+Scale2xFilter::~Scale2xFilter() {
+
+}
+
+#ifdef SCALE2X_FILTER_SSE2
+/* mask ? a : b */
+static inline __m128i Select(__m128i mask, __m128i a, __m128i b) {
+
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+#endif
+
+void Scale2xFilter::FilterRows(const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch) {
+
+	/* Neighbours are named as on a keypad turned upside down:
+	     B
+	   D E F
+	     H
+	   Pixels past the edge of the frame repeat the edge. */
+	uint32_t center[PPU::ScreenWidth + 2];
+
+	for(uint16_t row = first_row; row < last_row; row++) {
+		const uint32_t* above = &frame.pixels[std::max(row - 1, 0) * PPU::ScreenWidth];
+		const uint32_t* below = &frame.pixels[std::min(row + 1, PPU::ScreenHeight - 1) * PPU::ScreenWidth];
+
+		std::copy(&frame.pixels[row * PPU::ScreenWidth], &frame.pixels[(row + 1) * PPU::ScreenWidth], &center[1]);
+		center[0] = center[1];
+		center[PPU::ScreenWidth + 1] = center[PPU::ScreenWidth];
+
+		uint32_t* output_top = output;
+		uint32_t* output_bottom = output + output_pitch;
+
+#ifdef SCALE2X_FILTER_SSE2
+		for(uint16_t x = 0; x < PPU::ScreenWidth; x += 4) {
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&above[x]));
+			const __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&center[x]));
+			const __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&center[x + 1]));
+			const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&center[x + 2]));
+			const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&below[x]));
+
+			const __m128i db = _mm_cmpeq_epi32(d, b);
+			const __m128i bf = _mm_cmpeq_epi32(b, f);
+			const __m128i dh = _mm_cmpeq_epi32(d, h);
+			const __m128i hf = _mm_cmpeq_epi32(h, f);
+
+			const __m128i e0 = Select(_mm_andnot_si128(_mm_or_si128(bf, dh), db), d, e);
+			const __m128i e1 = Select(_mm_andnot_si128(_mm_or_si128(db, hf), bf), f, e);
+			const __m128i e2 = Select(_mm_andnot_si128(_mm_or_si128(db, hf), dh), d, e);
+			const __m128i e3 = Select(_mm_andnot_si128(_mm_or_si128(dh, bf), hf), f, e);
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&output_top[x * 2]), _mm_unpacklo_epi32(e0, e1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&output_top[x * 2 + 4]), _mm_unpackhi_epi32(e0, e1));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&output_bottom[x * 2]), _mm_unpacklo_epi32(e2, e3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(&output_bottom[x * 2 + 4]), _mm_unpackhi_epi32(e2, e3));
+		}
+#else
+		for(uint16_t x = 0; x < PPU::ScreenWidth; x++) {
+			const uint32_t b = above[x];
+			const uint32_t d = center[x];
+			const uint32_t e = center[x + 1];
+			const uint32_t f = center[x + 2];
+			const uint32_t h = below[x];
+
+			output_top[x * 2]        = (d == b && b != f && d != h) ? d : e;
+			output_top[x * 2 + 1]    = (b == f && b != d && f != h) ? f : e;
+			output_bottom[x * 2]     = (d == h && d != b && h != f) ? d : e;
+			output_bottom[x * 2 + 1] = (h == f && d != h && b != f) ? f : e;
+		}
+#endif
+
+		output += output_pitch * 2;
+	}
+}
\ No newline at end of file
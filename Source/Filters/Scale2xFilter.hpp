@@ -0,0 +1,50 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SCALE2X_FILTER_HPP__
+#define __SCALE2X_FILTER_HPP__
+
+#include <cstdint>
+
+#include "../NES/PPU.hpp"
+#include "VideoFilter.hpp"
+
+/**
+ * Scale2x (AdvMAME2x), doubling each pixel into a 2x2 block whose corners take the color of matching neighbours,
+ * which rounds off diagonal edges without making new colors.
+ *
+ * Only equality tests and selects, so it runs 4 pixels at a time with SSE2 where available.
+ */
+class Scale2xFilter : public VideoFilter {
+
+	public:
+		Scale2xFilter();
+		~Scale2xFilter();
+
+		const char* GetName() { return "scale2x"; };
+
+		uint16_t GetOutputWidth() { return PPU::ScreenWidth * 2; };
+		uint16_t GetOutputHeight() { return PPU::ScreenHeight * 2; };
+		uint8_t GetRowReach() { return 1; };
+
+		void FilterRows(const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch);
+};
+
+#endif /* __SCALE2X_FILTER_HPP__ */
\ No newline at end of file
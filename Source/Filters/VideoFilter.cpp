@@ -0,0 +1,79 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "../NES/PPU.hpp"
+#include "../WorkerPool.hpp"
+#include "IntegerScaleFilter.hpp"
+#include "NTSCFilter.hpp"
+#include "Scale2xFilter.hpp"
+#include "VideoFilter.hpp"
+#include "XBRFilter.hpp"
+
+void VideoFilter::FilterBands(WorkerPool* worker_pool, const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch) {
+
+	const size_t band_count = (last_row - first_row + RowsPerBand - 1) / RowsPerBand;
+	const size_t band_pitch = output_pitch * GetRowScale() * RowsPerBand;
+
+	auto filter_band = [&](size_t band) {
+		const uint16_t band_first_row = static_cast<uint16_t>(first_row + band * RowsPerBand);
+		const uint16_t band_last_row = std::min<uint16_t>(band_first_row + RowsPerBand, last_row);
+
+		FilterRows(frame, band_first_row, band_last_row, output + band * band_pitch, output_pitch);
+	};
+
+	if(worker_pool != nullptr) {
+		worker_pool->Run(band_count, filter_band);
+	} else {
+		for(size_t band = 0; band < band_count; band++) {
+			filter_band(band);
+		}
+	}
+}
+
+uint16_t VideoFilter::GetRowScale() {
+
+	return GetOutputHeight() / PPU::ScreenHeight;
+}
+
+std::unique_ptr<VideoFilter> VideoFilter::Create(const std::string& name) {
+
+	if(name == "ntsc") {
+		return std::make_unique<NTSCFilter>();
+	} else if(name == "scale2x") {
+		return std::make_unique<Scale2xFilter>();
+	} else if(name == "xbr2x") {
+		return std::make_unique<XBRFilter>();
+	} else if(name == "integer2x") {
+		return std::make_unique<IntegerScaleFilter>(2);
+	} else if(name == "integer3x") {
+		return std::make_unique<IntegerScaleFilter>(3);
+	} else if(name == "integer4x") {
+		return std::make_unique<IntegerScaleFilter>(4);
+	}
+
+	return nullptr;
+}
+
+std::vector<std::string> VideoFilter::GetFilterNames() {
+
+	return { "ntsc", "scale2x", "xbr2x", "integer2x", "integer3x", "integer4x" };
+}
\ No newline at end of file
@@ -0,0 +1,78 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VIDEO_FILTER_HPP__
+#define __VIDEO_FILTER_HPP__
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class WorkerPool;
+
+/* A finished PPU frame, as both ARGB8888 pixels and palette indexes (see PPU::GetIndexedBuffer). */
+typedef struct video_frame {
+	const uint32_t* pixels { nullptr };
+	const uint16_t* indexed { nullptr };
+	uint64_t frame_number { 0 };
+} video_frame_t;
+
+/**
+ * Post processing stage run on PPU output before it is shown.
+ *
+ * Filters turn rows of the 256x240 frame into rows of their own output size, and any input row range can be filtered on its own,
+ * so rows can be split into bands across threads and only changed rows need filtering.
+ */
+class VideoFilter {
+
+	public:
+		virtual ~VideoFilter() {};
+
+		virtual const char* GetName() =0;
+
+		virtual uint16_t GetOutputWidth() =0;
+		virtual uint16_t GetOutputHeight() =0;
+
+		/* Input rows above and below a row that change its output, so changed rows can be widened to cover them. */
+		virtual uint8_t GetRowReach() =0;
+
+		/* Filter input rows first_row to last_row - 1 into output, which points at the output of first_row. output_pitch is in pixels. */
+		virtual void FilterRows(const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch) =0;
+
+		/* Same as FilterRows, with the rows split into bands across worker_pool (or run on this thread when it is null). */
+		void FilterBands(WorkerPool* worker_pool, const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch);
+
+		/* Output rows for every input row. */
+		uint16_t GetRowScale();
+
+		/* Create a filter by its name on the command line, or return null if there is no such filter. */
+		static std::unique_ptr<VideoFilter> Create(const std::string& name);
+
+		/* Every name Create understands. */
+		static std::vector<std::string> GetFilterNames();
+
+	protected:
+		/* Input rows per job handed to the worker pool. */
+		static const uint16_t RowsPerBand { 16 };
+};
+
+#endif /* __VIDEO_FILTER_HPP__ */
\ No newline at end of file
@@ -0,0 +1,187 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "XBRFilter.hpp"
+
+XBRFilter::XBRFilter() {
+
+}
+
+XBRFilter::~XBRFilter() {
+
+}
+
+uint32_t XBRFilter::ToYUV(uint32_t pixel) {
+
+	const int red   = (pixel >> 16) & 0xFF;
+	const int green = (pixel >> 8) & 0xFF;
+	const int blue  = pixel & 0xFF;
+
+	const int y = (77 * red + 150 * green + 29 * blue) >> 8;
+	const int u = ((-43 * red - 85 * green + 128 * blue) >> 8) + 128;
+	const int v = ((128 * red - 107 * green - 21 * blue) >> 8) + 128;
+
+	return (y << 16) | (u << 8) | v;
+}
+
+uint32_t XBRFilter::Difference(uint32_t yuv_a, uint32_t yuv_b) {
+
+	return std::abs(static_cast<int>((yuv_a >> 16) & 0xFF) - static_cast<int>((yuv_b >> 16) & 0xFF))
+	     + std::abs(static_cast<int>((yuv_a >> 8) & 0xFF) - static_cast<int>((yuv_b >> 8) & 0xFF))
+	     + std::abs(static_cast<int>(yuv_a & 0xFF) - static_cast<int>(yuv_b & 0xFF));
+}
+
+/* Mix weight eighths of b into a. */
+static inline uint32_t Blend(uint32_t a, uint32_t b, uint32_t weight) {
+
+	const uint32_t red_blue = (((a & 0xFF00FF) * (8 - weight) + (b & 0xFF00FF) * weight) >> 3) & 0xFF00FF;
+	const uint32_t green    = (((a & 0x00FF00) * (8 - weight) + (b & 0x00FF00) * weight) >> 3) & 0x00FF00;
+
+	return red_blue | green;
+}
+
+template<int Rotation>
+void XBRFilter::BlendCorner(const window_t& window, uint32_t* block) {
+
+	/* Offsets are written for the bottom right corner and turned to the one being worked on. */
+	auto turn_row    = [](int row, int column) { return Rotation == 0 ? row : Rotation == 1 ? -column : Rotation == 2 ? -row : column; };
+	auto turn_column = [](int row, int column) { return Rotation == 0 ? column : Rotation == 1 ? row : Rotation == 2 ? -column : -row; };
+
+	auto pixel = [&](int row, int column) { return window.pixels[2 + turn_row(row, column)][turn_column(row, column)]; };
+	auto yuv   = [&](int row, int column) { return window.yuv[2 + turn_row(row, column)][turn_column(row, column)]; };
+	auto sub_pixel = [&](int row, int column) -> uint32_t& { return block[(turn_row(row, column) > 0 ? 2 : 0) + (turn_column(row, column) > 0 ? 1 : 0)]; };
+
+	/*    A1 B1 C1
+	   A0 A  B  C  C4
+	   D0 D  E  F  F4
+	   G0 G  H  I  I4
+	      G5 H5 I5    */
+	const uint32_t e = pixel(0, 0), f = pixel(0, 1), h = pixel(1, 0);
+
+	if(e == h || e == f) {
+		return;
+	}
+
+	const uint32_t ye = yuv(0, 0), yf = yuv(0, 1), yh = yuv(1, 0), yi = yuv(1, 1);
+	const uint32_t yb = yuv(-1, 0), yc = yuv(-1, 1), yd = yuv(0, -1), yg = yuv(1, -1);
+	const uint32_t yf4 = yuv(0, 2), yi4 = yuv(1, 2), yh5 = yuv(2, 0), yi5 = yuv(2, 1);
+
+	/* Total color change across each diagonal, the edge runs along the smaller one. */
+	const uint32_t across_e = Difference(ye, yc) + Difference(ye, yg) + Difference(yi, yh5) + Difference(yi, yf4) + (Difference(yh, yf) << 2);
+	const uint32_t across_i = Difference(yh, yd) + Difference(yh, yi5) + Difference(yf, yi4) + Difference(yf, yb) + (Difference(ye, yi) << 2);
+
+	if(across_e > across_i) {
+		return;
+	}
+
+	auto equal = [](uint32_t a, uint32_t b) { return Difference(a, b) < EqualThreshold; };
+
+	const uint32_t blend_color = (Difference(ye, yf) <= Difference(ye, yh)) ? f : h;
+
+	uint32_t& corner = sub_pixel(1, 1);
+
+	if(across_e < across_i && ((!equal(yf, yb) && !equal(yh, yd)) || (equal(ye, yi) && !equal(yf, yi4) && !equal(yh, yi5)) || equal(ye, yg) || equal(ye, yc))) {
+		const uint32_t g = pixel(1, -1), c = pixel(-1, 1), d = pixel(0, -1), b = pixel(-1, 0);
+
+		/* Shallow edges also reach into the sub pixel beside the corner. */
+		const uint32_t slope_left = Difference(yf, yg);
+		const uint32_t slope_up   = Difference(yh, yc);
+
+		const bool left = (slope_left << 1) <= slope_up && e != g && d != g;
+		const bool up   = slope_left >= (slope_up << 1) && e != c && b != c;
+
+		uint32_t& beside_left = sub_pixel(1, -1);
+		uint32_t& beside_up   = sub_pixel(-1, 1);
+
+		if(left && up) {
+			corner = Blend(corner, blend_color, 7);
+			beside_left = Blend(beside_left, blend_color, 2);
+			beside_up = beside_left;
+		} else if(left) {
+			corner = Blend(corner, blend_color, 6);
+			beside_left = Blend(beside_left, blend_color, 2);
+		} else if(up) {
+			corner = Blend(corner, blend_color, 6);
+			beside_up = Blend(beside_up, blend_color, 2);
+		} else {
+			corner = Blend(corner, blend_color, 4);
+		}
+	} else {
+		corner = Blend(corner, blend_color, 4);
+	}
+}
+
+void XBRFilter::FilterRows(const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch) {
+
+	/* Rows are converted once into a ring of 5, and padded by repeating the edge pixels. */
+	uint32_t pixel_rows[5][PPU::ScreenWidth + Padding * 2];
+	uint32_t yuv_rows[5][PPU::ScreenWidth + Padding * 2];
+	int cached_rows[5] = { -1, -1, -1, -1, -1 };
+
+	for(uint16_t row = first_row; row < last_row; row++) {
+		window_t window;
+
+		for(int offset = -2; offset <= 2; offset++) {
+			const int source_row = std::min(std::max(row + offset, 0), PPU::ScreenHeight - 1);
+			const int slot = source_row % 5;
+
+			if(cached_rows[slot] != source_row) {
+				const uint32_t* source = &frame.pixels[source_row * PPU::ScreenWidth];
+
+				for(int x = -Padding; x < PPU::ScreenWidth + Padding; x++) {
+					const uint32_t pixel = source[std::min(std::max(x, 0), PPU::ScreenWidth - 1)];
+
+					pixel_rows[slot][x + Padding] = pixel;
+					yuv_rows[slot][x + Padding] = ToYUV(pixel);
+				}
+
+				cached_rows[slot] = source_row;
+			}
+
+			window.pixels[offset + 2] = &pixel_rows[slot][Padding];
+			window.yuv[offset + 2] = &yuv_rows[slot][Padding];
+		}
+
+		for(uint16_t x = 0; x < PPU::ScreenWidth; x++) {
+			uint32_t block[4];
+			block[0] = block[1] = block[2] = block[3] = window.pixels[2][0];
+
+			BlendCorner<0>(window, block);
+			BlendCorner<1>(window, block);
+			BlendCorner<2>(window, block);
+			BlendCorner<3>(window, block);
+
+			output[x * 2] = block[0];
+			output[x * 2 + 1] = block[1];
+			output[output_pitch + x * 2] = block[2];
+			output[output_pitch + x * 2 + 1] = block[3];
+
+			for(uint8_t i = 0; i < 5; i++) {
+				window.pixels[i]++;
+				window.yuv[i]++;
+			}
+		}
+
+		output += output_pitch * 2;
+	}
+}
\ No newline at end of file
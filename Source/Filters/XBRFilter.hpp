@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __XBR_FILTER_HPP__
+#define __XBR_FILTER_HPP__
+
+#include <cstdint>
+
+#include "../NES/PPU.hpp"
+#include "VideoFilter.hpp"
+
+/**
+ * 2xBR, Hyllian's xBR scaler at level 1.
+ *
+ * Each corner of a pixel looks at the 5x5 area around it, weighs the color differences along the two diagonals to find
+ * which way an edge runs, and blends the corner (and for shallow edges one of its neighbours) towards the color across the edge.
+ * Differences are measured in YUV, worked out once per row rather than once per comparison.
+ */
+class XBRFilter : public VideoFilter {
+
+	public:
+		XBRFilter();
+		~XBRFilter();
+
+		const char* GetName() { return "xbr2x"; };
+
+		uint16_t GetOutputWidth() { return PPU::ScreenWidth * 2; };
+		uint16_t GetOutputHeight() { return PPU::ScreenHeight * 2; };
+		uint8_t GetRowReach() { return 2; };
+
+		void FilterRows(const video_frame_t& frame, uint16_t first_row, uint16_t last_row, uint32_t* output, size_t output_pitch);
+
+	private:
+		/* Pixels and their YUV for the 5 rows around the one being filtered, each pointing at the current column. */
+		typedef struct window {
+			const uint32_t* pixels[5];
+			const uint32_t* yuv[5];
+		} window_t;
+
+		/* Blend one corner of the 2x2 block in block. Rotation turns the window a quarter turn at a time, so one rule covers all four corners. */
+		template<int Rotation>
+		static void BlendCorner(const window_t& window, uint32_t* block);
+
+		/* Packed 8 bit Y, U and V of an ARGB8888 pixel. */
+		static uint32_t ToYUV(uint32_t pixel);
+
+		/* Sum of absolute Y, U and V differences. Colors closer than EqualThreshold count as the same. */
+		static uint32_t Difference(uint32_t yuv_a, uint32_t yuv_b);
+		static const uint32_t EqualThreshold { 155 };
+
+		/* Padding on either side of each row, so the window never needs clamping at the edges. */
+		static const uint16_t Padding { 2 };
+};
+
+#endif /* __XBR_FILTER_HPP__ */
\ No newline at end of file
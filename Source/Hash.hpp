@@ -0,0 +1,137 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __HASH_HPP__
+#define __HASH_HPP__
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+/* Fast non-cryptographic 64-bit hash of a buffer, used to compare frames and emulator state between runs.
+   Four independent lanes are mixed 32 bytes at a time so the multiplies overlap (or vectorize), and are combined at the end. */
+inline uint64_t Hash64(const void* data, size_t size) {
+
+	const uint64_t prime1 = 0x9E3779B185EBCA87;
+	const uint64_t prime2 = 0xC2B2AE3D27D4EB4F;
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	uint64_t lanes[4] = { prime1 + prime2, prime2, 0, 0 - prime1 };
+
+	size_t offset = 0;
+
+	for(; offset + 32 <= size; offset += 32) {
+		uint64_t words[4];
+		std::memcpy(words, bytes + offset, sizeof(words));
+
+		for(int i = 0; i < 4; i++) {
+			lanes[i] += words[i] * prime2;
+			lanes[i] = (lanes[i] << 31) | (lanes[i] >> 33);
+			lanes[i] *= prime1;
+		}
+	}
+
+	uint64_t hash = ((lanes[0] << 1) | (lanes[0] >> 63)) + ((lanes[1] << 7) | (lanes[1] >> 57)) + ((lanes[2] << 12) | (lanes[2] >> 52)) + ((lanes[3] << 18) | (lanes[3] >> 46));
+
+	hash += size;
+
+	/* Leftover bytes. */
+	for(; offset < size; offset++) {
+		hash ^= bytes[offset] * prime1;
+		hash = ((hash << 11) | (hash >> 53)) * prime2;
+	}
+
+	/* Final avalanche, so every input bit affects every output bit. */
+	hash ^= hash >> 33;
+	hash *= prime2;
+	hash ^= hash >> 29;
+	hash *= prime1;
+	hash ^= hash >> 32;
+
+	return hash;
+}
+
+/* Tables for the CRC32 below. Table 0 is the usual byte at a time table, and table n gives the CRC of a byte followed by
+   n zero bytes, so eight bytes can be looked up at once and XORed together (slicing-by-8). */
+inline constexpr std::array<std::array<uint32_t, 256>, 8> CRC32Tables = [] {
+
+	std::array<std::array<uint32_t, 256>, 8> tables {};
+
+	for(uint32_t i = 0; i < 256; i++) {
+		uint32_t crc = i;
+
+		for(int bit = 0; bit < 8; bit++) {
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+		}
+
+		tables[0][i] = crc;
+	}
+
+	for(int table = 1; table < 8; table++) {
+		for(uint32_t i = 0; i < 256; i++) {
+			tables[table][i] = (tables[table - 1][i] >> 8) ^ tables[0][tables[table - 1][i] & 0xFF];
+		}
+	}
+
+	return tables;
+}();
+
+/* Standard (zlib) CRC32 of a buffer, which is what ROM databases are keyed by. ARM's CRC32 instructions use the same
+   polynomial, but x86's crc32 instruction computes CRC32C, so x86 uses the tables, which still run at several GB/s. */
+inline uint32_t CRC32(const void* data, size_t size, uint32_t crc = 0) {
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	crc = ~crc;
+
+#if defined(__ARM_FEATURE_CRC32)
+	for(; size >= 8; bytes += 8, size -= 8) {
+		uint64_t word;
+		std::memcpy(&word, bytes, sizeof(word));
+		crc = __crc32d(crc, word);
+	}
+#else
+	if constexpr(std::endian::native == std::endian::little) {
+		for(; size >= 8; bytes += 8, size -= 8) {
+			uint64_t word;
+			std::memcpy(&word, bytes, sizeof(word));
+			word ^= crc;
+
+			crc = CRC32Tables[7][word & 0xFF] ^ CRC32Tables[6][(word >> 8) & 0xFF] ^ CRC32Tables[5][(word >> 16) & 0xFF] ^ CRC32Tables[4][(word >> 24) & 0xFF] ^
+			      CRC32Tables[3][(word >> 32) & 0xFF] ^ CRC32Tables[2][(word >> 40) & 0xFF] ^ CRC32Tables[1][(word >> 48) & 0xFF] ^ CRC32Tables[0][word >> 56];
+		}
+	}
+#endif
+
+	for(; size > 0; bytes++, size--) {
+		crc = (crc >> 8) ^ CRC32Tables[0][(crc ^ *bytes) & 0xFF];
+	}
+
+	return ~crc;
+}
+
+#endif /* __HASH_HPP__ */
\ No newline at end of file
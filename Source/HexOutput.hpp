@@ -25,6 +25,7 @@
 
 #define HEX(x) "0x" << std::setfill('0') << std::setw(4) << std::hex << std::uppercase << unsigned(x) << std::dec << std::nouppercase
 
+#define HEX8(x) "0x" << std::setfill('0') << std::setw(8) << std::hex << std::uppercase << unsigned(static_cast<uint32_t>(x)) << std::dec << std::nouppercase
 #define HEX4(x) "0x" << std::setfill('0') << std::setw(4) << std::hex << std::uppercase << unsigned(static_cast<uint16_t>(x)) << std::dec << std::nouppercase
 #define HEX2(x) "0x" << std::setfill('0') << std::setw(2) << std::hex << std::uppercase << unsigned(static_cast<uint8_t>(x)) << std::dec << std::nouppercase
 
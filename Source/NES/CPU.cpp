@@ -50,6 +50,10 @@ void CPU::Initialize() {
 		cpu_memory[i] = 0x00;
 	}
 
+	/* The mapper keeps these tables up to date as it switches banks. */
+	prg_slots = nes_system->GetCartridge()->GetMapper()->GetPRGSlots();
+	prg_write_slots = nes_system->GetCartridge()->GetMapper()->GetPRGWriteSlots();
+
 	halted = false;
 	illegal_opcode_triggered = false;
 	halt_on_illegal_opcode = false;
@@ -66,18 +70,15 @@ void CPU::Shutdown() {
 
 void CPU::Reset(bool hard) {
 
-	vector_nmi  = Read(0xFFFA);
-	vector_nmi += Read(0xFFFB) << 8;
-
-	vector_rst  = Read(0xFFFC);
-	vector_rst += Read(0xFFFD) << 8;
-
-	vector_irq  = Read(0xFFFE);
-	vector_irq += Read(0xFFFF) << 8;
-
-	program_counter = vector_rst;
+	program_counter  = Read(0xFFFC);
+	program_counter += Read(0xFFFD) << 8;
 	increment_pc = true;
 
+	nmi_pending = false;
+	poll_cycles_skipped = 0;
+	ppu_data_writes_batched = 0;
+	ppu_data_reads_batched = 0;
+
 	/* Status register starts with IRQ interrupts disabled (NMI still fires). */
 	register_p = 0x24;
 	register_a = 0;
@@ -85,10 +86,11 @@ void CPU::Reset(bool hard) {
 	register_y = 0;
 	register_s = 0xFD;
 
+	/* Mappers can switch the vectors out later, these are only the ones in place at reset. */
 	std::cout << "Vectors:" << std::endl;
-	std::cout << "  NMI: " << HEX4(vector_nmi) << std::endl;
-	std::cout << "  IRQ: " << HEX4(vector_irq) << std::endl;
-	std::cout << "  RST: " << HEX4(vector_rst) << std::endl;
+	std::cout << "  NMI: " << HEX4(Read(0xFFFA) | Read(0xFFFB) << 8) << std::endl;
+	std::cout << "  IRQ: " << HEX4(Read(0xFFFE) | Read(0xFFFF) << 8) << std::endl;
+	std::cout << "  RST: " << HEX4(program_counter) << std::endl;
 
 	/* Cycles always start at 7 on reset due to dummy reads/stack pushes. */
 	cycles = 7;
@@ -106,6 +108,7 @@ uint8_t CPU::Read(uint16_t address) {
 	else if(address == 0x4015)                      { value = nes_system->GetAPU()->ReadCPU(address); }                       /* APU. */
 	else if(address >= 0x4016 && address <= 0x4017) { value = nes_system->GetControllerIO()->ReadIO(address); }               /* I/O. */
 	else if(address >= 0x4018 && address <= 0x401F) { value = nes_system->GetAPU()->ReadCPU(address); }                       /* APU. */
+	else if(address >= 0x6000 && prg_slots[(address >> 13) - 3] != nullptr) { value = prg_slots[(address >> 13) - 3][address & 0x1FFF]; } /* Cartridge PRG slots. */
 	else if(address >= 0x4020 && address <= 0xFFFF) { value = nes_system->GetCartridge()->GetMapper()->ReadCPU(address); }    /* Cartridge Memory Space */
 	else {
 		value = nes_system->GetFloatingBus();
@@ -126,6 +129,7 @@ void CPU::Write(uint16_t address, uint8_t value) {
 	else if(address == 0x4015)                      { nes_system->GetAPU()->WriteCPU(address, value); return; }                    /* APU. */
 	else if(address == 0x4016)                      { nes_system->GetControllerIO()->WriteIO(address, value); return; }            /* I/O. */
 	else if(address >= 0x4017 && address <= 0x401F) { nes_system->GetAPU()->WriteCPU(address, value); return; }                    /* APU. */
+	else if(address >= 0x6000 && prg_write_slots[(address >> 13) - 3] != nullptr) { prg_write_slots[(address >> 13) - 3][address & 0x1FFF] = value; return; } /* Cartridge PRG RAM slots. */
 	else if(address >= 0x4020 && address <= 0xFFFF) { nes_system->GetCartridge()->GetMapper()->WriteCPU(address, value); return; } /* Cartridge Memory Space */
 
 	return;
@@ -143,6 +147,7 @@ uint8_t CPU::PeekMemory(uint16_t address) {
 	else if(address == 0x4015)                      { value = nes_system->GetAPU()->ReadCPU(address); }                       /* APU. */
 	else if(address >= 0x4016 && address <= 0x4017) { value = nes_system->GetControllerIO()->ReadIO(address); }               /* I/O. */
 	else if(address >= 0x4018 && address <= 0x401F) { value = nes_system->GetAPU()->ReadCPU(address); }                       /* APU. */
+	else if(address >= 0x6000 && prg_slots[(address >> 13) - 3] != nullptr) { value = prg_slots[(address >> 13) - 3][address & 0x1FFF]; } /* Cartridge PRG slots. */
 	else if(address >= 0x4020 && address <= 0xFFFF) { value = nes_system->GetCartridge()->GetMapper()->ReadCPU(address); }    /* Cartridge Memory Space */
 	else {
 		value = nes_system->GetFloatingBus();
@@ -205,19 +210,279 @@ void CPU::Interrupt(interrupt_type_t interrupt_type) {
 	/* Set interrupt disable flag. */
 	BitSet(register_p, STATUS_BIT_INTERRUPT_DISABLE);
 
+	/* Vectors are fetched now, through whatever banks the mapper has switched in. */
 	switch(interrupt_type) {
 		case INTERRUPT_NMI:
-			program_counter = vector_nmi;
+			program_counter  = Read(0xFFFA);
+			program_counter += Read(0xFFFB) << 8;
 			break;
+		case INTERRUPT_IRQ:
 		case INTERRUPT_BRK:
-			program_counter = vector_irq;
+			program_counter  = Read(0xFFFE);
+			program_counter += Read(0xFFFF) << 8;
 		default:
 			break;
 	}
 }
 
+void CPU::RequestInterrupt(interrupt_type_t interrupt_type) {
+
+	switch(interrupt_type) {
+		case INTERRUPT_NMI:
+			nmi_pending = true;
+			break;
+		default:
+			/* IRQ is a level, see SetIRQLine. */
+			break;
+	}
+}
+
+void CPU::SetIRQLine(irq_source_t source, bool asserted) {
+
+	if(asserted) {
+		irq_sources |= source;
+	} else {
+		irq_sources &= ~source;
+	}
+}
+
+void CPU::SkipStatusPoll() {
+
+	/* Only peek at loops in RAM or cartridge space, peeking I/O registers could still have side effects. */
+	if(program_counter >= 0x2000 && program_counter < 0x4020) {
+		return;
+	}
+
+	const uint16_t address = PeekMemory(program_counter + 1) | (PeekMemory(program_counter + 2) << 8);
+
+	/* PPUSTATUS, or one of its mirrors. */
+	if((address & 0xE007) != 0x2002) {
+		return;
+	}
+
+	uint8_t loop_cycles = 0;
+	uint16_t branch_address = 0;
+
+	if(instruction == 0x2C && PeekMemory(program_counter + 3) == 0x50 && PeekMemory(program_counter + 4) == 0xFB) {
+		/* BIT PPUSTATUS / BVC back to the BIT. */
+		loop_cycles = cycle_sizes[0x2C] + cycle_sizes[0x50] + 1;
+		branch_address = program_counter + 4;
+	} else if(instruction == 0xAD && PeekMemory(program_counter + 3) == 0x29 && PeekMemory(program_counter + 4) == 0x40 && PeekMemory(program_counter + 5) == 0xF0 && PeekMemory(program_counter + 6) == 0xF9) {
+		/* LDA PPUSTATUS / AND #$40 / BEQ back to the LDA. */
+		loop_cycles = cycle_sizes[0xAD] + cycle_sizes[0x29] + cycle_sizes[0xF0] + 1;
+		branch_address = program_counter + 6;
+	} else {
+		return;
+	}
+
+	/* The taken branch costs the same page crossing cycle the branch instructions charge. */
+	if((branch_address & 0xFF00) != ((program_counter - 1) & 0xFF00)) {
+		loop_cycles++;
+	}
+
+	/* Skipped iterations would all have read the flag clear, leaving registers exactly as the final iteration will. */
+	const uint64_t skipped = nes_system->GetSpriteZeroPollSkip(cycles, loop_cycles);
+
+	cycles += skipped;
+	poll_cycles_skipped += skipped;
+}
+
+bool CPU::StreamPPUData() {
+
+	/* Like SkipStatusPoll, never peek at I/O registers, which includes the end of a loop running into them from RAM. */
+	if(program_counter >= 0x1FF0 && program_counter < 0x4020) {
+		return false;
+	}
+
+	/* Loops look like
+	     LDA a,X / LDA a,Y / LDA (d),Y / TXA / TYA, STA PPUDATA    or    LDA PPUDATA, STA a,X / STA a,Y
+	   followed by INX/INY, an optional CPX/CPY #n and a BNE back to the start. */
+	const uint16_t start = program_counter;
+	uint16_t length = 0;
+	uint16_t base = 0;
+	uint8_t body_cycles = cycle_sizes[instruction];
+	bool index_y = false;
+	bool reading = false;
+	bool from_register = false;
+
+	switch(instruction) {
+		case 0xBD:
+		case 0xB9:
+			if(PeekMemory(start + 3) != 0x8D) {
+				return false;
+			}
+			base = PeekMemory(start + 1) | (PeekMemory(start + 2) << 8);
+			index_y = (instruction == 0xB9);
+			length = 3;
+			break;
+		case 0xB1: {
+			if(PeekMemory(start + 2) != 0x8D) {
+				return false;
+			}
+			const uint8_t pointer = PeekMemory(start + 1);
+			base = PeekMemory(pointer) | (PeekMemory(static_cast<uint8_t>(pointer + 1)) << 8);
+			index_y = true;
+			length = 2;
+			break;
+		}
+		case 0x8A:
+		case 0x98:
+			index_y = (instruction == 0x98);
+			from_register = true;
+			length = 1;
+			break;
+		case 0xAD: {
+			const uint8_t store = PeekMemory(start + 3);
+			if((store != 0x9D && store != 0x99) || ((PeekMemory(start + 1) | (PeekMemory(start + 2) << 8)) & 0xE007) != 0x2007) {
+				return false;
+			}
+			base = PeekMemory(start + 4) | (PeekMemory(start + 5) << 8);
+			index_y = (store == 0x99);
+			reading = true;
+			body_cycles += cycle_sizes[store];
+			length = 6;
+			break;
+		}
+	}
+
+	if(!reading) {
+		if(PeekMemory(start + length) != 0x8D || ((PeekMemory(start + length + 1) | (PeekMemory(start + length + 2) << 8)) & 0xE007) != 0x2007) {
+			return false;
+		}
+		body_cycles += cycle_sizes[0x8D];
+		length += 3;
+	}
+
+	const uint8_t increment = index_y ? 0xC8 : 0xE8;
+	const uint8_t compare = index_y ? 0xC0 : 0xE0;
+
+	if(PeekMemory(start + length) != increment) {
+		return false;
+	}
+	body_cycles += cycle_sizes[increment];
+	length++;
+
+	/* Without a compare the loop ends when the index wraps around to 0. */
+	bool has_compare = false;
+	uint8_t limit = 0;
+
+	if(PeekMemory(start + length) == compare) {
+		has_compare = true;
+		limit = PeekMemory(start + length + 1);
+		body_cycles += cycle_sizes[compare];
+		length += 2;
+	}
+
+	const uint16_t branch_address = start + length;
+
+	if(PeekMemory(branch_address) != 0xD0 || static_cast<int8_t>(PeekMemory(branch_address + 1)) != -static_cast<int16_t>(length + 2)) {
+		return false;
+	}
+	body_cycles += cycle_sizes[0xD0];
+	length += 2;
+
+	/* Taken branches cost a cycle, and another for the same page crossing the branch instructions charge. */
+	uint8_t loop_cycles = body_cycles + 1;
+	if(((branch_address + 1) & 0xFF00) != ((start - 1) & 0xFF00)) {
+		loop_cycles++;
+	}
+
+	const uint8_t index = index_y ? register_y : register_x;
+	const uint16_t iterations = static_cast<uint8_t>(limit - index - 1) + 1;
+
+	/* Every iteration has to finish inside the window where nothing but VRAM notices PPUDATA accesses. */
+	nes_system->SyncPPU();
+	const uint64_t window_end = nes_system->GetPPU()->GetDataStreamWindowEnd();
+
+	uint8_t values[0x100];
+	uint16_t count = 0;
+	uint64_t end_cycle = cycles;
+
+	while(count < iterations) {
+		const uint64_t iteration_end = end_cycle + ((count == iterations - 1) ? body_cycles : loop_cycles);
+		if(nes_system->CPUCyclesToPPUCycles(iteration_end) >= window_end) {
+			break;
+		}
+
+		const uint16_t address = base + static_cast<uint8_t>(index + count);
+
+		if(reading) {
+			/* Stores have to land in internal RAM, anywhere else could be a register. */
+			if(address >= 0x2000) {
+				break;
+			}
+		} else if(from_register) {
+			values[count] = static_cast<uint8_t>(index + count);
+		} else {
+			const uint8_t* page = GetMemoryPage(address & 0xFF00);
+			if(page == nullptr) {
+				break;
+			}
+			values[count] = page[address & 0xFF];
+		}
+
+		end_cycle = iteration_end;
+		count++;
+	}
+
+	if(count == 0) {
+		return false;
+	}
+
+	if(reading) {
+		nes_system->GetPPU()->ReadDataBlock(values, count);
+		for(uint16_t i = 0; i < count; i++) {
+			cpu_memory[static_cast<uint16_t>(base + static_cast<uint8_t>(index + i)) & 0x7FF] = values[i];
+		}
+		ppu_data_reads_batched += count;
+	} else {
+		nes_system->GetPPU()->WriteDataBlock(values, count);
+		ppu_data_writes_batched += count;
+	}
+
+	/* Leave the CPU exactly as the last iteration run would have. */
+	const uint8_t new_index = static_cast<uint8_t>(index + count);
+
+	if(index_y) {
+		register_y = new_index;
+	} else {
+		register_x = new_index;
+	}
+
+	register_a = values[count - 1];
+
+	if(has_compare) {
+		SetFlag(STATUS_BIT_CARRY, new_index >= limit);
+		UpdateZeroNegative(static_cast<uint8_t>(new_index - limit));
+	} else {
+		UpdateZeroNegative(new_index);
+	}
+
+	program_counter = (count == iterations) ? start + length : start;
+	cycles = end_cycle;
+	nes_system->SetFloatingBus(PeekMemory(branch_address + 1));
+
+	return true;
+}
+
+const uint8_t* CPU::GetMemoryPage(uint16_t page_address) {
+
+	if(page_address <= 0x1FFF) {
+		return &cpu_memory[page_address & 0x7FF];
+	}
+
+	if(page_address >= 0x6000 && prg_slots[(page_address >> 13) - 3] != nullptr) {
+		return &prg_slots[(page_address >> 13) - 3][page_address & 0x1FFF];
+	}
+
+	return nullptr;
+}
+
 void CPU::PerformOAMDMA(uint8_t value) {
-	
+
+	/* OAM is about to change underneath the PPU. */
+	nes_system->SyncPPU();
+
 	/* Check to see if on even or odd CPU cycle. */
 	if(cycles % 2 != 0) {
 		cycles++;
@@ -228,6 +493,16 @@ void CPU::PerformOAMDMA(uint8_t value) {
 
 	const uint16_t oam_dma_page = 0x0100 * value;
 
+	/* Internal RAM and cartridge ROM/RAM are copied in one go, only pages with registers need reading a byte at a time. */
+	const uint8_t* source = GetMemoryPage(oam_dma_page);
+
+	if(source != nullptr) {
+		nes_system->GetPPU()->WriteOAMPage(source);
+		nes_system->SetFloatingBus(source[0xFF]);
+		cycles += 512;
+		return;
+	}
+
 	// 256 Alternating Read/Write cycles.
 	for(uint16_t i = 0; i < 256; i++) {
 		nes_system->GetPPU()->WriteOAM(Read(oam_dma_page + i));
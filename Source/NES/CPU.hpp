@@ -44,6 +44,11 @@ typedef enum interrupt_type {
 	INTERRUPT_BRK
 } interrupt_type_t;
 
+/* Devices that can pull the shared IRQ line low. The line stays asserted until every source has let go of it. */
+typedef enum irq_source {
+	IRQ_SOURCE_MAPPER = 0x01
+} irq_source_t;
+
 typedef enum addressing_mode {
 	IMP,
 	ACU,
@@ -105,6 +110,13 @@ class CPU {
 
 		void Interrupt(interrupt_type_t interrupt_type);
 
+		/* Signal an interrupt line, serviced before the next instruction is executed. */
+		void RequestInterrupt(interrupt_type_t interrupt_type);
+
+		/* Assert or release the IRQ line for one source. IRQ is level triggered, it is taken before every instruction while
+		   asserted and the I flag is clear. */
+		void SetIRQLine(irq_source_t source, bool asserted);
+
 		void PerformOAMDMA(uint8_t value);
 
 		uint16_t GetProgramCounter() { return program_counter; };
@@ -117,9 +129,17 @@ class CPU {
 		void SetProgramCounter(uint16_t value) { program_counter = value; };
 
 		bool IsInTestMode() { return test_mode; };
+		bool IsHalted() { return halted; };
 
 		uint64_t CycleCount() { return cycles; };
 
+		/* CPU cycles fast forwarded through PPUSTATUS polling loops. */
+		uint64_t PollCyclesSkipped() { return poll_cycles_skipped; };
+
+		/* PPUDATA writes and reads applied in bulk by StreamPPUData. */
+		uint64_t PPUDataWritesBatched() { return ppu_data_writes_batched; };
+		uint64_t PPUDataReadsBatched() { return ppu_data_reads_batched; };
+
 	private:
 		/* Updates CPU flags based on input value. */
 		void UpdateZeroNegative(uint8_t value) {
@@ -135,6 +155,15 @@ class CPU {
 			}
 		}
 
+		/* Fast forward a loop polling PPUSTATUS for sprite 0 hit to the iteration that sees it. */
+		void SkipStatusPoll();
+
+		/* Run a loop copying memory to or from PPUDATA as far as VBlank allows, returns false if there is no such loop here. */
+		bool StreamPPUData();
+
+		/* Direct pointer to a 256 byte page of internal RAM or cartridge memory, nullptr if reading it could have side effects. */
+		const uint8_t* GetMemoryPage(uint16_t page_address);
+
 		/* Sets a specified bit in the flag register to the value of condition. */
 		void SetFlag(uint8_t flag_bit, bool condition) {
 			if(condition) {
@@ -148,10 +177,9 @@ class CPU {
 
 		uint8_t cpu_memory[0x800] { 0 };
 
-		/* Vectors */
-		uint16_t vector_nmi { 0 };
-		uint16_t vector_irq { 0 };
-		uint16_t vector_rst { 0 };
+		/* The mapper's PRG slots for 0x6000 - 0xFFFF, see Mapper::GetPRGSlots. */
+		const uint8_t* const* prg_slots { nullptr };
+		uint8_t* const* prg_write_slots { nullptr };
 
 		/* CPU registers */
 		uint16_t program_counter { 0 };
@@ -182,7 +210,16 @@ class CPU {
 
 		bool test_mode { false };
 
+		/* NMI signalled by the PPU, waiting for the current instruction to finish. */
+		bool nmi_pending { false };
+
+		/* irq_source_t bits of the sources currently asserting IRQ. */
+		uint8_t irq_sources { 0 };
+
 		uint64_t cycles { 0 };
+		uint64_t poll_cycles_skipped { 0 };
+		uint64_t ppu_data_writes_batched { 0 };
+		uint64_t ppu_data_reads_batched { 0 };
 
 		/* Associates instruction byte with instruction names. */
 		std::string instruction_names[0x100] = {
@@ -34,8 +34,35 @@ void CPU::Step() {
 		return;
 	}
 
+	/* Service interrupts raised while the last instruction was executing. */
+	if(nmi_pending) {
+		nmi_pending = false;
+		Interrupt(INTERRUPT_NMI);
+		cycles += 7;
+		return;
+	}
+
+	/* IRQ is held until the device acknowledges it, so it is taken again after RTI unless the handler did that. */
+	if(irq_sources != 0 && !BitCheck(register_p, STATUS_BIT_INTERRUPT_DISABLE)) {
+		Interrupt(INTERRUPT_IRQ);
+		cycles += 7;
+		return;
+	}
+
 	instruction = Read(program_counter);
 
+	/* BIT/LDA absolute, possibly the start of a PPUSTATUS polling loop. */
+	if(instruction == 0x2C || instruction == 0xAD) {
+		SkipStatusPoll();
+	}
+
+	/* Loads that can start a loop streaming data through PPUDATA. */
+	if(instruction == 0xBD || instruction == 0xB9 || instruction == 0xB1 || instruction == 0x8A || instruction == 0x98 || instruction == 0xAD) {
+		if(StreamPPUData()) {
+			return;
+		}
+	}
+
 	uint16_t old_pc = 0;
 	uint8_t result = 0;
 	uint16_t result16 = 0;
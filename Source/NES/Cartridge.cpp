@@ -18,19 +18,36 @@
  * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <bitset>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <string>
-
+#include <string_view>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "../BitOps.hpp"
+#include "../Hash.hpp"
 #include "../HexOutput.hpp"
 
 #include "./Mappers/Mapper.hpp"
-#include "./Mappers/MapperMMC1.hpp"
-#include "./Mappers/MapperMMC5.hpp"
-#include "./Mappers/MapperNROM.hpp"
 #include "iNESHeader.hpp"
 #include "Cartridge.hpp"
+#include "NESSystem.hpp"
+#include "PPU.hpp"
+#include "ROMDatabase.hpp"
 #include "UNIFHeader.hpp"
 
 Cartridge::Cartridge(NESSystem* nes_system) : nes_system(nes_system) {
@@ -43,6 +60,9 @@ Cartridge::Cartridge(NESSystem* nes_system) : nes_system(nes_system) {
 }
 
 Cartridge::~Cartridge() {
+	UnmapSaveFile();
+	UnmapFile();
+
 	prg_rom_size = 0;
 	prg_ram_size = 0;
 	chr_rom_size = 0;
@@ -52,7 +72,7 @@ Cartridge::~Cartridge() {
 }
 
 void Cartridge::Initialize() {
-	header = new iNES_header_t;
+	header = new iNES_header_t {};
 	header_unif = new unif_header_t;
 }
 
@@ -64,29 +84,37 @@ void Cartridge::Shutdown() {
 void Cartridge::OpenFile(std::string file_name) {
 	this->file_name = file_name;
 
-	std::ifstream file(file_name, std::ios::ate | std::ios::binary);
+	if(!MapFile()) {
+		std::ifstream file(file_name, std::ios::ate | std::ios::binary);
 
-	if(!file.is_open()) {
-		std::cout << "Failed to open file \"" << file_name << "\"." << std::endl;
-		abort();
-	}
+		if(!file.is_open()) {
+			std::cout << "Failed to open file \"" << file_name << "\"." << std::endl;
+			abort();
+		}
+
+		size_t file_size = file.tellg();
+		file_buffer.resize(file_size);
 
-	size_t file_size = file.tellg();
-	file_memory.resize(file_size);
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(file_buffer.data()), file_size);
+		file.close();
 
-	file.seekg(0);
-	file.read(file_memory.data(), file_size);
-	file.close();
+		file_memory = file_buffer;
+	}
 
-	std::cout << "Successfully opened \"" << file_name << "\" (" << file_size << " bytes)..." << std::endl;
+	std::cout << "Successfully opened \"" << file_name << "\" (" << file_memory.size() << " bytes)..." << std::endl;
 
-	/* Test for iNES header. */
-	if(file_memory.at(0) == 'N' || file_memory.at(1) == 'E' || file_memory.at(2) == 'S' || file_memory.at(3) == 0x1A) {
+	if(file_memory.size() < 16) {
+		std::cout << "Opened non-ROM file." << std::endl;
+		loaded = false;
+		return;
+	}
 
-		/* Grab 7th byte to determine iNES 1.0/2.0 */
-		std::bitset<8> byte7(file_memory.at(7));
+	/* Test for iNES header. */
+	if(file_memory[0] == 'N' && file_memory[1] == 'E' && file_memory[2] == 'S' && file_memory[3] == 0x1A) {
 
-		if(byte7.test(2) == 1 && byte7.test(3) == 1) {
+		/* NES 2.0 headers have 10 in bits 2-3 of byte 7. */
+		if((file_memory[7] & 0x0C) == 0x08) {
 			std::cout << "iNES 2.0 ROM." << std::endl;
 			header->is_iNES2 = true;
 			header_type = HEADER_TYPE_INES2;
@@ -104,7 +132,8 @@ void Cartridge::OpenFile(std::string file_name) {
 	}
 	
 	/* Test for UNIF header. */
-	if(file_memory.at(0) == 'U' || file_memory.at(1) == 'N' || file_memory.at(2) == 'I' || file_memory.at(3) == 'F') {
+	if(file_memory.size() >= sizeof(unif_header_t) && file_memory[0] == 'U' && file_memory[1] == 'N' && file_memory[2] == 'I' && file_memory[3] == 'F') {
+		header->is_iNES2 = false;
 		header_type = HEADER_TYPE_UNIF;
 		OpenUNIF();
 		loaded = true;
@@ -122,17 +151,27 @@ void Cartridge::OpeniNES() {
 	}
 
 	/* Grab data from memory. */
-	header->prg_rom_size = file_memory.at(4);
-	header->chr_rom_size = file_memory.at(5);
-	header->flags1       = file_memory.at(6);
-	header->flags2       = file_memory.at(7);
-	header->prg_ram_size = file_memory.at(8);
-	header->flags3       = file_memory.at(9);
-	header->flags4       = file_memory.at(10);
-
-	/* If CHR ROM size was zero, the game uses CHR RAM instead. */
+	header->prg_rom_size = file_memory[4];
+	header->chr_rom_size = file_memory[5];
+	header->flags1       = file_memory[6];
+	header->flags2       = file_memory[7];
+	header->prg_ram_size = file_memory[8];
+	header->flags3       = file_memory[9];
+	header->flags4       = file_memory[10];
+
+	/* Old dumping tools left their name in bytes 7-15 ("DiskDude!"), which would give a mapper number over 63. Bytes 11-15
+	   are always zero in a good iNES 1.0 header. */
+	if(file_memory[11] != 0 || file_memory[12] != 0 || file_memory[13] != 0 || file_memory[14] != 0 || file_memory[15] != 0) {
+		std::cout << "ROM header has junk in bytes 7-15, ignoring them." << std::endl;
+		header->flags2 = 0;
+		header->prg_ram_size = 0;
+		header->flags3 = 0;
+		header->flags4 = 0;
+	}
+
+	/* If CHR ROM size was zero, the game uses 8KB of CHR RAM instead. */
 	if(header->chr_rom_size == 0) {
-		header->chr_ram_size = 8;
+		header->chr_ram_size = 1;
 	} else {
 		header->chr_ram_size = 0;
 	}
@@ -142,7 +181,11 @@ void Cartridge::OpeniNES() {
 		header->prg_ram_size = 1;
 	}
 
-	uint16_t mapper_number = (header->flags1 >> 4) + (header->flags2 & 0xF0);
+	header->mapper_number = (header->flags1 >> 4) | (header->flags2 & 0xF0);
+	header->mapper_variant = 0;
+
+	/* Known dumps take their board from the database instead, as these headers are so often wrong. */
+	CorrectHeader();
 
 	std::cout << "PRG ROM Size: " << +header->prg_rom_size * 16 << " KB" << std::endl;
 	std::cout << "CHR ROM Size: " << +header->chr_rom_size * 8  << " KB" << std::endl;
@@ -154,16 +197,335 @@ void Cartridge::OpeniNES() {
 	chr_rom_size = header->chr_rom_size * 0x2000;
 	chr_ram_size = header->chr_ram_size * 0x2000;
 
+	/* The header can only say there's a battery, so it backs all the PRG RAM. The database knows better. */
+	if(!in_database) {
+		prg_nvram_size = BitCheck(header->flags1, 1) ? prg_ram_size : 0;
+	}
+
+	ApplyHeaderFlags();
+	LocateROM();
+
+	std::bitset<8> flags_7(header->flags2);
+
+	if(flags_7.test(0) == 1) {
+		std::cout << "ROM is for the VS Unisystem." << std::endl;
+	}
+
+	if(flags_7.test(1) == 1) {
+		std::cout << "ROM is for the Playchoice-10 (8KB of Hint Screen data is after CHR data)." << std::endl;
+	}
+
+	/* The TV system bit in byte 9 is rarely set, so the console is only configured from the database. */
+	if(in_database) {
+		ConfigureConsole();
+	}
+
+	mapper = DetermineMapper(header);
+	mapper->Initialize(this);
+
+	std::cout << "ROM is using mapper \"" << mapper->GetName() << "\" (Number: " << +mapper->GetNumber() << " Variant: " << +mapper->GetVariant() << " )." << std::endl;
+}
+
+/* NES 2.0 ROM sizes are a 12-bit count of units, or with the upper nibble all set, 2^E * (M * 2 + 1) bytes from the lower
+   byte EEEEEEMM. */
+static uint64_t NES2ROMSize(uint8_t lower, uint8_t upper, uint32_t unit) {
+
+	if(upper == 0x0F) {
+		const uint8_t exponent = lower >> 2;
+
+		/* Nothing that big fits in a file anyway. */
+		if(exponent >= 48) {
+			return UINT64_MAX;
+		}
+
+		return (uint64_t(1) << exponent) * ((lower & 0x03) * 2 + 1);
+	}
+
+	return uint64_t((upper << 8) | lower) * unit;
+}
+
+/* NES 2.0 RAM sizes are shift counts, 64 << n bytes, or none for 0. */
+static uint32_t NES2RAMSize(uint8_t shift) {
+	return shift == 0 ? 0 : 64 << shift;
+}
+
+void Cartridge::OpeniNES2() {
+	if(!header->is_iNES2) {
+		return;
+	}
+
+	header->prg_rom_size        = file_memory[4];
+	header->chr_rom_size        = file_memory[5];
+	header->flags1              = file_memory[6];
+	header->flags2              = file_memory[7];
+	header->mapper_variant      = file_memory[8] >> 4;
+	header->rom_size_bits_upper = file_memory[9];
+	header->ram_size            = file_memory[10];
+	header->vram_size           = file_memory[11];
+	header->tv_system           = file_memory[12] & 0x03;
+	header->vs_system           = file_memory[13];
+	header->misc_roms           = file_memory[14] & 0x03;
+	header->expansion_device    = file_memory[15] & 0x3F;
+
+	header->mapper_number = (header->flags1 >> 4) | (header->flags2 & 0xF0) | ((file_memory[8] & 0x0F) << 8);
+
+	/* Sizes past the end of the file are cut down to what is there, like truncated iNES 1.0 dumps. */
+	prg_rom_size = std::min<uint64_t>(NES2ROMSize(header->prg_rom_size, header->rom_size_bits_upper & 0x0F, 0x4000), file_memory.size());
+	chr_rom_size = std::min<uint64_t>(NES2ROMSize(header->chr_rom_size, header->rom_size_bits_upper >> 4, 0x2000), file_memory.size());
+
+	prg_nvram_size = NES2RAMSize(header->ram_size >> 4);
+	prg_ram_size   = NES2RAMSize(header->ram_size & 0x0F) + prg_nvram_size;
+	chr_nvram_size = NES2RAMSize(header->vram_size >> 4);
+	chr_ram_size   = NES2RAMSize(header->vram_size & 0x0F) + chr_nvram_size;
+
+	/* Mappers check the iNES 1.0 8KB unit sizes for whether there is RAM at 0x6000. */
+	header->prg_ram_size = std::min<uint32_t>((prg_ram_size + 0x1FFF) / 0x2000, 0xFF);
+	header->chr_ram_size = std::min<uint32_t>((chr_ram_size + 0x1FFF) / 0x2000, 0xFF);
+
+	std::cout << "PRG ROM Size: " << prg_rom_size / 1024 << " KB" << std::endl;
+	std::cout << "CHR ROM Size: " << chr_rom_size / 1024 << " KB" << std::endl;
+	std::cout << "PRG RAM Size: " << prg_ram_size << " bytes (" << prg_nvram_size << " battery backed)" << std::endl;
+	std::cout << "CHR RAM Size: " << chr_ram_size << " bytes (" << chr_nvram_size << " battery backed)" << std::endl;
+
+	ApplyHeaderFlags();
+	LocateROM();
+	ConfigureConsole();
+
+	if(header->misc_roms != 0) {
+		std::cout << "ROM has " << +header->misc_roms << " miscellaneous ROM(s) after CHR ROM." << std::endl;
+	}
+
+	if(header->expansion_device != 0) {
+		std::cout << "ROM expects expansion device " << +header->expansion_device << "." << std::endl;
+	}
+
+	mapper = DetermineMapper(header);
+	mapper->Initialize(this);
+
+	std::cout << "ROM is using mapper \"" << mapper->GetName() << "\" (Number: " << +mapper->GetNumber() << " Variant: " << +mapper->GetVariant() << " )." << std::endl;
+}
+
+typedef struct unif_board {
+	const char* name;
+	uint16_t    mapper_number;
+	uint8_t     mapper_variant;
+} unif_board_t;
+
+/* UNIF names the board instead of numbering the mapper. These are the boards of mappers we have, without the "NES-" style
+   prefix, with the NES 2.0 submapper for the discrete boards with bus conflicts (2) and without (1). */
+static const unif_board_t unif_boards[] = {
+	{ "NROM",     0, 0 }, { "NROM-128", 0, 0 }, { "NROM-256", 0, 0 }, { "HROM",   0, 0 }, { "RROM",   0, 0 },
+	{ "RROM-128", 0, 0 }, { "SROM",     0, 0 }, { "STROM",    0, 0 },
+	{ "SAROM",    1, 0 }, { "SBROM",    1, 0 }, { "SCROM",    1, 0 }, { "SEROM",  1, 0 }, { "SGROM",  1, 0 },
+	{ "SKROM",    1, 0 }, { "SLROM",    1, 0 }, { "SL1ROM",   1, 0 }, { "SNROM",  1, 0 }, { "SOROM",  1, 0 },
+	{ "SUROM",    1, 0 }, { "SXROM",    1, 0 },
+	{ "UNROM",    2, 2 }, { "UOROM",    2, 2 },
+	{ "CNROM",    3, 2 },
+	{ "TBROM",    4, 0 }, { "TEROM",    4, 0 }, { "TFROM",    4, 0 }, { "TGROM",  4, 0 }, { "TKROM",  4, 0 },
+	{ "TLROM",    4, 0 }, { "TNROM",    4, 0 }, { "TR1ROM",   4, 0 }, { "TSROM",  4, 0 }, { "TVROM",  4, 0 },
+	{ "EKROM",    5, 0 }, { "ELROM",    5, 0 }, { "ETROM",    5, 0 }, { "EWROM",  5, 0 },
+	{ "AMROM",    7, 2 }, { "ANROM",    7, 1 }, { "AN1ROM",   7, 1 }, { "AOROM",  7, 0 },
+	{ "BNROM",   34, 2 }, { "NINA-001",34, 1 },
+	{ "GNROM",   66, 0 }, { "MHROM",   66, 0 }
+};
+
+void Cartridge::OpenUNIF() {
+
+	std::memcpy(header_unif, file_memory.data(), sizeof(unif_header_t));
+
+	std::cout << "UNIF revision " << header_unif->version << " ROM." << std::endl;
+
+	std::string board;
+	std::span<const uint8_t> prg_chunks[16];
+	std::span<const uint8_t> chr_chunks[16];
+	uint8_t mirroring = 5;
+	bool battery = false;
+	bool has_tv_system = false;
+
+	/* Walk the chunks in place. The data is only copied when PRG or CHR ROM is split over several chunks. */
+	size_t offset = sizeof(unif_header_t);
+
+	while(offset + sizeof(unif_chunk_header_t) <= file_memory.size()) {
+		unif_chunk_header_t chunk;
+		std::memcpy(chunk.id, &file_memory[offset], sizeof(chunk.id));
+		chunk.length = file_memory[offset + 4] | (file_memory[offset + 5] << 8) | (file_memory[offset + 6] << 16) | (uint32_t(file_memory[offset + 7]) << 24);
+		offset += sizeof(unif_chunk_header_t);
+
+		if(chunk.length > file_memory.size() - offset) {
+			std::cout << "UNIF chunk \"" << std::string_view(chunk.id, 4) << "\" is truncated." << std::endl;
+			chunk.length = file_memory.size() - offset;
+		}
+
+		const std::string_view id(chunk.id, 4);
+		const std::span<const uint8_t> data = file_memory.subspan(offset, chunk.length);
+		offset += chunk.length;
+
+		/* PRG0-PRGF and CHR0-CHRF, with a hex digit on the end. */
+		const int digit = std::isxdigit(static_cast<unsigned char>(id[3])) ? std::stoi(std::string(1, id[3]), nullptr, 16) : -1;
+
+		if(id == "MAPR") {
+			board.assign(reinterpret_cast<const char*>(data.data()), std::find(data.begin(), data.end(), 0) - data.begin());
+		} else if(id.substr(0, 3) == "PRG" && digit >= 0) {
+			prg_chunks[digit] = data;
+		} else if(id.substr(0, 3) == "CHR" && digit >= 0) {
+			chr_chunks[digit] = data;
+		} else if(id == "MIRR" && !data.empty()) {
+			mirroring = data[0];
+		} else if(id == "BATR") {
+			battery = true;
+		} else if(id == "TVCI" && !data.empty()) {
+			/* 0 NTSC, 1 PAL, 2 both, the same as NES 2.0 timing. */
+			header->tv_system = std::min<uint8_t>(data[0], 2);
+			has_tv_system = true;
+		} else if(id == "NAME") {
+			std::cout << "Game name: " << std::string(reinterpret_cast<const char*>(data.data()), std::find(data.begin(), data.end(), 0) - data.begin()) << std::endl;
+		}
+	}
+
+	/* A single chunk is used where it is in the file, several are joined in order. */
+	auto join_chunks = [](std::span<const uint8_t>* chunks, std::vector<uint8_t>& buffer) -> std::span<const uint8_t> {
+
+		const size_t count = std::count_if(chunks, chunks + 16, [](std::span<const uint8_t> chunk) { return !chunk.empty(); });
+
+		if(count <= 1) {
+			const std::span<const uint8_t>* chunk = std::find_if(chunks, chunks + 16, [](std::span<const uint8_t> chunk) { return !chunk.empty(); });
+			return chunk == chunks + 16 ? std::span<const uint8_t>() : *chunk;
+		}
+
+		buffer.clear();
+
+		for(int i = 0; i < 16; i++) {
+			buffer.insert(buffer.end(), chunks[i].begin(), chunks[i].end());
+		}
+
+		return buffer;
+	};
+
+	prg_rom = join_chunks(prg_chunks, prg_rom_buffer);
+	chr_rom = join_chunks(chr_chunks, chr_rom_buffer);
+
+	/* Board names usually start with who made the board, like "NES-TLROM" or "HVC-SROM". */
+	std::string_view board_name = board;
+
+	for(const std::string_view prefix : { "NES-", "HVC-", "UNL-", "BTL-", "BMC-" }) {
+		if(board_name.starts_with(prefix)) {
+			board_name.remove_prefix(prefix.size());
+			break;
+		}
+	}
+
+	const unif_board_t* unif_board = std::find_if(std::begin(unif_boards), std::end(unif_boards), [&](const unif_board_t& entry) { return board_name == entry.name; });
+
+	if(unif_board == std::end(unif_boards)) {
+		std::cout << "ROM is using unsupported UNIF board \"" << board << "\"." << std::endl;
+		abort();
+	}
+
+	std::cout << "UNIF board: " << board << std::endl;
+
+	/* Make up the iNES header the mappers read their board details from. MIRR 0 is horizontal, 1 vertical and 4 four screen,
+	   the others are single screen or mapper controlled and left to the mapper. */
+	header->flags1 = (mirroring == 1 ? 0x01 : 0x00) | (battery ? 0x02 : 0x00) | (mirroring == 4 ? 0x08 : 0x00);
+	header->flags2 = 0;
+	header->mapper_number = unif_board->mapper_number;
+	header->mapper_variant = unif_board->mapper_variant;
+
+	prg_rom_size = prg_rom.size();
+	chr_rom_size = chr_rom.size();
+
+	/* UNIF doesn't give RAM sizes, so like iNES 1.0 assume 8KB of PRG RAM, and 8KB of CHR RAM without CHR ROM. */
+	prg_ram_size = 0x2000;
+	chr_ram_size = chr_rom.empty() ? 0x2000 : 0;
+	prg_nvram_size = battery ? prg_ram_size : 0;
+
+	header->prg_rom_size = std::min<uint32_t>(prg_rom_size / 0x4000, 0xFF);
+	header->chr_rom_size = std::min<uint32_t>(chr_rom_size / 0x2000, 0xFF);
+	header->prg_ram_size = 1;
+	header->chr_ram_size = chr_rom.empty() ? 1 : 0;
+
+	std::cout << "PRG ROM Size: " << prg_rom_size / 1024 << " KB" << std::endl;
+	std::cout << "CHR ROM Size: " << chr_rom_size / 1024 << " KB" << std::endl;
+
+	ApplyHeaderFlags();
+
+	if(has_tv_system) {
+		ConfigureConsole();
+	}
+
+	mapper = DetermineMapper(header);
+	mapper->Initialize(this);
+
+	std::cout << "ROM is using mapper \"" << mapper->GetName() << "\" (Number: " << +mapper->GetNumber() << " Variant: " << +mapper->GetVariant() << " )." << std::endl;
+}
+
+void Cartridge::CorrectHeader() {
+
+	/* The database is keyed by everything after the header and trainer, which is PRG and CHR ROM in a good dump. */
+	const size_t offset = std::min<size_t>(BitCheck(header->flags1, 2) ? 16 + 512 : 16, file_memory.size());
+	const std::span<const uint8_t> rom = file_memory.subspan(offset);
+
+	rom_crc32 = CRC32(rom.data(), rom.size());
+
+	rom_database_entry_t entry;
+
+	if(!ROMDatabase::Find(rom_crc32, rom.size(), &entry)) {
+		std::cout << "ROM not in database (CRC32: " << HEX8(rom_crc32) << "), trusting header." << std::endl;
+		return;
+	}
+
+	std::cout << "ROM found in database (CRC32: " << HEX8(rom_crc32) << "), correcting header." << std::endl;
+
+	in_database = true;
+
+	/* Only what an iNES 1.0 header can hold, anything bigger is left to NES 2.0 headers. */
+	if(entry.prg_rom_size / 0x4000 <= 0xFF && entry.chr_rom_size / 0x2000 <= 0xFF) {
+		header->prg_rom_size = entry.prg_rom_size / 0x4000;
+		header->chr_rom_size = entry.chr_rom_size / 0x2000;
+		header->chr_ram_size = (entry.chr_ram_size + entry.chr_nvram_size + 0x1FFF) / 0x2000;
+	}
+
+	header->flags1 = (header->flags1 & 0x0F) | ((entry.mapper_number & 0x0F) << 4);
+	header->flags2 = (header->flags2 & 0x0F) | (entry.mapper_number & 0xF0);
+	header->mapper_number = entry.mapper_number;
+	header->mapper_variant = entry.mapper_variant;
+
+	header->prg_ram_size = std::min<uint32_t>((entry.prg_ram_size + entry.prg_nvram_size + 0x1FFF) / 0x2000, 0xFF);
+	prg_nvram_size = entry.prg_nvram_size;
+	chr_nvram_size = entry.chr_nvram_size;
+
+	switch(entry.mirroring) {
+		case ROMDatabase::MIRRORING_HORIZONTAL:
+			header->flags1 &= ~0x09;
+			break;
+		case ROMDatabase::MIRRORING_VERTICAL:
+			header->flags1 = (header->flags1 & ~0x08) | 0x01;
+			break;
+		case ROMDatabase::MIRRORING_FOUR_SCREEN:
+			header->flags1 |= 0x08;
+			break;
+		default:
+			break;
+	}
+
+	header->flags1 = entry.battery ? (header->flags1 | 0x02) : (header->flags1 & ~0x02);
+
+	/* Same values as NES 2.0 timing, picked up by ConfigureConsole. Byte 9 bit 0 is the iNES 1.0 TV system bit. */
+	header->tv_system = entry.region;
+	header->flags3 = entry.region == ROMDatabase::REGION_PAL ? (header->flags3 | 0x01) : (header->flags3 & ~0x01);
+}
+
+void Cartridge::ApplyHeaderFlags() {
+
 	/* Convert flags to bitsets for parsing. */
 	std::bitset<8> flags_6(header->flags1);
-	std::bitset<8> flags_7(header->flags2);
-	std::bitset<8> flags_9(header->flags3);
-	std::bitset<8> flags_10(header->flags4);
 
+	/* Mappers with mirroring control override this in Initialize. */
 	if(flags_6.test(0) == 0) {
 		std::cout << "ROM uses horizontal mirroring." << std::endl;
+		nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::HORIZONTAL);
 	} else {
 		std::cout << "ROM uses vertical mirroring." << std::endl;
+		nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::VERTICAL);
 	}
 
 	if(flags_6.test(1) == 1) {
@@ -179,67 +541,357 @@ void Cartridge::OpeniNES() {
 
 	if(flags_6.test(3) == 1) {
 		std::cout << "ROM uses four screen VRAM." << std::endl;
+		four_screen_vram.resize(0x800, 0);
+		nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::FOUR_SCREEN);
 	}
+}
 
-	if(flags_7.test(0) == 1) {
-		std::cout << "ROM is for the VS Unisystem." << std::endl;
+void Cartridge::LocateROM() {
+
+	/* Truncated dumps get whatever is there. */
+	const size_t prg_offset = std::min<size_t>(GetHeaderOffset(), file_memory.size());
+	prg_rom = file_memory.subspan(prg_offset, std::min<size_t>(prg_rom_size, file_memory.size() - prg_offset));
+
+	const size_t chr_offset = std::min<size_t>(prg_offset + prg_rom_size, file_memory.size());
+	chr_rom = file_memory.subspan(chr_offset, std::min<size_t>(chr_rom_size, file_memory.size() - chr_offset));
+}
+
+/* NES 2.0 Vs. System PPU types (byte 13, lower nibble) as the closest PPU we have. */
+static NESSystem::ppu_emulation_mode_t VsPPUModel(uint8_t type) {
+
+	switch(type) {
+		case 0x0:
+			return NESSystem::PPUEmulationMode::RP2C03B;
+		case 0x2:
+			return NESSystem::PPUEmulationMode::RP2C04_0001;
+		case 0x3:
+			return NESSystem::PPUEmulationMode::RP2C04_0002;
+		case 0x4:
+			return NESSystem::PPUEmulationMode::RP2C04_0003;
+		case 0x5:
+			return NESSystem::PPUEmulationMode::RP2C04_0004;
+		case 0x8:
+		case 0x9:
+		case 0xA:
+		case 0xB:
+		case 0xC:
+			return NESSystem::PPUEmulationMode::RP2C05;
+		default:
+			/* RP2C03G, RC2C03B and RC2C03C. */
+			return NESSystem::PPUEmulationMode::RP2C03;
 	}
+}
 
-	if(flags_7.test(1) == 1) {
-		std::cout << "ROM is for the Playchoice-10 (8KB of Hint Screen data is after CHR data)." << std::endl;
+void Cartridge::ConfigureConsole() {
+
+	NESSystem::cpu_emulation_mode_t cpu_type = nes_system->GetCPUModel();
+	NESSystem::ppu_emulation_mode_t ppu_type = nes_system->GetPPUModel();
+
+	/* The PPU only draws 262 line frames so far, so the region is left as it is and only reported. Switching to the PAL
+	   clock ratio without 312 line frames would run those games too fast. */
+	switch(header->tv_system) {
+		case 0:
+			std::cout << "ROM is for NTSC consoles." << std::endl;
+			cpu_type = NESSystem::CPUEmulationMode::RP2A03;
+			ppu_type = NESSystem::PPUEmulationMode::RP2C02;
+			break;
+		case 1:
+			std::cout << "ROM is for PAL consoles, running it with NTSC timing." << std::endl;
+			cpu_type = NESSystem::CPUEmulationMode::RP2A07G;
+			ppu_type = NESSystem::PPUEmulationMode::RP2C07;
+			break;
+		case 2:
+			/* Runs on either, so whatever the system was made with is kept. */
+			std::cout << "ROM is for consoles of any region." << std::endl;
+			break;
+		case 3:
+			std::cout << "ROM is for the Dendy, running it with NTSC timing." << std::endl;
+			cpu_type = NESSystem::CPUEmulationMode::DENDY;
+			ppu_type = NESSystem::PPUEmulationMode::RP2C07;
+			break;
 	}
 
-	mapper = DetermineMapper(header);
-	mapper->Initialize(this);
+	/* Bits 0-1 of byte 7 are the console type in NES 2.0, and the Vs. System and PlayChoice-10 bits in iNES 1.0. Both use
+	   RGB PPUs, NES 2.0 headers say which one for the Vs. System. */
+	switch(header->flags2 & 0x03) {
+		case 1:
+			if(header->is_iNES2) {
+				std::cout << "ROM is for the Vs. System (PPU type " << +(header->vs_system & 0x0F) << ", hardware type " << +(header->vs_system >> 4) << ")." << std::endl;
+			}
+
+			ppu_type = VsPPUModel(header->is_iNES2 ? (header->vs_system & 0x0F) : 0);
+			break;
+		case 2:
+			if(header->is_iNES2) {
+				std::cout << "ROM is for the PlayChoice-10." << std::endl;
+			}
+
+			ppu_type = NESSystem::PPUEmulationMode::RP2C03B;
+			break;
+		case 3:
+			if(header->is_iNES2) {
+				std::cout << "ROM is for extended console type " << +(header->vs_system & 0x0F) << "." << std::endl;
+			}
+			break;
+	}
 
-	std::cout << "ROM is using mapper \"" << mapper->GetName() << "\" (Number: " << mapper->GetNumber() << " Variant: " << mapper->GetVariant() << " )." << std::endl;
+	nes_system->SetConsole(cpu_type, ppu_type);
 }
 
-void Cartridge::OpeniNES2() {
-	if(!header->is_iNES2) {
-		return;
+Mapper* Cartridge::DetermineMapper(iNES_header_t* header) {
+
+	uint16_t mapper_number = header->mapper_number;
+	uint8_t mapper_variant = header->mapper_variant;
+
+	Mapper* new_mapper = Mapper::Create(nes_system, mapper_number, mapper_variant);
+
+	/* Running the game on the wrong board only crashes it later in ways that are harder to tell apart. */
+	if(new_mapper == nullptr) {
+		std::cout << "ROM is using unsupported mapper number " << +mapper_number << " (Variant: " << +mapper_variant << ")." << std::endl;
+		abort();
 	}
 
-	mapper = DetermineMapper(header);
-	mapper->Initialize(this);
+	return new_mapper;
+}
+
+bool Cartridge::MapFile() {
+
+#ifdef _WIN32
+	file_handle = CreateFileA(file_name.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(file_handle == INVALID_HANDLE_VALUE) {
+		file_handle = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if(!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) {
+		UnmapFile();
+		return false;
+	}
+
+	mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(mapping_handle == nullptr) {
+		UnmapFile();
+		return false;
+	}
+
+	const void* view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+	if(view == nullptr) {
+		UnmapFile();
+		return false;
+	}
+
+	file_memory = std::span<const uint8_t>(static_cast<const uint8_t*>(view), static_cast<size_t>(file_size.QuadPart));
+#else
+	const int file = open(file_name.c_str(), O_RDONLY);
+	if(file < 0) {
+		return false;
+	}
+
+	struct stat file_status;
+	if(fstat(file, &file_status) != 0 || file_status.st_size == 0) {
+		close(file);
+		return false;
+	}
+
+	/* The mapping stays valid after the descriptor is closed. */
+	void* view = mmap(nullptr, file_status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+
+	if(view == MAP_FAILED) {
+		return false;
+	}
+
+	file_memory = std::span<const uint8_t>(static_cast<const uint8_t*>(view), static_cast<size_t>(file_status.st_size));
+#endif
 
-	std::cout << "ROM is using mapper \"" << mapper->GetName() << "\" (Number: " << mapper->GetNumber() << " Variant: " << mapper->GetVariant() << " )." << std::endl;
+	file_mapped = true;
+	return true;
 }
 
-void Cartridge::OpenUNIF() {
-	header_unif = new unif_header_t;
+void Cartridge::UnmapFile() {
 
-	mapper = DetermineMapper(header_unif);
-	mapper->Initialize(this);
+#ifdef _WIN32
+	if(file_mapped) {
+		UnmapViewOfFile(file_memory.data());
+	}
 
-	std::cout << "ROM is using mapper \"" << mapper->GetName() << "\" (Number: " << mapper->GetNumber() << " Variant: " << mapper->GetVariant() << " )." << std::endl;
+	if(mapping_handle != nullptr) {
+		CloseHandle(mapping_handle);
+		mapping_handle = nullptr;
+	}
+
+	if(file_handle != nullptr) {
+		CloseHandle(file_handle);
+		file_handle = nullptr;
+	}
+#else
+	if(file_mapped) {
+		munmap(const_cast<uint8_t*>(file_memory.data()), file_memory.size());
+	}
+#endif
+
+	file_mapped = false;
+	file_memory = {};
+	file_buffer.clear();
+
+	prg_rom = {};
+	chr_rom = {};
+	prg_rom_buffer.clear();
+	chr_rom_buffer.clear();
 }
 
-Mapper* Cartridge::DetermineMapper(iNES_header_t* header) {
+std::span<uint8_t> Cartridge::AllocatePRGRAM(uint32_t size) {
 
-	uint8_t mapper_number = (header->flags1 >> 4) + (header->flags2 & 0xF0);
-	uint8_t mapper_variant = 0;
+	UnmapSaveFile();
 
-	if(header->is_iNES2) {
-		mapper_variant = header->mapper_variant;
+	if(prg_nvram_size == 0 || size == 0) {
+		prg_ram_buffer.assign(size, 0);
+		return prg_ram_buffer;
 	}
 
-	switch(mapper_number) {
-		case 000:
-			return new MapperNROM(nes_system, mapper_number, mapper_variant);
-		case 001:
-			return new MapperMMC1(nes_system, mapper_number, mapper_variant);
-		case 005:
-			return new MapperMMC5(nes_system, mapper_number, mapper_variant);
-		default:
-			std::cout << "WARNING: ROM is using unsupported mapper number" << mapper_number << "." << std::endl;
-			return new MapperNROM(nes_system, mapper_number, mapper_variant);
+	save_file_name = std::filesystem::path(file_name).replace_extension(".sav").string();
+
+	if(MapSaveFile(size)) {
+		std::cout << "Battery RAM is mapped from \"" << save_file_name << "\"." << std::endl;
+		return save_memory;
+	}
+
+	/* Still load what was saved, the game just can't save over it. */
+	std::cout << "Couldn't open \"" << save_file_name << "\" for writing, battery RAM won't be saved." << std::endl;
+
+	prg_ram_buffer.assign(size, 0);
+
+	std::ifstream file(save_file_name, std::ios::binary);
+	file.read(reinterpret_cast<char*>(prg_ram_buffer.data()), size);
+
+	return prg_ram_buffer;
+}
+
+void Cartridge::FlushSave() {
+
+	if(!save_mapped) {
+		return;
+	}
+
+	/* A few microseconds a frame, instead of a check on every write to PRG RAM. */
+	if(std::equal(save_memory.begin(), save_memory.end(), save_snapshot.begin())) {
+		return;
+	}
+
+	std::copy(save_memory.begin(), save_memory.end(), save_snapshot.begin());
+
+	/* The mapping is shared with the OS's file cache, so the save already survives the emulator crashing. This starts
+	   writing it to disk without waiting, so it also survives the OS going down. */
+#ifdef _WIN32
+	FlushViewOfFile(save_memory.data(), save_memory.size());
+#else
+	msync(save_memory.data(), save_memory.size(), MS_ASYNC);
+#endif
+}
+
+bool Cartridge::MapSaveFile(uint32_t size) {
+
+	uint64_t existing_size = 0;
+
+#ifdef _WIN32
+	save_file_handle = CreateFileA(save_file_name.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if(save_file_handle == INVALID_HANDLE_VALUE) {
+		save_file_handle = nullptr;
+		return false;
+	}
+
+	LARGE_INTEGER file_size;
+	if(!GetFileSizeEx(save_file_handle, &file_size)) {
+		UnmapSaveFile();
+		return false;
+	}
+
+	existing_size = static_cast<uint64_t>(file_size.QuadPart);
+
+	/* Mapping more than the file holds grows it with zeros. */
+	save_mapping_handle = CreateFileMappingA(save_file_handle, nullptr, PAGE_READWRITE, 0, size, nullptr);
+	if(save_mapping_handle == nullptr) {
+		UnmapSaveFile();
+		return false;
+	}
+
+	void* view = MapViewOfFile(save_mapping_handle, FILE_MAP_WRITE, 0, 0, size);
+	if(view == nullptr) {
+		UnmapSaveFile();
+		return false;
+	}
+#else
+	const int file = open(save_file_name.c_str(), O_RDWR | O_CREAT, 0644);
+	if(file < 0) {
+		return false;
+	}
+
+	struct stat file_status;
+	if(fstat(file, &file_status) != 0) {
+		close(file);
+		return false;
+	}
+
+	existing_size = static_cast<uint64_t>(file_status.st_size);
+
+	/* Mapping past the end of the file would fault, so grow it with zeros first. */
+	if(existing_size < size && ftruncate(file, size) != 0) {
+		close(file);
+		return false;
+	}
+
+	/* The mapping stays valid after the descriptor is closed. */
+	void* view = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	close(file);
+
+	if(view == MAP_FAILED) {
+		return false;
 	}
+#endif
+
+	/* Other emulators may have saved a different amount, a smaller save is still loaded and a bigger one isn't cut down. */
+	if(existing_size != 0 && existing_size < size) {
+		std::cout << "Save file is " << existing_size << " bytes, padding it to " << size << " bytes." << std::endl;
+	} else if(existing_size > size) {
+		std::cout << "Save file is " << existing_size << " bytes, only the first " << size << " bytes are used." << std::endl;
+	}
+
+	save_memory = std::span<uint8_t>(static_cast<uint8_t*>(view), size);
+	save_snapshot.assign(save_memory.begin(), save_memory.end());
+	save_mapped = true;
+	return true;
 }
 
-Mapper* Cartridge::DetermineMapper(unif_header_t* header) {
-	std::cout << "WARNING: UNIF Loading is unsupported." << std::endl;
-	return new MapperNROM(nes_system, 0, 0);
+void Cartridge::UnmapSaveFile() {
+
+	/* Unlike the flush every frame, this waits until the save is on disk. */
+#ifdef _WIN32
+	if(save_mapped) {
+		FlushViewOfFile(save_memory.data(), save_memory.size());
+		UnmapViewOfFile(save_memory.data());
+	}
+
+	if(save_mapping_handle != nullptr) {
+		CloseHandle(save_mapping_handle);
+		save_mapping_handle = nullptr;
+	}
+
+	if(save_file_handle != nullptr) {
+		FlushFileBuffers(save_file_handle);
+		CloseHandle(save_file_handle);
+		save_file_handle = nullptr;
+	}
+#else
+	if(save_mapped) {
+		msync(save_memory.data(), save_memory.size(), MS_SYNC);
+		munmap(save_memory.data(), save_memory.size());
+	}
+#endif
+
+	save_mapped = false;
+	save_memory = {};
+	save_snapshot.clear();
 }
 
 uint32_t Cartridge::GetHeaderOffset() {
@@ -25,6 +25,8 @@
 #include "iNESHeader.hpp"
 #include "UNIFHeader.hpp"
 
+#include <cstddef>
+#include <span>
 #include <string>
 #include <vector>
 
@@ -43,24 +45,70 @@ class Cartridge {
 
 		uint32_t GetHeaderOffset();
 
-		Mapper* GetMapper()               { return mapper; };
-		iNES_header_t* GetHeader()        { return header; };
-		std::vector<char> GetFileMemory() { return file_memory; };
+		Mapper* GetMapper()        { return mapper; };
+		iNES_header_t* GetHeader() { return header; };
+
+		/* The whole ROM file, and the PRG and CHR ROM in it. Mappers point their ROM banks straight at these. */
+		std::span<const uint8_t> GetFileMemory() { return file_memory; };
+		std::span<const uint8_t> GetPRGROM()     { return prg_rom; };
+		std::span<const uint8_t> GetCHRROM()     { return chr_rom; };
 
 		uint32_t GetPRGROMSize() { return prg_rom_size; };
 		uint32_t GetPRGRAMSize() { return prg_ram_size; };
 		uint32_t GetCHRROMSize() { return chr_rom_size; };
 		uint32_t GetCHRRAMSize() { return chr_ram_size; };
 
+		/* How much of the PRG and CHR RAM above is battery backed. */
+		uint32_t GetPRGNVRAMSize() { return prg_nvram_size; };
+		uint32_t GetCHRNVRAMSize() { return chr_nvram_size; };
+
+		/* PRG RAM for the mapper. On boards with a battery it is mapped from a .sav file next to the ROM, so the CPU writes
+		   straight into the file through the PRG RAM slots, and nothing has to be copied to save. Allocating again replaces
+		   the previous PRG RAM. */
+		std::span<uint8_t> AllocatePRGRAM(uint32_t size);
+
+		/* Called at the end of every frame. Has the OS write battery RAM back to disk, if the game changed it since the
+		   last flush. */
+		void FlushSave();
+
+		/* Extra 2kB of nametable memory on four screen boards. */
+		uint8_t* GetFourScreenVRAM() { return four_screen_vram.data(); };
+
 		bool IsLoaded() { return loaded; };
 
+		/* Whether an iNES 1.0 header was corrected from the ROM database, so its sizes can be trusted like NES 2.0's. */
+		bool IsInDatabase() { return in_database; };
+
+		/* CRC32 of PRG and CHR ROM, only worked out for iNES 1.0 ROMs. */
+		uint32_t GetROMCRC32() { return rom_crc32; };
+
 	private:
 		NESSystem* nes_system;
 
+		/* Map the file read only, or read it into file_buffer where that isn't possible. */
+		bool MapFile();
+		void UnmapFile();
+
+		/* Map the save file read/write, growing it to size if it is smaller. Fails on read only media. */
+		bool MapSaveFile(uint32_t size);
+		void UnmapSaveFile();
+
 		void OpeniNES();
 		void OpeniNES2();
 		void OpenUNIF();
 
+		/* Look the ROM up in the ROM database and overwrite the iNES 1.0 header with what it knows. */
+		void CorrectHeader();
+
+		/* Mirroring, battery, trainer and four screen VRAM from header byte 6, which UNIF files get made up for them. */
+		void ApplyHeaderFlags();
+
+		/* Point PRG and CHR ROM into the file after an iNES header and trainer, once their sizes are known. */
+		void LocateROM();
+
+		/* Pick the CPU and PPU from the header's timing and console type. */
+		void ConfigureConsole();
+
 		typedef enum HeaderType {
 			HEADER_TYPE_INES,
 			HEADER_TYPE_INES2,
@@ -68,7 +116,6 @@ class Cartridge {
 		} header_type_t;
 
 		Mapper* DetermineMapper(iNES_header_t* header);
-		Mapper* DetermineMapper(unif_header_t* header);
 
 		Mapper* mapper;
 		header_type_t header_type;
@@ -76,12 +123,47 @@ class Cartridge {
 		unif_header* header_unif;
 
 		std::string file_name;
-		std::vector<char> file_memory;
+		std::span<const uint8_t> file_memory;
+		std::vector<uint8_t> file_buffer;
+
+		/* PRG and CHR ROM point into the file, unless a UNIF file splits them over several chunks and they are joined here. */
+		std::span<const uint8_t> prg_rom;
+		std::span<const uint8_t> chr_rom;
+		std::vector<uint8_t> prg_rom_buffer;
+		std::vector<uint8_t> chr_rom_buffer;
+
+#ifdef _WIN32
+		void* file_handle { nullptr };
+		void* mapping_handle { nullptr };
+#endif
+		bool file_mapped { false };
+
+		std::string save_file_name;
+		std::span<uint8_t> save_memory;
+
+		/* Battery RAM as of the last flush. Comparing against it tells whether the game saved without watching every write. */
+		std::vector<uint8_t> save_snapshot;
+
+		/* PRG RAM without a battery, or with one when the save file can't be mapped. */
+		std::vector<uint8_t> prg_ram_buffer;
+
+#ifdef _WIN32
+		void* save_file_handle { nullptr };
+		void* save_mapping_handle { nullptr };
+#endif
+		bool save_mapped { false };
 
 		uint32_t prg_rom_size;
 		uint32_t prg_ram_size;
 		uint32_t chr_rom_size;
 		uint32_t chr_ram_size;
+		uint32_t prg_nvram_size { 0 };
+		uint32_t chr_nvram_size { 0 };
+
+		std::vector<uint8_t> four_screen_vram;
+
+		uint32_t rom_crc32 { 0 };
+		bool in_database { false };
 
 		bool loaded;
 };
@@ -37,6 +37,8 @@ void ControllerIO::Initialize() {
 	controller_port1 = NES_CONTROLLER;
 	controller_port2 = NONE;
 	controller_states = { 0 };
+	controller_shift_port1 = 0;
+	controller_shift_port2 = 0;
 }
 
 void ControllerIO::Shutdown() {
@@ -45,6 +47,8 @@ void ControllerIO::Shutdown() {
 
 void ControllerIO::Reset() {
 	controller_states = { 0 };
+	controller_shift_port1 = 0;
+	controller_shift_port2 = 0;
 }
 
 uint8_t ControllerIO::ReadIO(uint16_t address) {
@@ -53,10 +57,19 @@ uint8_t ControllerIO::ReadIO(uint16_t address) {
 
 	// TODO: Turn this into a switch statement for other controller devices.
 
+	/* While strobe is high, the controllers keep reloading and only ever return A. */
+	if(controller_port_latch) {
+		controller_shift_port1 = controller_states.controller_state_port1_D0;
+		controller_shift_port2 = controller_states.controller_state_port2_D0;
+	}
+
 	/* Controller Port 1 */
 	if(address == 0x4016) {
-		/* Send CLK pulse to shift bits. */
-
+		/* Send CLK pulse to shift bits. Standard controllers return 1 once all 8 buttons are read. */
+		if(controller_port1 == NES_CONTROLLER) {
+			value = (value & 0xE0) | (controller_shift_port1 & 0x01);
+			controller_shift_port1 = (controller_shift_port1 >> 1) | 0x80;
+		}
 
 		/* Capture D0 */
 		/* Capture D1 */
@@ -68,7 +81,10 @@ uint8_t ControllerIO::ReadIO(uint16_t address) {
 	/* Controller Port 2 */
 	if(address == 0x4017) {
 		/* Send CLK pulse to shift bits. */
-
+		if(controller_port2 == NES_CONTROLLER) {
+			value = (value & 0xE0) | (controller_shift_port2 & 0x01);
+			controller_shift_port2 = (controller_shift_port2 >> 1) | 0x80;
+		}
 
 		/* Capture D0 */
 		/* Capture D1 */
@@ -89,6 +105,12 @@ void ControllerIO::WriteIO(uint16_t address, uint8_t value) {
 		if(value & 0x01) { controller_port_latch = 1; } else { controller_port_latch = 0; }
 		if(value & 0x02) { expansion_port_latch1 = 1; } else { expansion_port_latch1 = 0; }
 		if(value & 0x03) { expansion_port_latch2 = 1; } else { expansion_port_latch2 = 0; }
+
+		/* Latch button states on strobe. */
+		if(controller_port_latch) {
+			controller_shift_port1 = controller_states.controller_state_port1_D0;
+			controller_shift_port2 = controller_states.controller_state_port2_D0;
+		}
 	}
 
 	return;
@@ -83,6 +83,10 @@ class ControllerIO {
 
 		controller_port_state controller_states;
 
+		/* Button states latched while strobe is high, shifted out one bit per read. */
+		uint8_t controller_shift_port1;
+		uint8_t controller_shift_port2;
+
 		controller_type controller_port1;
 		controller_type controller_port2;
 
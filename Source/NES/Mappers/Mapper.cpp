@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <map>
+
+#include "../Cartridge.hpp"
+#include "../NESSystem.hpp"
+#include "../PPU.hpp"
+#include "Mapper.hpp"
+
+/* Constructors by (number << 8) | variant. Registration runs during static initialization, so this is made on first use. */
+static std::map<uint32_t, mapper_constructor_t>& MapperRegistry() {
+	static std::map<uint32_t, mapper_constructor_t> registry;
+	return registry;
+}
+
+bool Mapper::Register(uint16_t number, uint8_t variant, mapper_constructor_t constructor) {
+	MapperRegistry()[(number << 8) | variant] = constructor;
+	return true;
+}
+
+Mapper* Mapper::Create(NESSystem* nes_system, uint16_t number, uint8_t variant) {
+
+	const std::map<uint32_t, mapper_constructor_t>& registry = MapperRegistry();
+
+	auto entry = registry.find((number << 8) | variant);
+
+	if(entry == registry.end()) {
+		entry = registry.find((number << 8) | AnyVariant);
+	}
+
+	if(entry == registry.end()) {
+		return nullptr;
+	}
+
+	return entry->second(nes_system, number, variant);
+}
+
+uint64_t Mapper::GetNextEventCycle() {
+	return PPU::NoEvent;
+}
+
+void Mapper::SetupMemory(Cartridge* cartridge) {
+
+	prg_rom = cartridge->GetPRGROM();
+	chr_rom = cartridge->GetCHRROM();
+
+	/* Truncated dumps are padded with zeros to whole banks, so bank numbers can always wrap around the size. */
+	if(prg_rom.empty() || (prg_rom.size() % 0x2000) != 0) {
+		padded_prg_rom.assign(std::max<size_t>((prg_rom.size() + 0x1FFF) & ~0x1FFF, 0x2000), 0);
+		std::copy(prg_rom.begin(), prg_rom.end(), padded_prg_rom.begin());
+		prg_rom = padded_prg_rom;
+	}
+
+	if((chr_rom.size() % 0x400) != 0) {
+		padded_chr_rom.assign((chr_rom.size() + 0x3FF) & ~0x3FF, 0);
+		std::copy(chr_rom.begin(), chr_rom.end(), padded_chr_rom.begin());
+		chr_rom = padded_chr_rom;
+	}
+
+	prg_ram = cartridge->AllocatePRGRAM((cartridge->GetPRGRAMSize() + 0x1FFF) & ~0x1FFF);
+
+	/* Boards without CHR ROM have CHR RAM in its place. */
+	if(chr_rom.empty()) {
+		chr_ram.assign(std::max<size_t>((cartridge->GetCHRRAMSize() + 0x3FF) & ~0x3FF, 0x2000), 0);
+	} else {
+		chr_ram.clear();
+	}
+
+	for(uint8_t slot = 0; slot < PRGSlotCount; slot++) {
+		UnmapPRG(slot);
+	}
+}
+
+void Mapper::MapPRG(uint8_t slot, uint16_t bank) {
+
+	const size_t bank_count = prg_rom.size() / 0x2000;
+
+	prg_read_slots[slot] = &prg_rom[(bank % bank_count) * 0x2000];
+	prg_write_slots[slot] = nullptr;
+}
+
+void Mapper::MapPRGRAM(uint8_t slot, uint16_t bank, bool writable) {
+
+	if(prg_ram.empty()) {
+		UnmapPRG(slot);
+		return;
+	}
+
+	const size_t bank_count = prg_ram.size() / 0x2000;
+
+	prg_read_slots[slot] = &prg_ram[(bank % bank_count) * 0x2000];
+	prg_write_slots[slot] = writable ? &prg_ram[(bank % bank_count) * 0x2000] : nullptr;
+}
+
+void Mapper::UnmapPRG(uint8_t slot) {
+	prg_read_slots[slot] = nullptr;
+	prg_write_slots[slot] = nullptr;
+}
+
+void Mapper::MapCHR(uint8_t slot, uint16_t bank) {
+	nes_system->GetPPU()->MapCHRPage(slot, GetCHRBank(bank), !chr_ram.empty());
+}
+
+uint8_t* Mapper::GetCHRBank(uint16_t bank) {
+
+	if(!chr_ram.empty()) {
+		return &chr_ram[(bank % (chr_ram.size() / 0x400)) * 0x400];
+	}
+
+	/* CHR ROM is mapped read only, so the PPU never writes through this. */
+	return const_cast<uint8_t*>(&chr_rom[(bank % (chr_rom.size() / 0x400)) * 0x400]);
+}
\ No newline at end of file
@@ -22,71 +22,119 @@
 #define __MAPPER_HPP__
 
 #include <cstdint>
-#include <map>
+#include <span>
 #include <string>
 #include <vector>
 
-typedef enum class bank_type {
-	PRG_ROM,
-	PRG_RAM,
-	CHR_ROM,
-	CHR_RAM
-} bank_type_t;
-
-typedef struct rom_bank {
-	bank_type type { bank_type::PRG_ROM };
-	uint16_t rom_address_start { 0 };
-	uint16_t rom_address_end { 0 };
-	uint16_t size { 0 };
-	std::vector<uint8_t> data { 0 };
-	bool mapped { false };
-} rom_bank_t;
-
 class Cartridge;
+class Mapper;
+class NESSystem;
+
+/* Makes a new mapper for a mapper number and variant, see Mapper::Register. */
+typedef Mapper* (*mapper_constructor_t)(NESSystem* nes_system, uint16_t number, uint8_t variant);
+
+/* Register a Mapper subclass for a mapper number and variant from its own .cpp file, before main runs. */
+#define REGISTER_MAPPER(mapper_class, number, variant) \
+	[[maybe_unused]] static const bool mapper_class##_registered_##number = Mapper::Register(number, variant, \
+		[](NESSystem* nes_system, uint16_t mapper_number, uint8_t mapper_variant) -> Mapper* { \
+			return new mapper_class(nes_system, mapper_number, mapper_variant); \
+		})
 
 class Mapper {
 
 	public:
+		virtual ~Mapper() {};
+
 		virtual void Initialize(Cartridge* cartride) =0;
 		virtual void Shutdown() =0;
 		
 		virtual void ApplyState() =0;
 
+		/* Only called for CPU addresses 0x4020 - 0xFFFF with no PRG slot mapped for reading or writing, the CPU accesses mapped
+		   slots itself. */
 		virtual uint8_t ReadCPU(uint16_t address) =0;
 		virtual void WriteCPU(uint16_t address, uint8_t value) =0;
 
-		virtual uint8_t ReadPPU(uint16_t address) =0;
-		virtual void WritePPU(uint16_t address, uint8_t value) =0;
-
-		rom_bank_t* DefineBank(uint16_t map_address_start, uint16_t map_address_end, bank_type_t type, bool mapped) {
-			rom_bank_t* new_bank = new rom_bank_t;
-			new_bank->mapped = mapped;
-			new_bank->rom_address_start = map_address_start;
-			new_bank->rom_address_end = map_address_end;
-			new_bank->size = (new_bank->rom_address_end - new_bank->rom_address_start) + 1;
-			new_bank->type = type;
-			new_bank->data.resize(new_bank->size);
-			return new_bank;
-		}
-
-		void DeleteBank(rom_bank_t* bank) {
-			if(bank) {
-				delete bank;
-			}
-		}
+		/* The PPU reads pattern tables directly from pages mapped with PPU::MapCHRPage, so there is no ReadPPU/WritePPU. */
+
+		/* Rising edge of PPU address line A12, only given to mappers that asked for it with PPU::WatchA12. */
+		virtual void ClockA12() {};
+
+		/* Start of scanlines 0 - 240, with whether the PPU fetches anything on it (never on 240), only given to mappers that
+		   asked for it with PPU::WatchScanlines. */
+		virtual void ClockScanline(bool /*rendering*/) {};
+
+		/* PPU cycle count by which the PPU has to be caught up for something the mapper does on its own, like raising IRQ, or
+		   PPU::NoEvent. Asked again whenever the PPU is caught up, and after NESSystem::ScheduleNextEvent. */
+		virtual uint64_t GetNextEventCycle();
+
+		/* CPU 0x6000 - 0xFFFF in 8kB slots, slot 0 being 0x6000. A slot is nullptr if accessing it needs ReadCPU/WriteCPU, which
+		   is also how a mapper sees accesses it has to react to, like registers on top of PRG RAM. ROM slots are never writable.
+		   The CPU holds on to these tables for the whole run. */
+		const uint8_t* const* GetPRGSlots() { return prg_read_slots; };
+		uint8_t* const* GetPRGWriteSlots() { return prg_write_slots; };
 
 		std::string GetName() { return mapper_name; };
-		uint8_t GetNumber() { return mapper_number; };
+		uint16_t GetNumber() { return mapper_number; };
 		uint8_t GetVariant() { return mapper_variant; };
 
+		/* Mappers add themselves here with REGISTER_MAPPER, so the cartridge only has to look its mapper number up. A
+		   constructor registered for AnyVariant makes every variant that has none of its own. */
+		static bool Register(uint16_t number, uint8_t variant, mapper_constructor_t constructor);
+
+		/* A new mapper for an iNES mapper number and variant (NES 2.0 submapper), nullptr if there is none. */
+		static Mapper* Create(NESSystem* nes_system, uint16_t number, uint8_t variant);
+
+		static const uint8_t AnyVariant { 0xFF };
+
+		static const uint8_t PRGSlotCount { 5 };
+		static const uint8_t CHRSlotCount { 8 };
+
 	protected:
-		Cartridge* cartridge;
+		/* Take PRG and CHR ROM from the cartridge, and set up zeroed PRG RAM and, on boards without CHR ROM, CHR RAM. */
+		void SetupMemory(Cartridge* cartridge);
+
+		/* Show 8kB bank number bank of PRG ROM or PRG RAM in a slot. Bank numbers wrap around the memory size, like the
+		   unconnected high bank bits on real boards. Write protected PRG RAM leaves writes to WriteCPU. */
+		void MapPRG(uint8_t slot, uint16_t bank);
+		void MapPRGRAM(uint8_t slot, uint16_t bank, bool writable = true);
+		void UnmapPRG(uint8_t slot);
+
+		/* Show 1kB bank number bank of CHR ROM (or CHR RAM) in PPU pattern table slot 0 - 7. */
+		void MapCHR(uint8_t slot, uint16_t bank);
+
+		/* The CHR memory MapCHR would show for a bank, for mappers handing the PPU banks some other way. */
+		uint8_t* GetCHRBank(uint16_t bank);
+
+		/* Reads and writes through the slots, for ReadCPU/WriteCPU. Writes to ROM or unmapped slots return false. */
+		const uint8_t* GetPRGSlot(uint16_t address) { return (address >= 0x6000) ? prg_read_slots[(address >> 13) - 3] : nullptr; };
+		bool WritePRG(uint16_t address, uint8_t value) {
+			uint8_t* slot = (address >= 0x6000) ? prg_write_slots[(address >> 13) - 3] : nullptr;
+			if(slot == nullptr) {
+				return false;
+			}
+			slot[address & 0x1FFF] = value;
+			return true;
+		};
+
+		NESSystem* nes_system { nullptr };
+		Cartridge* cartridge { nullptr };
+
+		std::span<const uint8_t> prg_rom;
+		std::span<const uint8_t> chr_rom;
+		/* Owned by the cartridge, and mapped from the save file when the board has a battery. */
+		std::span<uint8_t> prg_ram;
+		std::vector<uint8_t> chr_ram;
+
+		/* A copy of ROM padded to whole banks, only used by truncated dumps. */
+		std::vector<uint8_t> padded_prg_rom;
+		std::vector<uint8_t> padded_chr_rom;
 
-		std::map<uint16_t, rom_bank_t*> memory_map_cpu;
-		std::map<uint16_t, rom_bank_t*> memory_map_ppu;
+		const uint8_t* prg_read_slots[PRGSlotCount] { nullptr };
+		uint8_t* prg_write_slots[PRGSlotCount] { nullptr };
 
 		std::string mapper_name;
-		uint8_t mapper_number;
+		uint16_t mapper_number;
 		uint8_t mapper_variant;
 };
 
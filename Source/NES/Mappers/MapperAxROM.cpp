@@ -0,0 +1,43 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../../BitOps.hpp"
+
+#include "../NESSystem.hpp"
+#include "../PPU.hpp"
+#include "MapperDiscrete.hpp"
+#include "MapperAxROM.hpp"
+
+REGISTER_MAPPER(MapperAxROM, 7, Mapper::AnyVariant);
+
+MapperAxROM::MapperAxROM(NESSystem* nes_system, uint16_t number, uint8_t variant) : MapperDiscrete(nes_system, number, variant, "AxROM", variant == 2) {
+
+}
+
+void MapperAxROM::MapLatch(uint8_t value) {
+	MapPRG32K(value & 0x0F);
+	MapCHR8K(0);
+
+	if(BitCheck(value, 4)) {
+		nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::SINGLE_SCREEN_UPPER);
+	} else {
+		nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::SINGLE_SCREEN_LOWER);
+	}
+}
\ No newline at end of file
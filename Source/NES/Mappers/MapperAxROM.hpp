@@ -0,0 +1,46 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MAPPER_AXROM_HPP__
+#define __MAPPER_AXROM_HPP__
+
+#include <cstdint>
+
+#include "MapperDiscrete.hpp"
+
+/**
+ * AxROM Memory Map (ANROM, AMROM, AOROM):
+ *
+ * CPU $8000-$FFFF: 32 KB switchable PRG ROM bank
+ *
+ * PPU $0000-$1FFF: 8 KB CHR RAM
+ *
+ * Bit 4 of the latch picks which 1 KB of VRAM all four nametables show. Variant 2 (AMROM) has bus conflicts.
+ */
+class MapperAxROM final : public MapperDiscrete {
+
+	public:
+		MapperAxROM(NESSystem* nes_system, uint16_t number, uint8_t variant);
+
+	private:
+		void MapLatch(uint8_t value);
+};
+
+#endif /* __MAPPER_AXROM_HPP__ */
\ No newline at end of file
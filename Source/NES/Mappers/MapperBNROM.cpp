@@ -0,0 +1,92 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../Cartridge.hpp"
+#include "../NESSystem.hpp"
+#include "MapperDiscrete.hpp"
+#include "MapperBNROM.hpp"
+
+REGISTER_MAPPER(MapperBNROM, 34, Mapper::AnyVariant);
+
+MapperBNROM::MapperBNROM(NESSystem* nes_system, uint16_t number, uint8_t variant) : MapperDiscrete(nes_system, number, variant, "BNROM", variant == 2) {
+
+}
+
+void MapperBNROM::Initialize(Cartridge* cartridge) {
+
+	nina = (mapper_variant == 1) || (mapper_variant == 0 && cartridge->GetCHRROMSize() > 0x2000);
+
+	if(nina) {
+		mapper_name = "NINA-001";
+		bus_conflicts = false;
+	}
+
+	nina_registers[0] = 0;
+	nina_registers[1] = 0;
+	nina_registers[2] = 1;
+
+	MapperDiscrete::Initialize(cartridge);
+}
+
+void MapperBNROM::ApplyState() {
+
+	if(!nina) {
+		MapperDiscrete::ApplyState();
+		return;
+	}
+
+	MapPRG32K(nina_registers[0] & 0x01);
+	MapCHR4K(0x0000, nina_registers[1] & 0x0F);
+	MapCHR4K(0x1000, nina_registers[2] & 0x0F);
+
+	/* PRG RAM is read through its slot, writes come to WriteCPU in case they hit a register. */
+	MapPRGRAM(0, 0, false);
+}
+
+void MapperBNROM::WriteCPU(uint16_t address, uint8_t value) {
+
+	if(!nina || address < 0x6000 || address >= 0x8000) {
+		MapperDiscrete::WriteCPU(address, value);
+		return;
+	}
+
+	/* The registers are written through to the RAM underneath as well. */
+	if(!prg_ram.empty()) {
+		prg_ram[address & 0x1FFF] = value;
+	}
+
+	if(address >= 0x7FFD) {
+		nes_system->SyncPPU();
+
+		nina_registers[address - 0x7FFD] = value;
+		ApplyState();
+	}
+}
+
+void MapperBNROM::MapLatch(uint8_t value) {
+
+	if(nina) {
+		ApplyState();
+		return;
+	}
+
+	MapPRG32K(value);
+	MapCHR8K(0);
+}
\ No newline at end of file
@@ -0,0 +1,65 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MAPPER_BNROM_HPP__
+#define __MAPPER_BNROM_HPP__
+
+#include <cstdint>
+
+#include "MapperDiscrete.hpp"
+
+/**
+ * Mapper 34 is two unrelated boards.
+ *
+ * BNROM Memory Map (variant 2):
+ *
+ * CPU $8000-$FFFF: 32 KB switchable PRG ROM bank
+ *
+ * PPU $0000-$1FFF: 8 KB CHR RAM
+ *
+ * NINA-001 Memory Map (variant 1):
+ *
+ * CPU $6000-$7FFF: 8 KB PRG RAM, with the registers on top of its last 3 bytes
+ * CPU $7FFD:       32 KB PRG ROM bank select
+ * CPU $7FFE:       4 KB CHR ROM bank select for PPU $0000-$0FFF
+ * CPU $7FFF:       4 KB CHR ROM bank select for PPU $1000-$1FFF
+ *
+ * Dumps without a variant are NINA-001 when they have more than 8 KB of CHR ROM. BNROM has bus conflicts, NINA-001 doesn't.
+ */
+class MapperBNROM final : public MapperDiscrete {
+
+	public:
+		MapperBNROM(NESSystem* nes_system, uint16_t number, uint8_t variant);
+
+		void Initialize(Cartridge* cartridge);
+		void ApplyState();
+
+		void WriteCPU(uint16_t address, uint8_t value);
+
+	private:
+		void MapLatch(uint8_t value);
+
+		bool nina { false };
+
+		/* NINA-001 registers at 0x7FFD - 0x7FFF. */
+		uint8_t nina_registers[3] { 0 };
+};
+
+#endif /* __MAPPER_BNROM_HPP__ */
\ No newline at end of file
@@ -0,0 +1,116 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "../../HexOutput.hpp"
+
+#include "../Cartridge.hpp"
+#include "../NESSystem.hpp"
+#include "../PPU.hpp"
+#include "Mapper.hpp"
+#include "MapperDiscrete.hpp"
+
+MapperDiscrete::MapperDiscrete(NESSystem* nes_system, uint16_t number, uint8_t variant, std::string name, bool bus_conflicts) {
+	this->nes_system = nes_system;
+	this->bus_conflicts = bus_conflicts;
+	mapper_name = name;
+	mapper_number = number;
+	mapper_variant = variant;
+}
+
+MapperDiscrete::~MapperDiscrete() {
+
+}
+
+void MapperDiscrete::Initialize(Cartridge* cartridge) {
+	this->cartridge = cartridge;
+
+	SetupMemory(cartridge);
+
+	/* None of these boards have PRG RAM, but like NROM it is there for dumps whose header asks for it. */
+	if(cartridge->GetHeader()->prg_ram_size == 1) {
+		MapPRGRAM(0, 0);
+	}
+
+	latch = 0;
+	MapLatch(latch);
+}
+
+void MapperDiscrete::Shutdown() {
+
+}
+
+void MapperDiscrete::ApplyState() {
+	MapLatch(latch);
+}
+
+void MapperDiscrete::MapPRG32K(uint16_t bank) {
+	for(uint8_t slot = 1; slot < PRGSlotCount; slot++) {
+		MapPRG(slot, (bank * 4) + slot - 1);
+	}
+}
+
+void MapperDiscrete::MapPRG16K(uint16_t address, uint16_t bank) {
+	const uint8_t slot = (address >> 13) - 3;
+	MapPRG(slot, bank * 2);
+	MapPRG(slot + 1, (bank * 2) + 1);
+}
+
+void MapperDiscrete::MapCHR8K(uint16_t bank) {
+	for(uint8_t slot = 0; slot < CHRSlotCount; slot++) {
+		MapCHR(slot, (bank * 8) + slot);
+	}
+}
+
+void MapperDiscrete::MapCHR4K(uint16_t address, uint16_t bank) {
+	for(uint8_t slot = 0; slot < 4; slot++) {
+		MapCHR((address >> 10) + slot, (bank * 4) + slot);
+	}
+}
+
+uint8_t MapperDiscrete::ReadCPU(uint16_t address) {
+
+	std::cout << "Unknown ROM read from " << HEX4(address) << std::endl;
+	return 0x00;
+}
+
+void MapperDiscrete::WriteCPU(uint16_t address, uint8_t value) {
+
+	if(address >= 0x8000) {
+		if(bus_conflicts) {
+			value &= GetPRGSlot(address)[address & 0x1FFF];
+		}
+
+		/* CHR and mirroring changes show from this point of the frame on. */
+		nes_system->SyncPPU();
+
+		latch = value;
+		MapLatch(latch);
+		return;
+	}
+
+	if(WritePRG(address, value)) {
+		return;
+	}
+
+	std::cout << "Unknown ROM write " << HEX2(value) << " to " << HEX4(address) << std::endl;
+	return;
+}
\ No newline at end of file
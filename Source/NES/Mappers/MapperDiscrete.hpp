@@ -0,0 +1,73 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MAPPER_DISCRETE_HPP__
+#define __MAPPER_DISCRETE_HPP__
+
+#include <cstdint>
+#include <string>
+
+#include "Mapper.hpp"
+
+/**
+ * Discrete logic boards:
+ *
+ * Boards made from off the shelf 74 series chips instead of a mapper ASIC. A single latch written anywhere in 0x8000 - 0xFFFF
+ * drives the high PRG and CHR address lines directly, so a board is just which latch bits go to which bank.
+ *
+ * Boards with nothing stopping the ROM from driving the data bus during the write have bus conflicts: the latch sees the
+ * written value ANDed with the ROM byte at that address. Games avoid trouble by writing to a ROM byte holding the same value.
+ *
+ * Subclasses only say what banks a latch value selects in MapLatch. Everything else reads and writes through slots, with
+ * nothing extra per access over NROM.
+ */
+class MapperDiscrete : public Mapper {
+
+	public:
+		~MapperDiscrete();
+
+		void Initialize(Cartridge* cartridge);
+		void Shutdown();
+
+		void ApplyState();
+
+		uint8_t ReadCPU(uint16_t address);
+		void WriteCPU(uint16_t address, uint8_t value);
+
+	protected:
+		MapperDiscrete(NESSystem* nes_system, uint16_t number, uint8_t variant, std::string name, bool bus_conflicts);
+
+		/* Point the slots at the banks a latch value selects. Also called with 0 at power up. */
+		virtual void MapLatch(uint8_t value) =0;
+
+		/* Discrete boards switch 32KB or 16KB of PRG ROM and 8KB or 4KB of CHR at a time. */
+		void MapPRG32K(uint16_t bank);
+		void MapPRG16K(uint16_t address, uint16_t bank);
+		void MapCHR8K(uint16_t bank);
+		void MapCHR4K(uint16_t address, uint16_t bank);
+
+		/* Bank number of the last 16KB of PRG ROM. */
+		uint16_t LastPRG16K() { return static_cast<uint16_t>((prg_rom.size() + 0x3FFF) / 0x4000) - 1; };
+
+		uint8_t latch { 0 };
+		bool bus_conflicts { false };
+};
+
+#endif /* __MAPPER_DISCRETE_HPP__ */
\ No newline at end of file
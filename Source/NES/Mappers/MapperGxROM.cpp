@@ -0,0 +1,33 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MapperDiscrete.hpp"
+#include "MapperGxROM.hpp"
+
+REGISTER_MAPPER(MapperGxROM, 66, Mapper::AnyVariant);
+
+MapperGxROM::MapperGxROM(NESSystem* nes_system, uint16_t number, uint8_t variant) : MapperDiscrete(nes_system, number, variant, "GxROM", true) {
+
+}
+
+void MapperGxROM::MapLatch(uint8_t value) {
+	MapPRG32K((value >> 4) & 0x03);
+	MapCHR8K(value & 0x03);
+}
\ No newline at end of file
@@ -0,0 +1,46 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MAPPER_GXROM_HPP__
+#define __MAPPER_GXROM_HPP__
+
+#include <cstdint>
+
+#include "MapperDiscrete.hpp"
+
+/**
+ * GxROM Memory Map (GNROM, MHROM):
+ *
+ * CPU $8000-$FFFF: 32 KB switchable PRG ROM bank, latch bits 4 - 5
+ *
+ * PPU $0000-$1FFF: 8 KB switchable CHR ROM bank, latch bits 0 - 1
+ *
+ * The board has bus conflicts.
+ */
+class MapperGxROM final : public MapperDiscrete {
+
+	public:
+		MapperGxROM(NESSystem* nes_system, uint16_t number, uint8_t variant);
+
+	private:
+		void MapLatch(uint8_t value);
+};
+
+#endif /* __MAPPER_GXROM_HPP__ */
\ No newline at end of file
@@ -29,7 +29,10 @@
 #include "Mapper.hpp"
 #include "MapperMMC1.hpp"
 
-MapperMMC1::MapperMMC1(NESSystem* nes_system, uint8_t number, uint8_t variant) : nes_system(nes_system) {
+REGISTER_MAPPER(MapperMMC1, 1, Mapper::AnyVariant);
+
+MapperMMC1::MapperMMC1(NESSystem* nes_system, uint16_t number, uint8_t variant) {
+	this->nes_system = nes_system;
 	mapper_number = number;
 	mapper_variant = variant;
 
@@ -75,54 +78,20 @@ MapperMMC1::~MapperMMC1() {
 void MapperMMC1::Initialize(Cartridge* cartridge) {
 	this->cartridge = cartridge;
 
-	/* Start with 16k PRG swapping, on 0x8000 - 0xBFFF. */
-	control_register = 0x0C;
-
-	prg_ram_bank = DefineBank(0x6000, 0x7FFF, bank_type::PRG_RAM, true);
-	prg_rom_bank_1 = DefineBank(0x8000, 0xBFFF, bank_type::PRG_ROM, true);
-	prg_rom_bank_2 = DefineBank(0xC000, 0xFFFF, bank_type::PRG_ROM, true);
-
-	chr_rom_bank_1 = DefineBank(0x0000, 0x0FFF, bank_type::CHR_ROM, true);
-	chr_rom_bank_2 = DefineBank(0x1000, 0x1FFF, bank_type::CHR_ROM, true);
-
-	memory_map_cpu[prg_ram_bank->rom_address_start] = prg_ram_bank;
-	memory_map_cpu[prg_rom_bank_1->rom_address_start] = prg_rom_bank_1;
-	memory_map_cpu[prg_rom_bank_2->rom_address_start] = prg_rom_bank_2;
-
-	memory_map_ppu[chr_rom_bank_1->rom_address_start] = chr_rom_bank_1;
-	memory_map_ppu[chr_rom_bank_2->rom_address_start] = chr_rom_bank_2;
-
-	/* Initialize RAM to zeros. */
-	for(size_t i = 0; i < prg_ram_bank->size; i++) {
-		prg_ram_bank->data[i] = 0x0;
-	}
-
-	/* First ROM bank is at the top. */
-	for(size_t i = 0; i < prg_rom_bank_1->size; i++) {
-		prg_rom_bank_1->data[i] = cartridge->GetFileMemory()[i + cartridge->GetHeaderOffset()];
-	}
-
-	/* Second ROM bank is 0x4000 bytes after the first. */
-	for(size_t i = 0; i < prg_rom_bank_2->size; i++) {
-		prg_rom_bank_2->data[i] = cartridge->GetFileMemory()[i + 0x4000 + cartridge->GetHeaderOffset()];
-	}
+	SetupMemory(cartridge);
 
-	/* First CHR ROM bank is 0x8000 bytes after PRG ROM. */
-	for(size_t i = 0; i < chr_rom_bank_1->size; i++) {
-		chr_rom_bank_1->data[i] = cartridge->GetFileMemory()[i + 0x4000 + 0x4000 + cartridge->GetHeaderOffset()];
-	}
+	/* Power up with 16k PRG swapping on 0x8000 - 0xBFFF, and the last bank fixed at 0xC000. Mirroring stays as the header says
+	   until the game sets it. */
+	control_register = 0x0C;
+	chr_bank0_register = 0;
+	chr_bank1_register = 0;
+	prg_bank_register = 0;
 
-	for(size_t i = 0; i < chr_rom_bank_2->size; i++) {
-		chr_rom_bank_2->data[i] = cartridge->GetFileMemory()[i + 0x4000 + 0x4000 + 0x4000 + cartridge->GetHeaderOffset()];
-	}
+	MapBanks();
 }
 
 void MapperMMC1::Shutdown() {
-	DeleteBank(prg_ram_bank);
-	DeleteBank(prg_rom_bank_1);
-	DeleteBank(prg_rom_bank_2);
-	DeleteBank(chr_rom_bank_1);
-	DeleteBank(chr_rom_bank_2);
+
 }
 
 void MapperMMC1::ApplyState() {
@@ -130,74 +99,94 @@ void MapperMMC1::ApplyState() {
 	/* Control register mirroring. */
 	switch(control_register & 0x03) {
 		case 0: /* One-screen lower bank. */
-			nes_system->GetPPU()->SetMirroringMode();
+			nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::SINGLE_SCREEN_LOWER);
 			break;
 		case 1: /* One-screen upper bank. */
-			nes_system->GetPPU()->SetMirroringMode();
+			nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::SINGLE_SCREEN_UPPER);
 			break;
 		case 2: /* Vertical */
-			nes_system->GetPPU()->SetMirroringMode();
+			nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::VERTICAL);
 			break;
 		case 3: /* Horizontal */
-			nes_system->GetPPU()->SetMirroringMode();
+			nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::HORIZONTAL);
+			break;
 		default:
 			/* Unreachable. */
 			break;
 	}
 
+	MapBanks();
+}
+
+void MapperMMC1::MapBanks() {
+
+	/* SUROM and SXROM take bit 4 of the CHR bank 0 register as a 256KB outer PRG ROM bank. In 4KB CHR mode the hardware uses
+	   whichever CHR register the PPU last fetched through, games keep both the same so CHR bank 0 is used here. */
+	const uint16_t prg_outer_bank = (prg_rom.size() > 0x40000) ? (chr_bank0_register & 0x10) : 0;
+	const uint16_t prg_bank = prg_outer_bank | (prg_bank_register & 0x0F);
+
+	/* 16KB banks are pairs of 8KB slots. */
+	auto map_prg_16k = [this](uint8_t slot, uint16_t bank) {
+		MapPRG(slot, bank * 2);
+		MapPRG(slot + 1, bank * 2 + 1);
+	};
+
 	/* Control register PRG ROM banking mode. */
 	switch((control_register & 0x0C) >> 2) {
 		case 0:
+		case 1: /* Switch 32KB at 0x8000, ignoring the low bit of the bank number. */
+			map_prg_16k(1, prg_bank & ~0x01);
+			map_prg_16k(3, prg_bank | 0x01);
 			break;
-		case 1:
-			break;
-		case 2:
+		case 2: /* Fix first bank at 0x8000 and switch 16KB bank at 0xC000 */
+			map_prg_16k(1, prg_outer_bank);
+			map_prg_16k(3, prg_bank);
 			break;
 		case 3: /* Fix last bank at 0xC000 and switch 16KB bank at 0x8000 */
 		default:
-			/* Unreachable. */
+			map_prg_16k(1, prg_bank);
+			map_prg_16k(3, prg_outer_bank | 0x0F);
 			break;
 	}
 
 	/* Control register CHR ROM banking mode. */
 	if(BitCheck(control_register, 4)) {
 		/* Switch two seperate 4KB banks. */
+		for(uint8_t slot = 0; slot < 4; slot++) {
+			MapCHR(slot, chr_bank0_register * 4 + slot);
+			MapCHR(slot + 4, chr_bank1_register * 4 + slot);
+		}
 	} else {
-		/* Switch 8KB at a time. */
+		/* Switch 8KB at a time, ignoring the low bit of the bank number. */
+		for(uint8_t slot = 0; slot < CHRSlotCount; slot++) {
+			MapCHR(slot, (chr_bank0_register & ~0x01) * 4 + slot);
+		}
 	}
 
-	/* PRG bank register. */
+	/* SXROM (32KB) selects its 8KB PRG RAM bank with bits 2 - 3 of the CHR bank 0 register, SOROM (16KB) with bit 3. */
+	uint8_t prg_ram_bank = 0;
+
+	if(prg_ram.size() > 0x4000) {
+		prg_ram_bank = (chr_bank0_register >> 2) & 0x03;
+	} else if(prg_ram.size() > 0x2000) {
+		prg_ram_bank = (chr_bank0_register >> 3) & 0x01;
+	}
 
 	/* PRG bank PRG RAM enable. */
-	if(BitCheck(prg_bank_register, 4)) {
+	if(BitCheck(prg_bank_register, 4) && mapper_name != "MMC1A") {
 		/* PRG RAM disabled. */
-		prg_ram_bank->mapped = false;
+		UnmapPRG(0);
 	} else {
-		/* PRG RAM enabled. */
-		prg_ram_bank->mapped = true;
-	}
-
-	if(mapper_name == "MMC1A") {
-		/* PRG RAM is always enabled on this variant. */
-		prg_ram_bank->mapped = true;
+		/* PRG RAM enabled, always on MMC1A. */
+		MapPRGRAM(0, prg_ram_bank);
 	}
 }
 
 uint8_t MapperMMC1::ReadCPU(uint16_t address) {
 
-	/* Read from PRG RAM */
+	/* Disabled PRG RAM is open bus. */
 	if(address >= 0x6000 && address <= 0x7FFF) {
-		if(prg_ram_bank->mapped) {
-			return memory_map_cpu[0x6000]->data[address - 0x6000];
-		}
-	} 
-
-	if(address >= 0x8000 && address <= 0xBFFF) {
-		return memory_map_cpu[0x8000]->data[address - 0x8000];
-	}
-
-	if(address >= 0xC000 && address <= 0xFFFF) {
-		return memory_map_cpu[0xC000]->data[address - 0xC000];
+		return nes_system->GetFloatingBus();
 	}
 
 	std::cout << "Unknown ROM read from " << HEX(address) << std::endl;
@@ -206,46 +195,56 @@ uint8_t MapperMMC1::ReadCPU(uint16_t address) {
 
 void MapperMMC1::WriteCPU(uint16_t address, uint8_t value) {
 
-	/* Write to PRG RAM */
+	/* Write to PRG RAM, or dropped while it is disabled. */
 	if(address >= 0x6000 && address <= 0x7FFF) {
-		if(prg_ram_bank->mapped) {
-			memory_map_cpu[0x6000]->data[address - 0x6000] = value;
-			return;
-		}
-	} 
+		WritePRG(address, value);
+		return;
+	}
 
 	/* The MMC1 serial port exists at any address between 0x8000 and 0xFFFF. */
-	if(address >= 0x8000 || address <= 0xFFFF) {
+	if(address >= 0x8000) {
 
-		/* Any write to 0x8000 through 0xFFFF with value bit 7 set clears shift register and ORs control register with 0xC0. */
+		/* CHR and mirroring changes show from this point of the frame on. */
+		nes_system->SyncPPU();
+
+		/* Any write to 0x8000 through 0xFFFF with value bit 7 set clears shift register and sets PRG mode 3. */
 		if(BitCheck(value, 7)) {
 			shift_register = 0;
 			write_counter = 0;
 
-			control_register |= 0xC0;
+			control_register |= 0x0C;
 
 			ApplyState();
 			return;
 		}
 
-		/* Count four writes with bit 7 clear. */
-		if(!BitCheck(value, 7) && write_counter <= 4) {
-			shift_register += BitCheck(value, 0);
-			shift_register <<= 1;
-			write_counter++;
-			return;
-		}
+		/* Bits come in LSB first, bit 0 of each write. */
+		shift_register = (shift_register >> 1) | ((value & 0x01) << 4);
+		write_counter++;
 
 		/* Fifth write is where the magic happens. Bits 13 and 14 of address select the MMC1 register. */
-		if(!BitCheck(value, 7) && write_counter == 5) {
-			shift_register += BitCheck(value, 0);
-			write_counter = 0;
+		if(write_counter == 5) {
+			register_select = (address >> 13) & 0x03;
+
+			switch(register_select) {
+				case 0:
+					control_register = shift_register;
+					break;
+				case 1:
+					chr_bank0_register = shift_register;
+					break;
+				case 2:
+					chr_bank1_register = shift_register;
+					break;
+				case 3:
+					prg_bank_register = shift_register;
+					break;
+			}
 
-			register_select  = BitCheck(address, 13);
-			register_select += BitCheck(address, 14) << 1;
+			shift_register = 0;
+			write_counter = 0;
 
 			ApplyState();
-			return;
 		}
 
 		return;
@@ -253,23 +252,4 @@ void MapperMMC1::WriteCPU(uint16_t address, uint8_t value) {
 
 	std::cout << "Unknown ROM write " << HEX2(value) << " to " << HEX4(address) << std::endl;
 	return;
-}
-
-uint8_t MapperMMC1::ReadPPU(uint16_t address) {
-
-	if(address >= 0x0000 && address <= 0x0FFF) {
-		return memory_map_ppu[0x0000]->data[address];
-	}
-
-	if(address >= 0x1000 && address <= 0x1FFF) {
-		return memory_map_ppu[0x1000]->data[address];
-	}
-
-	std::cout << "Unknown ROM read from " << HEX4(address) << std::endl;
-	return 0x00;
-}
-
-void MapperMMC1::WritePPU(uint16_t address, uint8_t value) {
-	std::cout << "Unknown PPU write " << HEX2(value) << " to " << HEX4(address) << std::endl;
-	return;
 }
\ No newline at end of file
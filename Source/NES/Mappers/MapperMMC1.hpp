@@ -40,10 +40,10 @@
  * CHR ROM max is 128k, minimum bank size 4k, leading to 32 banks possible.
  *
  */
-class MapperMMC1 : public Mapper {
+class MapperMMC1 final : public Mapper {
 
 	public:
-		MapperMMC1(NESSystem* nes_system, uint8_t number, uint8_t variant);
+		MapperMMC1(NESSystem* nes_system, uint16_t number, uint8_t variant);
 		~MapperMMC1();
 
 		void Initialize(Cartridge* cartridge);
@@ -54,18 +54,9 @@ class MapperMMC1 : public Mapper {
 		uint8_t ReadCPU(uint16_t address);
 		void WriteCPU(uint16_t address, uint8_t value);
 
-		uint8_t ReadPPU(uint16_t address);
-		void WritePPU(uint16_t address, uint8_t value);
-
 	private:
-		NESSystem* nes_system;
-
-		rom_bank_t* prg_ram_bank;
-		rom_bank_t* prg_rom_bank_1;
-		rom_bank_t* prg_rom_bank_2;
-
-		rom_bank_t* chr_rom_bank_1;
-		rom_bank_t* chr_rom_bank_2;
+		/* Point the PRG, CHR and PRG RAM slots at the banks the registers select. */
+		void MapBanks();
 
 		uint8_t control_register;
 		uint8_t chr_bank0_register;
@@ -0,0 +1,240 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include "../../BitOps.hpp"
+#include "../../HexOutput.hpp"
+
+#include "../Cartridge.hpp"
+#include "../CPU.hpp"
+#include "../NESSystem.hpp"
+#include "../PPU.hpp"
+#include "Mapper.hpp"
+#include "MapperMMC3.hpp"
+
+REGISTER_MAPPER(MapperMMC3, 4, Mapper::AnyVariant);
+
+MapperMMC3::MapperMMC3(NESSystem* nes_system, uint16_t number, uint8_t variant) {
+	this->nes_system = nes_system;
+	mapper_number = number;
+	mapper_variant = variant;
+
+	switch(mapper_variant) {
+		case 0:
+			mapper_name = "MMC3";
+			break;
+		default:
+			std::cout << "Unsupported MMC3 mapper variant, assuming normal." << std::endl;
+			mapper_name = "MMC3";
+			break;
+	}
+}
+
+MapperMMC3::~MapperMMC3() {
+	mapper_name = "";
+	mapper_number = 0;
+	mapper_variant = 0;
+}
+
+void MapperMMC3::Initialize(Cartridge* cartridge) {
+	this->cartridge = cartridge;
+
+	SetupMemory(cartridge);
+
+	/* Banks power up in no particular state, these give a sensible CHR layout until the game sets its own. The last bank is
+	   always at 0xE000, which is all that is needed to boot. */
+	bank_select = 0;
+	bank_registers[0] = 0;
+	bank_registers[1] = 2;
+	bank_registers[2] = 4;
+	bank_registers[3] = 5;
+	bank_registers[4] = 6;
+	bank_registers[5] = 7;
+	bank_registers[6] = 0;
+	bank_registers[7] = 1;
+
+	/* Mirroring stays as the header says until the game sets it. */
+	prg_ram_protect = 0x80;
+
+	irq_latch = 0;
+	irq_counter = 0;
+	irq_reload = false;
+	irq_enabled = false;
+
+	nes_system->GetPPU()->WatchA12(true);
+
+	MapBanks();
+}
+
+void MapperMMC3::Shutdown() {
+	nes_system->GetPPU()->WatchA12(false);
+	nes_system->GetCPU()->SetIRQLine(IRQ_SOURCE_MAPPER, false);
+}
+
+void MapperMMC3::ApplyState() {
+
+	/* Four screen boards wire up their own VRAM and ignore the mirroring register. */
+	if(!BitCheck(cartridge->GetHeader()->flags1, 3)) {
+		if(BitCheck(mirroring, 0)) {
+			nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::HORIZONTAL);
+		} else {
+			nes_system->GetPPU()->SetMirroringMode(PPU::MirroringMode::VERTICAL);
+		}
+	}
+
+	MapBanks();
+}
+
+void MapperMMC3::MapBanks() {
+
+	const uint16_t last_bank = static_cast<uint16_t>(prg_rom.size() / 0x2000) - 1;
+
+	/* PRG ROM mode swaps the switchable R6 bank and the fixed second last bank between 0x8000 and 0xC000. */
+	if(BitCheck(bank_select, 6)) {
+		MapPRG(1, last_bank - 1);
+		MapPRG(3, bank_registers[6]);
+	} else {
+		MapPRG(1, bank_registers[6]);
+		MapPRG(3, last_bank - 1);
+	}
+
+	MapPRG(2, bank_registers[7]);
+	MapPRG(4, last_bank);
+
+	/* CHR inversion swaps the 2KB banks at 0x0000 with the 1KB banks at 0x1000. The 2KB banks ignore the low bit. */
+	const uint8_t inversion = BitCheck(bank_select, 7) ? 4 : 0;
+
+	MapCHR(0 ^ inversion, bank_registers[0] & 0xFE);
+	MapCHR(1 ^ inversion, bank_registers[0] | 0x01);
+	MapCHR(2 ^ inversion, bank_registers[1] & 0xFE);
+	MapCHR(3 ^ inversion, bank_registers[1] | 0x01);
+
+	for(uint8_t slot = 0; slot < 4; slot++) {
+		MapCHR((4 + slot) ^ inversion, bank_registers[2 + slot]);
+	}
+
+	if(BitCheck(prg_ram_protect, 7)) {
+		MapPRGRAM(0, 0, !BitCheck(prg_ram_protect, 6));
+	} else {
+		UnmapPRG(0);
+	}
+}
+
+uint8_t MapperMMC3::ReadCPU(uint16_t address) {
+
+	/* Disabled PRG RAM is open bus. */
+	if(address >= 0x6000 && address <= 0x7FFF) {
+		return nes_system->GetFloatingBus();
+	}
+
+	std::cout << "Unknown ROM read from " << HEX(address) << std::endl;
+	return 0x00;
+}
+
+void MapperMMC3::WriteCPU(uint16_t address, uint8_t value) {
+
+	/* Write to PRG RAM, or dropped while it is disabled or write protected. */
+	if(address >= 0x6000 && address <= 0x7FFF) {
+		WritePRG(address, value);
+		return;
+	}
+
+	if(address >= 0x8000) {
+
+		/* Everything here changes what the PPU shows or when IRQ fires from this point in the frame on. */
+		nes_system->SyncPPU();
+
+		/* Each 8KB range has two registers, at even and odd addresses. */
+		switch(address & 0xE001) {
+			case 0x8000:
+				bank_select = value;
+				MapBanks();
+				break;
+			case 0x8001:
+				bank_registers[bank_select & 0x07] = value;
+				MapBanks();
+				break;
+			case 0xA000:
+				mirroring = value;
+				ApplyState();
+				break;
+			case 0xA001:
+				prg_ram_protect = value;
+				MapBanks();
+				break;
+			case 0xC000:
+				irq_latch = value;
+				break;
+			case 0xC001:
+				/* The counter is reloaded from the latch on the next clock. */
+				irq_counter = 0;
+				irq_reload = true;
+				break;
+			case 0xE000:
+				/* Disabling also acknowledges a pending IRQ. */
+				irq_enabled = false;
+				nes_system->GetCPU()->SetIRQLine(IRQ_SOURCE_MAPPER, false);
+				break;
+			case 0xE001:
+				irq_enabled = true;
+				break;
+		}
+
+		if(address >= 0xC000) {
+			nes_system->ScheduleNextEvent();
+		}
+
+		return;
+	}
+
+	std::cout << "Unknown ROM write " << HEX2(value) << " to " << HEX4(address) << std::endl;
+	return;
+}
+
+void MapperMMC3::ClockA12() {
+
+	if(irq_counter == 0 || irq_reload) {
+		irq_counter = irq_latch;
+		irq_reload = false;
+	} else {
+		irq_counter--;
+	}
+
+	if(irq_counter == 0 && irq_enabled) {
+		nes_system->GetCPU()->SetIRQLine(IRQ_SOURCE_MAPPER, true);
+	}
+}
+
+uint64_t MapperMMC3::GetNextEventCycle() {
+
+	if(!irq_enabled) {
+		return PPU::NoEvent;
+	}
+
+	/* Counting down from the latch takes one clock to reload it and then one per count. */
+	uint16_t clocks = (irq_counter == 0 || irq_reload) ? irq_latch + 1 : irq_counter;
+
+	if(nes_system->IsExactMapperIRQ()) {
+		clocks = 1;
+	}
+
+	return nes_system->GetPPU()->GetA12ClockCycle(clocks);
+}
\ No newline at end of file
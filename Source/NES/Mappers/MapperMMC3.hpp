@@ -0,0 +1,85 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MAPPER_MMC3_HPP__
+#define __MAPPER_MMC3_HPP__
+
+#include <cstdint>
+
+#include "../NESSystem.hpp"
+#include "Mapper.hpp"
+
+/**
+ * MMC3 Memory Map:
+ *
+ * CPU $6000-$7FFF: 8 KB PRG RAM bank, can be disabled or write protected
+ * CPU $8000-$9FFF: 8 KB switchable PRG ROM bank, or fixed to the second last bank
+ * CPU $A000-$BFFF: 8 KB switchable PRG ROM bank
+ * CPU $C000-$DFFF: 8 KB PRG ROM bank, fixed to the second last bank or switchable
+ * CPU $E000-$FFFF: 8 KB PRG ROM bank, fixed to the last bank
+ *
+ * PPU $0000-$07FF: 2 KB switchable CHR bank (or $1000-$17FF with CHR inversion)
+ * PPU $0800-$0FFF: 2 KB switchable CHR bank
+ * PPU $1000-$1FFF: 4 x 1 KB switchable CHR banks (or $0000-$0FFF with CHR inversion)
+ *
+ * The scanline counter is clocked by rises of PPU A12, which with the usual pattern table layout is once per rendered scanline.
+ * The PPU works out when those happen from its fetch pattern, so the PPU is only caught up for the IRQ itself (see
+ * NESSystem::SetExactMapperIRQ to have it caught up on every clock instead).
+ *
+ */
+class MapperMMC3 final : public Mapper {
+
+	public:
+		MapperMMC3(NESSystem* nes_system, uint16_t number, uint8_t variant);
+		~MapperMMC3();
+
+		void Initialize(Cartridge* cartridge);
+		void Shutdown();
+
+		void ApplyState();
+
+		uint8_t ReadCPU(uint16_t address);
+		void WriteCPU(uint16_t address, uint8_t value);
+
+		void ClockA12();
+		uint64_t GetNextEventCycle();
+
+	private:
+		/* Point the PRG, CHR and PRG RAM slots at the banks the registers select. */
+		void MapBanks();
+
+		/* Bits 0 - 2 select the bank register 0x8001 writes, bit 6 the PRG ROM mode and bit 7 CHR inversion. */
+		uint8_t bank_select { 0 };
+
+		/* R0 - R1 are 2KB CHR banks, R2 - R5 1KB CHR banks, R6 - R7 8KB PRG ROM banks. */
+		uint8_t bank_registers[8] { 0 };
+
+		uint8_t mirroring { 0 };
+
+		/* Bit 7 enables PRG RAM, bit 6 denies writes to it. */
+		uint8_t prg_ram_protect { 0 };
+
+		uint8_t irq_latch { 0 };
+		uint8_t irq_counter { 0 };
+		bool irq_reload { false };
+		bool irq_enabled { false };
+};
+
+#endif /* __MAPPER_MMC3_HPP__ */
\ No newline at end of file
@@ -18,51 +18,457 @@
  * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <cstring>
 #include <iostream>
 
+#include "../../BitOps.hpp"
 #include "../../HexOutput.hpp"
 
+#include "../Cartridge.hpp"
+#include "../CPU.hpp"
 #include "../NESSystem.hpp"
+#include "../PPU.hpp"
+#include "Mapper.hpp"
 #include "MapperMMC5.hpp"
 
-MapperMMC5::MapperMMC5(NESSystem* nes_system, uint8_t number, uint8_t variant) : nes_system(nes_system) {
+REGISTER_MAPPER(MapperMMC5, 5, Mapper::AnyVariant);
+
+MapperMMC5::MapperMMC5(NESSystem* nes_system, uint16_t number, uint8_t variant) {
+	this->nes_system = nes_system;
 	mapper_name = "MMC5";
 	mapper_number = number;
 	mapper_variant = variant;
 }
 
 MapperMMC5::~MapperMMC5() {
-
+	mapper_name = "";
+	mapper_number = 0;
+	mapper_variant = 0;
 }
 
 void MapperMMC5::Initialize(Cartridge* cartridge) {
 	this->cartridge = cartridge;
+
+	SetupMemory(cartridge);
+
+	/* iNES 1.0 headers can't say how much PRG RAM the board has, anything up to 64KB. All of it runs every game, the bank
+	   numbers each size uses all lead to different banks of 64KB. */
+	if(!cartridge->GetHeader()->is_iNES2 && !cartridge->IsInDatabase()) {
+		prg_ram = cartridge->AllocatePRGRAM(0x10000);
+	}
+
+	/* Only the last PRG bank is known at power on, which is enough to boot in 8KB mode. */
+	prg_mode = PRG_MODE3;
+	std::memset(prg_banks, 0, sizeof(prg_banks));
+	prg_banks[4] = 0xFF;
+	std::memset(prg_ram_protect, 0, sizeof(prg_ram_protect));
+
+	chr_mode = CHR_MODE0;
+	std::memset(chr_banks, 0, sizeof(chr_banks));
+	chr_bank_high = 0;
+	chr_set_b_written = false;
+
+	expansion_ram_mode = EXPANSION_RAM_NAMETABLE;
+	std::memset(expansion_ram, 0, sizeof(expansion_ram));
+	std::memset(fill_nametable, 0, sizeof(fill_nametable));
+
+	/* Nametables follow the header's mirroring until the game maps its own. */
+	nametable_mapping = BitCheck(cartridge->GetHeader()->flags1, 0) ? 0x44 : 0x50;
+
+	split_control = 0;
+	split_scroll = 0;
+	split_bank = 0;
+
+	in_frame = false;
+	irq_compare = 0;
+	irq_counter = 0;
+	irq_enabled = false;
+	irq_pending = false;
+
+	background_fetch.expansion = expansion_ram;
+
+	if(!chr_ram.empty()) {
+		background_fetch.chr = chr_ram.data();
+		background_fetch.chr_banks = chr_ram.size() / 0x1000;
+	} else {
+		background_fetch.chr = chr_rom.data();
+		background_fetch.chr_banks = chr_rom.size() / 0x1000;
+	}
+
+	nes_system->GetPPU()->WatchScanlines(true);
+	nes_system->GetPPU()->SetBackgroundFetch(&background_fetch);
+
+	ApplyState();
 }
 
 void MapperMMC5::Shutdown() {
-
+	nes_system->GetPPU()->WatchScanlines(false);
+	nes_system->GetPPU()->SetBackgroundFetch(nullptr);
+	nes_system->GetCPU()->SetIRQLine(IRQ_SOURCE_MAPPER, false);
 }
 
 void MapperMMC5::ApplyState() {
+	MapPRGBanks();
+	MapCHRBanks();
+	MapNametables();
+	UpdateBackgroundFetch();
+}
+
+void MapperMMC5::MapPRGBanks() {
+
+	/* 0x6000 is always PRG RAM. */
+	MapPRGRegister(0, prg_banks[0] & 0x7F);
+
+	/* Bigger banks ignore the low bits of their register, and the last register always selects ROM. */
+	switch(prg_mode) {
+		case PRG_MODE0:
+			for(uint8_t slot = 1; slot < PRGSlotCount; slot++) {
+				MapPRG(slot, (prg_banks[4] & 0x7C) + (slot - 1));
+			}
+			break;
+		case PRG_MODE1:
+			MapPRGRegister(1, prg_banks[2] & 0xFE);
+			MapPRGRegister(2, prg_banks[2] | 0x01);
+			MapPRG(3, prg_banks[4] & 0x7E);
+			MapPRG(4, (prg_banks[4] & 0x7F) | 0x01);
+			break;
+		case PRG_MODE2:
+			MapPRGRegister(1, prg_banks[2] & 0xFE);
+			MapPRGRegister(2, prg_banks[2] | 0x01);
+			MapPRGRegister(3, prg_banks[3]);
+			MapPRG(4, prg_banks[4] & 0x7F);
+			break;
+		case PRG_MODE3:
+			MapPRGRegister(1, prg_banks[1]);
+			MapPRGRegister(2, prg_banks[2]);
+			MapPRGRegister(3, prg_banks[3]);
+			MapPRG(4, prg_banks[4] & 0x7F);
+			break;
+	}
+}
+
+void MapperMMC5::MapPRGRegister(uint8_t slot, uint8_t value) {
+
+	if(BitCheck(value, 7)) {
+		MapPRG(slot, value & 0x7F);
+		return;
+	}
+
+	/* Boards with two 8KB RAM chips pick the chip with bit 2. */
+	uint8_t bank = value & 0x07;
+
+	if(prg_ram.size() == 0x4000) {
+		bank >>= 2;
+	}
+
+	const bool writable = ((prg_ram_protect[0] & 0x03) == 0x02) && ((prg_ram_protect[1] & 0x03) == 0x01);
+
+	MapPRGRAM(slot, bank, writable);
+}
+
+uint16_t MapperMMC5::GetCHRPageBank(bool set_b, uint8_t page) {
+
+	/* Set B only has four registers, which cover 0x0000 - 0x0FFF and are repeated for 0x1000 - 0x1FFF. */
+	switch(chr_mode) {
+		case CHR_MODE0:
+			return (chr_banks[set_b ? 11 : 7] * 8) + page;
+		case CHR_MODE1:
+			return (chr_banks[set_b ? 11 : ((page < 4) ? 3 : 7)] * 4) + (page & 0x03);
+		case CHR_MODE2:
+			return (chr_banks[set_b ? (9 + (page & 0x02)) : (1 + (page & 0x06))] * 2) + (page & 0x01);
+		default:
+			return chr_banks[set_b ? (8 + (page & 0x03)) : page];
+	}
+}
+
+void MapperMMC5::MapCHRBanks() {
+
+	/* While rendering set A is for sprites, and with 8x16 sprites set B goes to the background through background_fetch.
+	   Outside rendering the PPU reads through whichever set was written last. */
+	const bool set_b = chr_set_b_written && !in_frame;
+
+	for(uint8_t page = 0; page < 8; page++) {
+		MapCHR(page, GetCHRPageBank(set_b, page));
+		background_fetch.pattern_pages[page] = GetCHRBank(GetCHRPageBank(true, page));
+	}
+}
+
+void MapperMMC5::MapNametables() {
+
+	PPU* ppu = nes_system->GetPPU();
+
+	for(uint8_t page = 0; page < 4; page++) {
+		switch((nametable_mapping >> (page * 2)) & 0x03) {
+			case 0:
+				ppu->MapNametableVRAM(page, 0);
+				break;
+			case 1:
+				ppu->MapNametableVRAM(page, 1);
+				break;
+			case 2:
+				/* Expansion RAM used as plain RAM reads as 0 to the PPU. */
+				if(expansion_ram_mode <= EXPANSION_RAM_EXTENDED_ATTRIBUTES) {
+					ppu->MapNametablePage(page, expansion_ram);
+				} else {
+					ppu->MapNametablePage(page, nullptr);
+				}
+				break;
+			case 3:
+				ppu->MapNametablePage(page, fill_nametable, false);
+				break;
+		}
+	}
+}
+
+void MapperMMC5::UpdateBackgroundFetch() {
+
+	/* The split takes its nametable from expansion RAM, so only works in the modes the PPU can see it in. */
+	const bool fetches_chr = background_fetch.chr_banks != 0;
 
+	background_fetch.extended_attributes = fetches_chr && (expansion_ram_mode == EXPANSION_RAM_EXTENDED_ATTRIBUTES);
+	background_fetch.extended_bank_high = chr_bank_high;
+
+	background_fetch.split = fetches_chr && BitCheck(split_control, 7) && (expansion_ram_mode <= EXPANSION_RAM_EXTENDED_ATTRIBUTES);
+	background_fetch.split_right = BitCheck(split_control, 6);
+	background_fetch.split_tile = split_control & 0x1F;
+	background_fetch.split_scroll = split_scroll;
+	background_fetch.split_bank = split_bank;
+
+	nes_system->GetPPU()->InvalidateSpriteZeroHit();
 }
 
 uint8_t MapperMMC5::ReadCPU(uint16_t address) {
+
+	if(address == 0x5204) {
+		nes_system->SyncPPU();
+
+		const uint8_t value = (irq_pending << 7) | (in_frame << 6);
+
+		/* Reading acknowledges the IRQ. */
+		irq_pending = false;
+		nes_system->GetCPU()->SetIRQLine(IRQ_SOURCE_MAPPER, false);
+		nes_system->ScheduleNextEvent();
+
+		return value;
+	}
+
+	if(address == 0x5205) {
+		return (multiplicand * multiplier) & 0xFF;
+	}
+
+	if(address == 0x5206) {
+		return (multiplicand * multiplier) >> 8;
+	}
+
+	if(address >= 0x5C00 && address <= 0x5FFF && expansion_ram_mode >= EXPANSION_RAM_READ_WRITE) {
+		return expansion_ram[address & 0x3FF];
+	}
+
+	/* Write only registers, expansion RAM the PPU has, and disabled PRG RAM are open bus. */
+	if(address >= 0x5000) {
+		return nes_system->GetFloatingBus();
+	}
+
 	std::cout << "Unknown ROM read from " << HEX(address) << std::endl;
 	return 0x00;
 }
 
 void MapperMMC5::WriteCPU(uint16_t address, uint8_t value) {
-	std::cout << "Unknown ROM write " << HEX(value) << " to " << HEX(address) << std::endl;
-	return;
+
+	/* Write protected PRG RAM, or ROM. */
+	if(address >= 0x6000) {
+		return;
+	}
+
+	/* Expansion audio isn't emulated. */
+	if(address >= 0x5000 && address <= 0x5015) {
+		return;
+	}
+
+	if(address >= 0x5C00 && address <= 0x5FFF) {
+		switch(expansion_ram_mode) {
+			case EXPANSION_RAM_NAMETABLE:
+			case EXPANSION_RAM_EXTENDED_ATTRIBUTES:
+				/* The PPU owns it while these modes are on, the CPU only gets to write during rendering and writes 0 otherwise. */
+				nes_system->SyncPPU();
+				expansion_ram[address & 0x3FF] = in_frame ? value : 0x00;
+				nes_system->GetPPU()->MapperMemoryWritten(expansion_ram);
+				break;
+			case EXPANSION_RAM_READ_WRITE:
+				expansion_ram[address & 0x3FF] = value;
+				break;
+			case EXPANSION_RAM_READ_ONLY:
+				break;
+		}
+
+		return;
+	}
+
+	if(address >= 0x5113 && address <= 0x5117) {
+		prg_banks[address - 0x5113] = value;
+		MapPRGBanks();
+		return;
+	}
+
+	/* Everything else but the multiplier changes what the PPU shows or when IRQ fires from this point in the frame on. */
+	if(address != 0x5100 && address != 0x5102 && address != 0x5103 && address != 0x5205 && address != 0x5206) {
+		nes_system->SyncPPU();
+	}
+
+	if(address >= 0x5120 && address <= 0x512B) {
+		chr_banks[address - 0x5120] = value | (chr_bank_high << 8);
+		chr_set_b_written = (address >= 0x5128);
+		MapCHRBanks();
+		return;
+	}
+
+	switch(address) {
+		case 0x5100:
+			prg_mode = value & 0x03;
+			MapPRGBanks();
+			break;
+		case 0x5101:
+			chr_mode = value & 0x03;
+			MapCHRBanks();
+			break;
+		case 0x5102:
+		case 0x5103:
+			prg_ram_protect[address - 0x5102] = value;
+			MapPRGBanks();
+			break;
+		case 0x5104:
+			expansion_ram_mode = value & 0x03;
+			MapNametables();
+			UpdateBackgroundFetch();
+			break;
+		case 0x5105:
+			nametable_mapping = value;
+			MapNametables();
+			break;
+		case 0x5106:
+			std::memset(fill_nametable, value, 0x3C0);
+			nes_system->GetPPU()->MapperMemoryWritten(fill_nametable);
+			break;
+		case 0x5107:
+			/* The same palette for every 2x2 tile area of every attribute byte. */
+			std::memset(&fill_nametable[0x3C0], (value & 0x03) * 0x55, 0x40);
+			nes_system->GetPPU()->MapperMemoryWritten(fill_nametable);
+			break;
+		case 0x5130:
+			chr_bank_high = value & 0x03;
+			UpdateBackgroundFetch();
+			break;
+		case 0x5200:
+			split_control = value;
+			UpdateBackgroundFetch();
+			break;
+		case 0x5201:
+			split_scroll = value;
+			UpdateBackgroundFetch();
+			break;
+		case 0x5202:
+			split_bank = value;
+			UpdateBackgroundFetch();
+			break;
+		case 0x5203:
+			irq_compare = value;
+			nes_system->ScheduleNextEvent();
+			break;
+		case 0x5204:
+			/* Enabling with an IRQ already pending raises it straight away. */
+			irq_enabled = BitCheck(value, 7);
+			nes_system->GetCPU()->SetIRQLine(IRQ_SOURCE_MAPPER, irq_enabled && irq_pending);
+			nes_system->ScheduleNextEvent();
+			break;
+		case 0x5205:
+			multiplicand = value;
+			break;
+		case 0x5206:
+			multiplier = value;
+			break;
+		default:
+			std::cout << "Unknown ROM write " << HEX2(value) << " to " << HEX4(address) << std::endl;
+			break;
+	}
 }
 
-uint8_t MapperMMC5::ReadPPU(uint16_t address) {
-	std::cout << "Unknown ROM read from " << HEX(address) << std::endl;
-	return 0x00;
+void MapperMMC5::ClockScanline(bool rendering) {
+
+	/* The PPU stopped fetching, after the last visible scanline or with rendering switched off. */
+	if(!rendering) {
+		if(in_frame) {
+			in_frame = false;
+
+			if(chr_set_b_written) {
+				MapCHRBanks();
+			}
+		}
+
+		return;
+	}
+
+	/* The first rendered scanline of a frame only starts the count. */
+	if(!in_frame) {
+		in_frame = true;
+		irq_counter = 0;
+
+		if(chr_set_b_written) {
+			MapCHRBanks();
+		}
+
+		return;
+	}
+
+	irq_counter++;
+
+	if(irq_counter == irq_compare) {
+		irq_pending = true;
+
+		if(irq_enabled) {
+			nes_system->GetCPU()->SetIRQLine(IRQ_SOURCE_MAPPER, true);
+		}
+	}
 }
 
-void MapperMMC5::WritePPU(uint16_t address, uint8_t value) {
-	std::cout << "Unknown ROM write " << HEX(value) << " to " << HEX(address) << std::endl;
-	return;
+uint64_t MapperMMC5::GetNextEventCycle() {
+
+	/* An IRQ already pending stays raised until it is acknowledged. */
+	if(!irq_enabled || irq_pending) {
+		return PPU::NoEvent;
+	}
+
+	PPU* ppu = nes_system->GetPPU();
+
+	/* Scanline of the next clock, the current one if its first dot hasn't happened yet. */
+	uint16_t next_scanline = ppu->GetCurrentScanline() + ((ppu->GetCurrentCycle() > 1) ? 1 : 0);
+
+	if(next_scanline > 240) {
+		next_scanline = 0;
+	}
+
+	if(nes_system->IsExactMapperIRQ()) {
+		return ppu->GetScanlineStartCycle(next_scanline);
+	}
+
+	/* The count only ever reaches 1 - 239. */
+	if(irq_compare == 0 || irq_compare >= 240) {
+		return PPU::NoEvent;
+	}
+
+	uint16_t scanline = 240;
+
+	if(next_scanline < 240) {
+		if(!in_frame) {
+			scanline = next_scanline + irq_compare;
+		} else if(irq_compare > irq_counter) {
+			scanline = next_scanline + (irq_compare - irq_counter - 1);
+		}
+	}
+
+	/* Not reached this frame, the next one starts counting from scanline 0. */
+	if(scanline >= 240) {
+		scanline = irq_compare;
+	}
+
+	return ppu->GetScanlineStartCycle(scanline);
 }
\ No newline at end of file
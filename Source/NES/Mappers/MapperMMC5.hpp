@@ -21,14 +21,36 @@
 #ifndef __MAPPER_MMC5_HPP__
 #define __MAPPER_MMC5_HPP__
 
-#include "Mapper.hpp"
+#include <cstdint>
 
-class NESSystem;
+#include "../NESSystem.hpp"
+#include "../PPU.hpp"
+#include "Mapper.hpp"
 
-class MapperMMC5 : public Mapper {
+/**
+ * MMC5 Memory Map:
+ *
+ * CPU $5000-$5015: Expansion audio (not emulated, writes are ignored)
+ * CPU $5100-$5130: Bank, nametable and PRG RAM protect registers
+ * CPU $5200-$5206: Vertical split, scanline IRQ and multiplier registers
+ * CPU $5C00-$5FFF: 1 KB expansion RAM, used by the PPU or as plain RAM depending on its mode
+ * CPU $6000-$7FFF: 8 KB switchable PRG RAM bank
+ * CPU $8000-$FFFF: PRG ROM as one 32 KB bank, two 16 KB banks, one 16 KB and two 8 KB banks, or four 8 KB banks. All but the
+ *                  last 8 KB can be PRG RAM instead
+ *
+ * PPU $0000-$1FFF: CHR ROM in 8, 4, 2 or 1 KB banks, from two sets of registers. With 8x16 sprites, set A is for sprites and
+ *                  set B for the background, otherwise set A is used for both
+ * PPU $2000-$2FFF: Each nametable is either half of VRAM, expansion RAM, or a fill tile and colour
+ *
+ * Extended attributes and the vertical split change how the background is fetched, which the PPU reads from this mapper's
+ * background_fetch_t as it draws each scanline. The scanline counter is clocked at the start of each rendered scanline, the
+ * PPU is only caught up for the IRQ itself (see NESSystem::SetExactMapperIRQ).
+ *
+ */
+class MapperMMC5 final : public Mapper {
 
 	public:
-		MapperMMC5(NESSystem* nes_system, uint8_t number, uint8_t variant);
+		MapperMMC5(NESSystem* nes_system, uint16_t number, uint8_t variant);
 		~MapperMMC5();
 
 		void Initialize(Cartridge* cartridge);
@@ -39,12 +61,10 @@ class MapperMMC5 : public Mapper {
 		uint8_t ReadCPU(uint16_t address);
 		void WriteCPU(uint16_t address, uint8_t value);
 
-		uint8_t ReadPPU(uint16_t address);
-		void WritePPU(uint16_t address, uint8_t value);
+		void ClockScanline(bool rendering);
+		uint64_t GetNextEventCycle();
 
 	private:
-		NESSystem* nes_system;
-
 		enum PRGMode {
 			PRG_MODE0,
 			PRG_MODE1,
@@ -59,6 +79,70 @@ class MapperMMC5 : public Mapper {
 			CHR_MODE3
 		};
 
+		enum ExpansionRAMMode {
+			EXPANSION_RAM_NAMETABLE,
+			EXPANSION_RAM_EXTENDED_ATTRIBUTES,
+			EXPANSION_RAM_READ_WRITE,
+			EXPANSION_RAM_READ_ONLY
+		};
+
+		/* Point the PRG slots at the banks the registers select. */
+		void MapPRGBanks();
+
+		/* Show a PRG register's bank in a slot, PRG RAM when bit 7 is clear. */
+		void MapPRGRegister(uint8_t slot, uint8_t value);
+
+		/* Point the pattern tables, and the background pattern tables used with 8x16 sprites, at the banks the registers select. */
+		void MapCHRBanks();
+
+		/* 1KB CHR bank for one pattern table page from set A or set B of the CHR registers. */
+		uint16_t GetCHRPageBank(bool set_b, uint8_t page);
+
+		void MapNametables();
+
+		/* Bring background_fetch up to date with the expansion RAM mode, split registers and CHR banks, and hand it to the PPU. */
+		void UpdateBackgroundFetch();
+
+		/* 0x5113 - 0x5117, PRG RAM at 0x6000 then the four 8KB ranges from 0x8000. */
+		uint8_t prg_banks[5] { 0 };
+		uint8_t prg_mode { PRG_MODE3 };
+
+		/* 0x5102 has to be 2 and 0x5103 1 for PRG RAM to be writable. */
+		uint8_t prg_ram_protect[2] { 0 };
+
+		/* 0x5120 - 0x512B, set A then set B, each with the 0x5130 bits that were set when it was written above bit 7. */
+		uint16_t chr_banks[12] { 0 };
+		uint8_t chr_mode { CHR_MODE0 };
+		uint8_t chr_bank_high { 0 };
+
+		/* Outside rendering, the PPU reads the set of CHR registers written last. */
+		bool chr_set_b_written { false };
+
+		uint8_t expansion_ram_mode { EXPANSION_RAM_NAMETABLE };
+		uint8_t expansion_ram[0x400] { 0 };
+
+		/* Two bits per nametable: VRAM half 0 or 1, expansion RAM, or fill mode. */
+		uint8_t nametable_mapping { 0 };
+
+		/* The nametable shown in fill mode, the fill tile everywhere and the fill colour in every attribute. */
+		uint8_t fill_nametable[0x400] { 0 };
+
+		uint8_t split_control { 0 };
+		uint8_t split_scroll { 0 };
+		uint8_t split_bank { 0 };
+
+		background_fetch_t background_fetch;
+
+		/* Set on the first rendered scanline, cleared once the PPU stops fetching. */
+		bool in_frame { false };
+
+		uint8_t irq_compare { 0 };
+		uint8_t irq_counter { 0 };
+		bool irq_enabled { false };
+		bool irq_pending { false };
+
+		uint8_t multiplicand { 0xFF };
+		uint8_t multiplier { 0xFF };
 };
 
 #endif /* __MAPPER_MMC5_HPP__ */
\ No newline at end of file
@@ -19,15 +19,19 @@
  */
 
 #include <iostream>
-#include <map>
 
 #include "../../HexOutput.hpp"
 
 #include "../Cartridge.hpp"
+#include "../NESSystem.hpp"
+#include "../PPU.hpp"
 #include "Mapper.hpp"
 #include "MapperNROM.hpp"
 
-MapperNROM::MapperNROM(NESSystem* nes_system, uint8_t number, uint8_t variant) : nes_system(nes_system) {
+REGISTER_MAPPER(MapperNROM, 0, Mapper::AnyVariant);
+
+MapperNROM::MapperNROM(NESSystem* nes_system, uint16_t number, uint8_t variant) {
+	this->nes_system = nes_system;
 	mapper_name = "NROM";
 	mapper_number = number;
 	mapper_variant = variant;
@@ -40,50 +44,25 @@ MapperNROM::~MapperNROM() {
 void MapperNROM::Initialize(Cartridge* cartridge) {
 	this->cartridge = cartridge;
 
-	prg_rom_firstKB = DefineBank(0x8000, 0xBFFF, bank_type::PRG_ROM, true);
+	SetupMemory(cartridge);
 
-	for(size_t i = 0; i <= 0x3FFF; i++) {
-		prg_rom_firstKB->data[i] = cartridge->GetFileMemory()[i + cartridge->GetHeaderOffset()];
+	/* 0x8000 - 0xFFFF shows all of PRG ROM, NROM-128 twice since bank numbers wrap. */
+	for(uint8_t slot = 1; slot < PRGSlotCount; slot++) {
+		MapPRG(slot, slot - 1);
 	}
-	
-	memory_map_cpu[0x8000] = prg_rom_firstKB;
-
-	/* Check if second KB, if not mirror first kb.*/
-	if(cartridge->GetHeader()->prg_rom_size == 2) {
-		prg_rom_secondKB = DefineBank(0xC000, 0xFFFF, bank_type::PRG_ROM, true);
 
-		for(size_t i = 0; i <= 0x3FFF; i++) {
-			prg_rom_secondKB->data[i] = cartridge->GetFileMemory()[i + 0x4000 + cartridge->GetHeaderOffset()];
-		}
-
-		memory_map_cpu[0xC000] = prg_rom_secondKB;
-	} else {
-		memory_map_cpu[0xC000] = prg_rom_firstKB;
-	}
-
-	prg_ram = DefineBank(0x6000, 0x7FFF, bank_type::PRG_RAM, false);
-
-	/* Check if Family BASIC ROM, and setup PRG RAM if so. */
+	/* Family BASIC has PRG RAM. */
 	if(cartridge->GetHeader()->prg_ram_size == 1){
-		prg_ram->mapped = true;
-		memory_map_cpu[0x6000] = prg_ram;
+		MapPRGRAM(0, 0);
 	}
 
-	chr_rom = DefineBank(0x0000, 0x1FFF, bank_type::CHR_ROM, true);
-
-	/* Skip over PRG ROM sections. */
-	for(size_t i = 0; i <= 0x1FFF; i++) {
-         chr_rom->data[i] = cartridge->GetFileMemory()[i + (cartridge->GetHeader()->prg_rom_size * 0x4000) + cartridge->GetHeaderOffset()];
+	for(uint8_t slot = 0; slot < CHRSlotCount; slot++) {
+		MapCHR(slot, slot);
 	}
-
-	memory_map_ppu[0x0000] = chr_rom;
 }
 
 void MapperNROM::Shutdown() {
-	DeleteBank(prg_rom_firstKB);
-	DeleteBank(prg_rom_secondKB);
-	DeleteBank(prg_ram);
-	DeleteBank(chr_rom);
+
 }
 
 void MapperNROM::ApplyState() {
@@ -92,48 +71,16 @@ void MapperNROM::ApplyState() {
 
 uint8_t MapperNROM::ReadCPU(uint16_t address) {
 
-	if(address >= 0x6000 && address <= 0x7FFF) {
-		if(prg_ram->mapped) {
-			return memory_map_cpu[0x6000]->data[address - 0x6000];
-		}
-	}
-
-	if(address >= 0x8000 && address <= 0xBFFF) {
-		return memory_map_cpu[0x8000]->data[address - 0x8000];
-	}
-
-	if(address >= 0xC000 && address <= 0xFFFF) {
-		return memory_map_cpu[0xC000]->data[address - 0xC000];
-	}
-
 	std::cout << "Unknown ROM read from " << HEX4(address) << std::endl;
 	return 0x00;
 }
 
 void MapperNROM::WriteCPU(uint16_t address, uint8_t value) {
 
-	if(address >= 0x6000 && address <= 0x7FFF) {
-		if(prg_ram->mapped) {
-			memory_map_cpu[0x6000]->data[address - 0x6000] = value;
-			return;
-		}
+	if(WritePRG(address, value)) {
+		return;
 	}
 
-	std::cout << "Unknown ROM write " << HEX2(value) << " to " << HEX4(address) << std::endl;
-	return;
-}
-
-uint8_t MapperNROM::ReadPPU(uint16_t address) {
-
-	if(address >= 0x0000 && address <= 0x1FFF) {
-		return memory_map_ppu[0x0000]->data[address];
-	}
-
-	std::cout << "Unknown ROM read from " << HEX4(address) << std::endl;
-	return 0x00;
-}
-
-void MapperNROM::WritePPU(uint16_t address, uint8_t value) {
 	std::cout << "Unknown ROM write " << HEX2(value) << " to " << HEX4(address) << std::endl;
 	return;
 }
\ No newline at end of file
@@ -34,10 +34,10 @@
  *
  * PPU 0x0000 - 0x1FFF: First and only 8kB CHR-ROM
  */
-class MapperNROM : public Mapper {
+class MapperNROM final : public Mapper {
 
 	public:
-		MapperNROM(NESSystem* nes_system, uint8_t number, uint8_t variant);
+		MapperNROM(NESSystem* nes_system, uint16_t number, uint8_t variant);
 		~MapperNROM();
 
 		void Initialize(Cartridge* cartridge);
@@ -48,17 +48,7 @@ class MapperNROM : public Mapper {
 		uint8_t ReadCPU(uint16_t address);
 		void WriteCPU(uint16_t address, uint8_t value);
 
-		uint8_t ReadPPU(uint16_t address);
-		void WritePPU(uint16_t address, uint8_t value);
-
 	private:
-		NESSystem* nes_system;
-
-		rom_bank_t* prg_rom_firstKB;
-		rom_bank_t* prg_rom_secondKB;
-		rom_bank_t* prg_ram;
-		rom_bank_t* chr_rom;
-
 		enum Variant {
 			NROM_128,
 			NROM_256,
@@ -0,0 +1,34 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "MapperDiscrete.hpp"
+#include "MapperUxROM.hpp"
+
+REGISTER_MAPPER(MapperUxROM, 2, Mapper::AnyVariant);
+
+MapperUxROM::MapperUxROM(NESSystem* nes_system, uint16_t number, uint8_t variant) : MapperDiscrete(nes_system, number, variant, "UxROM", variant == 2) {
+
+}
+
+void MapperUxROM::MapLatch(uint8_t value) {
+	MapPRG16K(0x8000, value);
+	MapPRG16K(0xC000, LastPRG16K());
+	MapCHR8K(0);
+}
\ No newline at end of file
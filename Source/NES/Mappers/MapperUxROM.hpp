@@ -0,0 +1,47 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __MAPPER_UXROM_HPP__
+#define __MAPPER_UXROM_HPP__
+
+#include <cstdint>
+
+#include "MapperDiscrete.hpp"
+
+/**
+ * UxROM Memory Map (UNROM, UOROM):
+ *
+ * CPU $8000-$BFFF: 16 KB switchable PRG ROM bank
+ * CPU $C000-$FFFF: 16 KB PRG ROM bank, fixed to the last bank
+ *
+ * PPU $0000-$1FFF: 8 KB CHR RAM
+ *
+ * Variant 2 has bus conflicts. Dumps without a variant run without them, which games written around them never notice.
+ */
+class MapperUxROM final : public MapperDiscrete {
+
+	public:
+		MapperUxROM(NESSystem* nes_system, uint16_t number, uint8_t variant);
+
+	private:
+		void MapLatch(uint8_t value);
+};
+
+#endif /* __MAPPER_UXROM_HPP__ */
\ No newline at end of file
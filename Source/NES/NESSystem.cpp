@@ -18,6 +18,7 @@
  * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <iostream>
 
 #include <SDL.h>
@@ -43,12 +44,21 @@ NESSystem::~NESSystem() {
 
 }
 
+void NESSystem::SetConsole(cpu_emulation_mode_t cpu_type, ppu_emulation_mode_t ppu_type) {
+	cpu_emulation_mode = cpu_type;
+	ppu_emulation_mode = ppu_type;
+}
+
 void NESSystem::Initialize(std::string rom_file_name) {
 	floating_bus_value = 0;
 
 	controller_io = std::make_unique<ControllerIO>(this);
 	controller_io->Initialize();
 
+	/* The PPU comes before the cartridge, so the mapper can map pattern tables and set mirroring while loading. */
+	ppu = std::make_unique<PPU>(this);
+	ppu->Initialize();
+
 	cartridge = std::make_unique<Cartridge>(this);
 	cartridge->Initialize();
 	cartridge->OpenFile(rom_file_name);
@@ -56,9 +66,6 @@ void NESSystem::Initialize(std::string rom_file_name) {
 	apu = std::make_unique<APU>(this);
 	apu->Initialize();
 
-	ppu = std::make_unique<PPU>(this);
-	ppu->Initialize();
-
 	cpu = std::make_unique<CPU>(this);
 	cpu->Initialize();
 
@@ -81,23 +88,109 @@ void NESSystem::Reset(bool hard) {
 	cpu->Reset(hard);
 	cpu_dynarec->Reset(hard);
 	ppu->Reset(hard);
+
+	ScheduleNextEvent();
+}
+
+void NESSystem::Step() {
+
+	// TODO: Replace CPU with DynaRecEngine
+	cpu_dynarec->Step();
+	cpu->Step();
+	apu->Step();
+
+	/* The PPU runs lazily, only catch it up once the CPU has passed its next predicted event. */
+	if(GetPPUTimestamp() >= ppu_next_event_cycle) {
+		SyncPPU();
+	}
 }
 
 void NESSystem::Frame() {
 
-	if(region_emulation_mode == RegionEmulationMode::NTSC) {
-		/* For NTSC, there is exactly three PPU steps per CPU step. */
-		// TODO: Replace CPU with DynaRecEngine
-		cpu_dynarec->Step();
-		cpu->Step();
-		ppu->Step();
-		ppu->Step();
-		ppu->Step();
-		apu->Step();
-	} else if(region_emulation_mode == RegionEmulationMode::PAL) {
-		/* TODO: Handle PAL emulation, which is 3.2 PPU steps per CPU step. */
+	/* Run the CPU uninterrupted until the start of the next VBlank. */
+	const uint64_t frame_end_cycle = ppu->GetNextVBlankCycle();
+
+	while(GetPPUTimestamp() < frame_end_cycle) {
+
+		/* A halted CPU never advances, but the PPU keeps running. */
+		if(cpu->IsHalted()) {
+			ppu->CatchUp(frame_end_cycle);
+			break;
+		}
+
+		Step();
 	}
-	
+
+	SyncPPU();
+
+	cartridge->FlushSave();
+}
+
+void NESSystem::SyncPPU() {
+	ppu->CatchUp(GetPPUTimestamp());
+	ScheduleNextEvent();
+}
+
+void NESSystem::ScheduleNextEvent() {
+	ppu_next_event_cycle = std::min(ppu->GetNextEventCycle(), cartridge->GetMapper()->GetNextEventCycle());
+}
+
+uint64_t NESSystem::GetPPUTimestamp() {
+	return CPUCyclesToPPUCycles(cpu->CycleCount());
+}
+
+uint64_t NESSystem::CPUCyclesToPPUCycles(uint64_t cpu_cycles) {
+
+	if(region_emulation_mode == RegionEmulationMode::PAL) {
+		/* For PAL, there is 3.2 PPU steps per CPU step. */
+		return (cpu_cycles * 16) / 5;
+	}
+
+	/* For NTSC, there is exactly three PPU steps per CPU step. */
+	return cpu_cycles * 3;
+}
+
+uint64_t NESSystem::GetSpriteZeroPollSkip(uint64_t cpu_cycle, uint8_t loop_cycles) {
+
+	SyncPPU();
+
+	const uint64_t hit_cycle = ppu->GetSpriteZeroHitCycle();
+
+	/* Anything due before the hit (VBlank NMI) has to be run normally. */
+	if(hit_cycle == PPU::NoEvent || hit_cycle > ppu_next_event_cycle) {
+		return 0;
+	}
+
+	const uint64_t ppu_cycle = CPUCyclesToPPUCycles(cpu_cycle);
+
+	if(hit_cycle <= ppu_cycle) {
+		return 0;
+	}
+
+	/* Estimate the number of whole loop iterations until the read that sees the hit, then correct for rounding. */
+	uint64_t iterations = (hit_cycle - ppu_cycle) / CPUCyclesToPPUCycles(loop_cycles);
+
+	while(CPUCyclesToPPUCycles(cpu_cycle + (iterations * loop_cycles)) < hit_cycle) {
+		iterations++;
+	}
+
+	while(iterations > 0 && CPUCyclesToPPUCycles(cpu_cycle + ((iterations - 1) * loop_cycles)) >= hit_cycle) {
+		iterations--;
+	}
+
+	return iterations * loop_cycles;
+}
+
+uint64_t NESSystem::GetRAMHash() {
+
+	uint64_t hash = 0xCBF29CE484222325;
+
+	for(uint16_t address = 0; address < 0x800; address++) {
+		hash ^= cpu->PeekMemory(address);
+		hash *= 0x100000001B3;
+	}
+
+	return hash;
 }
 
 void NESSystem::DumpTestInfo() {
@@ -109,6 +202,7 @@ void NESSystem::DumpTestInfo() {
 	std::cout << "Register S = " << HEX2(cpu->GetRegisterS()) << '\n';
 	std::cout << "Register P = " << HEX2(cpu->GetRegisterP()) << '\n';
 	std::cout << "Program Counter = " << HEX4(cpu->GetProgramCounter()) << '\n';
+	std::cout << "Polling Cycles Skipped = " << std::dec << cpu->PollCyclesSkipped() << '\n';
 	std::cout << "Flags Set: ";
 	if(BitCheck(cpu->GetRegisterP(), STATUS_BIT_NEGATIVE))          { std::cout << " NEGATIVE"; }  else { std::cout << "         "; }
 	if(BitCheck(cpu->GetRegisterP(), STATUS_BIT_OVERFLOW))          { std::cout << " OVERFLOW"; }  else { std::cout << "         "; }
@@ -21,6 +21,7 @@
 #ifndef __NES_SYSTEM_HPP__
 #define __NES_SYSTEM_HPP__
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <utility>
@@ -68,20 +69,49 @@ class NESSystem {
 		void Initialize(std::string rom_file_name);
 		void Shutdown();
 		void Reset(bool hard);
+		void Step();
 		void Frame();
 
+		/* Bring the PPU up to the CPU's current timestamp. Called on PPU register access, OAM DMA, and by mappers that watch PPU state. */
+		void SyncPPU();
+
+		/* Work out when the PPU next has to be caught up again. Called by SyncPPU, and by anything that moves an upcoming event
+		   without needing the PPU caught up first, like a mapper's IRQ registers. */
+		void ScheduleNextEvent();
+
+		/* Current CPU timestamp converted to PPU cycles. */
+		uint64_t GetPPUTimestamp();
+
+		/* Convert a CPU cycle count into PPU cycles for the current region. */
+		uint64_t CPUCyclesToPPUCycles(uint64_t cpu_cycles);
+
+		/* CPU cycles a PPUSTATUS polling loop starting at cpu_cycle can skip, while still reading PPUSTATUS on the iteration that sees sprite 0 hit. */
+		uint64_t GetSpriteZeroPollSkip(uint64_t cpu_cycle, uint8_t loop_cycles);
+
 		void DumpTestInfo();
 
+		/* 64-bit FNV-1a hash of CPU RAM, for checking two runs ended up in the same state. */
+		uint64_t GetRAMHash();
+
 		cpu_emulation_mode_t    GetCPUModel() { return cpu_emulation_mode;    };
 		ppu_emulation_mode_t    GetPPUModel() { return ppu_emulation_mode;    };
 		region_emulation_mode_t GetRegion()   { return region_emulation_mode; };
 
+		/* Called by the cartridge while loading when the ROM says which console it is for, overriding what the system was
+		   made with. The region stays as it was made, PAL and Dendy frames aren't emulated yet. */
+		void SetConsole(cpu_emulation_mode_t cpu_type, ppu_emulation_mode_t ppu_type);
+
 		ControllerIO* GetControllerIO() { return controller_io.get(); }
 		Cartridge* GetCartridge() { return cartridge.get(); }
 		APU* GetAPU() { return apu.get(); }
 		CPU* GetCPU() { return cpu.get(); }
 		PPU* GetPPU() { return ppu.get(); }
 
+		/* Have mappers with scanline IRQs catch the PPU up on every counter clock, instead of only when the IRQ is predicted to
+		   fire. Slower, for checking the prediction against. */
+		void SetExactMapperIRQ(bool exact) { exact_mapper_irq = exact; }
+		bool IsExactMapperIRQ() { return exact_mapper_irq; }
+
 		uint8_t GetFloatingBus() { return floating_bus_value; }
 		void SetFloatingBus(uint8_t value) { floating_bus_value = value; }
 
@@ -99,6 +129,11 @@ class NESSystem {
 		// TODO: Replace CPU with DynaRecEngine
 		std::unique_ptr<DynaRecEngine> cpu_dynarec;
 
+		/* PPU timestamp of the next event the PPU must be caught up for (VBlank NMI, sprite 0 hit, mapper IRQ). */
+		uint64_t ppu_next_event_cycle { 0 };
+
+		bool exact_mapper_irq { false };
+
 		/* Value on the data busses between CPU, APU, and PPU to emulate bus conflict and floating bus behaviour. */
 		uint8_t floating_bus_value { 0 };
 		// TODO: Depending on which chip had the last cycle, floating capacitance on the bus will be different. Use these two values to emulate.
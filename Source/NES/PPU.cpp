@@ -18,11 +18,15 @@
  * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <bit>
+#include <cstring>
 #include <iterator>
 #include <iostream>
 #include <vector>
 
 #include "../BitOps.hpp"
+#include "../Hash.hpp"
 #include "../HexOutput.hpp"
 #include "NESSystem.hpp"
 #include "Cartridge.hpp"
@@ -41,11 +45,19 @@ void PPU::Initialize() {
 
 	/* Setup and clear PPU video buffer, and set up pointer to it. */
 	ppu_buffer.resize(ScreenWidth * (ScreenHeight + 1) + 1, 0);
+	indexed_buffer.resize(ScreenWidth * (ScreenHeight + 1) + 1, 0);
+	dirty_lines.set();
 
-	/* Setup and clear VRAM */
-	// TODO: the memory is not always actually this size, it depends on the cartridge.
+	/* Clear VRAM and palette RAM, the cartridge maps pattern tables and sets mirroring once loaded. */
 	// TODO: Does the top of the memory always hold the palette values even on startup? Is it loaded by the cartridge?
-	ppu_memory.resize(0x4000, 0);
+	std::memset(vram, 0, sizeof(vram));
+	std::memset(palette_ram, 0, sizeof(palette_ram));
+
+	for(uint8_t page = 0; page < 8; page++) {
+		MapCHRPage(page, nullptr, false);
+	}
+
+	SetMirroringMode(MirroringMode::HORIZONTAL);
 
 	/* Setup and clear primary/secondary OAM */
 	object_attribute_memory.resize(256, 0);
@@ -57,8 +69,15 @@ void PPU::Initialize() {
 	ppu_address = 0;
 	oam_address = 0;
 
-	ppu_scroll_write_counter = 0;
-	ppu_address_write_counter = 0;
+	temp_address = 0;
+	fine_x_scroll = 0;
+	write_toggle = false;
+	ppu_data_buffer = 0;
+
+	sprite_count = 0;
+	sprite_zero_in_line = false;
+	sprite_zero_hit_dot = 0;
+	sprite_zero_prediction_valid = false;
 
 	current_cycle = 0;
 	current_scanline = 0;
@@ -75,79 +94,156 @@ void PPU::Shutdown() {
 	ppu_address = 0;
 	oam_address = 0;
 
-	ppu_scroll_write_counter = 0;
-	ppu_address_write_counter = 0;
+	temp_address = 0;
+	fine_x_scroll = 0;
+	write_toggle = false;
 }
 
 void PPU::Reset(bool hard) {
 	current_cycle = 0;
 	current_scanline = 241;
+
+	/* Line the PPU clock up with the freshly reset CPU. */
+	cycle_count = nes_system->GetPPUTimestamp();
+
+	sprite_zero_hit_dot = 0;
+	sprite_zero_prediction_valid = false;
 }
 
-void PPU::Step() {
-	
-	/* Visible scanlines (0 - 240). */
-	if(current_scanline <= 240) {
-
-		uint16_t nametable_base_address = 0x2000;
-
-		/* Bits 0 and 1 of PPUCTRL (0x2000 write) determine base nametable address. */
-		switch(ppu_ctrl & 0x03) {
-			case 0:
-				nametable_base_address = 0x2000;
-			case 1:
-				nametable_base_address = 0x2400;
-			case 2:
-				nametable_base_address = 0x2800;
-			case 3:
-				nametable_base_address = 0x2C00;
-			default:
-				break;
+void PPU::CatchUp(uint64_t target_cycle) {
+	while(cycle_count < target_cycle) {
+		Step();
+	}
+}
+
+uint64_t PPU::GetNextEventCycle() {
+	/* Sprite 0 hit is only visible through PPUSTATUS, which already catches the PPU up when read. */
+	return GetNextVBlankCycle();
+}
+
+uint64_t PPU::GetDataStreamWindowEnd() {
+
+	const bool rendering_line = (current_scanline < 240 || current_scanline == 261);
+
+	/* While rendering, PPUDATA accesses move v in the middle of fetches, so each one has to happen on its own dot. */
+	if(rendering_line && IsRenderingEnabled()) {
+		return cycle_count;
+	}
+
+	uint64_t window_end = GetNextVBlankCycle();
+
+	if(IsRenderingEnabled()) {
+		window_end = std::min(window_end, CycleCountAt(261, 0));
+	} else {
+		/* With rendering off, each visible scanline still picks its backdrop colour from v at dot 1. */
+		uint16_t next_line = (current_scanline + (current_cycle > 1 ? 1 : 0)) % ScanlinesPerFrame;
+		if(next_line >= 240) {
+			next_line = 0;
 		}
 
-		/* The attribute table base address is determed by the nametable base address. */
-		uint16_t attribute_table_base_address = nametable_base_address + 0x03C0;
+		if(next_line == current_scanline && current_cycle == 1) {
+			return cycle_count;
+		}
+
+		window_end = std::min(window_end, CycleCountAt(next_line, 0));
+	}
+
+	/* The debug snapshot is taken once the last dot before its scanline has been processed. */
+	if(debug_snapshot_scanline >= 0) {
+		window_end = std::min(window_end, CycleCountAt((debug_snapshot_scanline + ScanlinesPerFrame - 1) % ScanlinesPerFrame, 340));
+	}
+
+	return window_end;
+}
+
+uint64_t PPU::GetNextVBlankCycle() {
+	return CycleCountAt(241, 1);
+}
+
+uint64_t PPU::GetSpriteZeroHitCycle() {
+
+	if(!sprite_zero_prediction_valid || cycle_count >= sprite_zero_prediction_expires) {
+		sprite_zero_hit_cycle = PredictSpriteZeroHit();
+		sprite_zero_prediction_valid = true;
+	}
+
+	return sprite_zero_hit_cycle;
+}
+
+uint64_t PPU::GetA12ClockCycle(uint16_t clocks) {
+
+	if(!IsRenderingEnabled() || clocks == 0) {
+		return NoEvent;
+	}
+
+	if(!a12_rises_valid) {
+		PredictA12Rises();
+	}
+
+	uint16_t scanline = current_scanline;
 
-		/* Bit 4 of PPUCTRL (0x2000 write) determine background patterntable address. */
-		uint16_t background_patterntable_address = (BitCheck(ppu_ctrl, 4) << 12);
+	for(uint16_t lines = 0; lines < ScanlinesPerFrame; lines++) {
+		/* Past dot 256 the current scanline's rises have been picked up already, and the ones gone by cleared. */
+		uint32_t rises = (lines == 0 && current_cycle > 256) ? a12_rises : a12_line_rises[scanline];
 
-		/* Fetch name table entry. */
-		uint16_t nametable_entry = ReadPPU(nametable_base_address);
+		while(rises != 0) {
+			const uint16_t dot = (std::countr_zero(rises) + 64) * 4;
+			rises &= rises - 1;
 
-		/* Fetch attribute table entry. */
-		uint16_t attribute_entry = ReadPPU(attribute_table_base_address);
+			if(lines == 0 && dot < current_cycle) {
+				continue;
+			}
 
-		/* Bit 13 of the address into PPU memory controls whether the pattern table is "left" (0x0000 - 0x0FFF) or "right" (0x1000 - 0x1FFF). */
-		if(ppu_address & 0x1000) {
-			uint16_t pattern_entry = ReadPPU(0x0000 + current_cycle);
-			pattern_entry |= ReadPPU(0x0001 + current_cycle);
-		} else {
-			uint16_t pattern_entry = ReadPPU(0x1000 + current_cycle);
-			pattern_entry |= ReadPPU(0x1001 + current_cycle);
+			if(--clocks == 0) {
+				return cycle_count + (lines * CyclesPerScanline) + dot - current_cycle + 1;
+			}
 		}
 
-		// Each of these come together to form a two-bit value that chooses from one of...
+		scanline = (scanline + 1) % ScanlinesPerFrame;
+	}
+
+	return cycle_count + (CyclesPerScanline * ScanlinesPerFrame);
+}
+
+uint64_t PPU::GetScanlineStartCycle(uint16_t scanline) {
 
-		// The palettes. Palette memory is structed as follows.
-		// 0x3F00 -> 1-byte Index into NES palette for background color.
-		// 0x3F01 -> 4-byte Three colors, each of which is index into NES palette. Last byte is mirror of 0x3F00. Background only.
-		// 0x3F05 -> 4-byte Three colors, each of which is index into NES palette. Last byte is mirror of 0x3F00. Background only.
-		// 0x3F09 -> 4-byte Three colors, each of which is index into NES palette. Last byte is mirror of 0x3F00. Background only.
-		// 0x3F0D -> 4-byte Three colors, each of which is index into NES palette. Last byte is mirror of 0x3F00. Background only.
-		// 0x3F11 -> 4-byte Three colors, each of which is index into NES palette. Last byte is mirror of 0x3F00. Sprites only.
-		// 0x3F15 -> 4-byte Three colors, each of which is index into NES palette. Last byte is mirror of 0x3F00. Sprites only.
-		// 0x3F19 -> 4-byte Three colors, each of which is index into NES palette. Last byte is mirror of 0x3F00. Sprites only.
-		// 0x3F1D -> 4-byte Three colors, each of which is index into NES palette. Last byte is mirror of 0x3F00. Sprites only.
+	if(!IsRenderingEnabled()) {
+		return NoEvent;
+	}
+
+	return CycleCountAt(scanline, 1);
+}
 
-		/* SPRITES */
+void PPU::SetBackgroundFetch(const background_fetch_t* fetch) {
 
-		/* Get the color emphasis. */
-		uint8_t emphasis = 0x00;
+	background_fetch = fetch;
+	recorded_expansion = nullptr;
+
+	/* Sprite 0 hit isn't predicted over backgrounds the mapper fetches. */
+	sprite_zero_prediction_valid = false;
+}
 
-		emphasis  = BitCheck(ppu_mask, PPU_MASK_EMPHASIZE_RED);
-		emphasis += BitCheck(ppu_mask, PPU_MASK_EMPHASIZE_GREEN) << 1;
-		emphasis += BitCheck(ppu_mask, PPU_MASK_EMPHASIZE_BLUE) << 2;
+void PPU::MapperMemoryWritten(const uint8_t* page) {
 
+	if(frame_record != nullptr) {
+		for(uint8_t other = 0; other < 12; other++) {
+			if(memory_pages[other] == page) {
+				recorded_pages[other] = nullptr;
+			}
+		}
+
+		if(background_fetch != nullptr && background_fetch->expansion == page) {
+			recorded_expansion = nullptr;
+		}
+	}
+
+	sprite_zero_prediction_valid = false;
+}
+
+void PPU::Step() {
+	
+	/* Visible scanlines (0 - 239). */
+	if(current_scanline < 240) {
 		ProcessVisibleScanline();
 	}
 
@@ -160,11 +256,41 @@ void PPU::Step() {
 	if(current_scanline == 261) {
 		ProcessPrerenderScanline();
 	}
+
+	/* A scanline counter on the cartridge sees A12 rise while sprites and the next scanline's first tiles are fetched. */
+	if(a12_watched && current_cycle >= 256) {
+		if(current_cycle == 256 && IsRenderingEnabled() && (current_scanline < 240 || current_scanline == 261)) {
+			if(!a12_rises_valid) {
+				PredictA12Rises();
+			}
+
+			a12_rises = a12_line_rises[current_scanline];
+		} else if(a12_rises != 0 && (current_cycle & 0x03) == 0) {
+			const uint32_t rise = 1u << ((current_cycle >> 2) - 64);
+
+			if(a12_rises & rise) {
+				a12_rises &= ~rise;
+
+				if(IsRenderingEnabled()) {
+					nes_system->GetCartridge()->GetMapper()->ClockA12();
+				}
+			}
+		}
+	}
 	
-	/* Check for new scanline. */
+	/* Check for new scanline, and new frame at the end of the pre-render line. */
 	if(current_cycle == 340) {
 		current_cycle = 0;
 		current_scanline++;
+
+		if(current_scanline == ScanlinesPerFrame) {
+			current_scanline = 0;
+			frame_count++;
+		}
+
+		if(current_scanline == debug_snapshot_scanline) {
+			TakeDebugSnapshot();
+		}
 	} else {
 		current_cycle++;
 	}
@@ -178,10 +304,179 @@ void PPU::Step() {
 void PPU::WriteOAM(uint8_t value) {
 	// TODO: Disable OAM writes during rendering 
 	object_attribute_memory[oam_address++] = value;
+	sprite_zero_prediction_valid = false;
+	a12_rises_valid = false;
+
+	if(a12_watched) {
+		nes_system->ScheduleNextEvent();
+	}
+}
+
+void PPU::WriteOAMPage(const uint8_t* data) {
+
+	/* OAMADDR wraps back around to where it started. */
+	const uint16_t first = 0x100 - oam_address;
+	std::memcpy(&object_attribute_memory[oam_address], data, first);
+	std::memcpy(&object_attribute_memory[0], data + first, oam_address);
+
+	sprite_zero_prediction_valid = false;
+	a12_rises_valid = false;
+
+	if(a12_watched) {
+		nes_system->ScheduleNextEvent();
+	}
+}
+
+void PPU::MapCHRPage(uint8_t page, uint8_t* memory, bool writable) {
+
+	if(memory == nullptr) {
+		memory = unmapped_page;
+		writable = false;
+	}
+
+	/* Debug views need to see the new bank. */
+	if(memory_pages[page & 0x07] != memory) {
+		for(uint16_t tile = (page & 0x07) * 64; tile < ((page & 0x07) + 1) * 64; tile++) {
+			chr_dirty_tiles.set(tile);
+		}
+	}
+
+	memory_pages[page & 0x07] = memory;
+	writable_pages[page & 0x07] = writable;
+	recorded_pages[page & 0x07] = nullptr;
+
+	/* New pattern data can move a sprite 0 hit. */
+	sprite_zero_prediction_valid = false;
+}
+
+void PPU::SetDebugSnapshotScanline(int16_t scanline) {
+
+	debug_snapshot_scanline = scanline;
+
+	/* The first snapshot copies everything. */
+	chr_dirty_tiles.set();
+}
+
+void PPU::ClearDebugSnapshot() {
+
+	debug_snapshot_ready = false;
+	debug_snapshot.dirty_tiles.reset();
+}
+
+void PPU::SetFrameRecord(frame_record_t* record) {
+
+	frame_record = record;
+
+	if(record != nullptr) {
+		/* Nothing from a previous frame is kept, the first recorded scanline copies every page. */
+		record->recorded.reset();
+		record->pages_used = 0;
+		record->frame_number = frame_count;
+
+		for(const uint8_t*& page : recorded_pages) {
+			page = nullptr;
+		}
+
+		recorded_expansion = nullptr;
+	}
+}
+
+void PPU::FinishRecordedFrame(const std::bitset<240>& changed_lines) {
+
+	dirty_lines |= changed_lines;
+
+	if(frame_hashing) {
+		frame_hash = Hash64(ppu_buffer.data(), ScreenWidth * ScreenHeight * sizeof(uint32_t));
+	}
+}
+
+void PPU::TakeDebugSnapshot() {
+
+	/* Pattern tables change rarely compared to the rest, so only changed tiles are copied. */
+	if(chr_dirty_tiles.any()) {
+		for(uint16_t tile = 0; tile < 512; tile++) {
+			if(chr_dirty_tiles.test(tile)) {
+				std::memcpy(&debug_snapshot.chr[tile * 16], &memory_pages[tile >> 6][(tile & 0x3F) * 16], 16);
+			}
+		}
+
+		debug_snapshot.dirty_tiles |= chr_dirty_tiles;
+		chr_dirty_tiles.reset();
+	}
+
+	for(uint8_t page = 0; page < 4; page++) {
+		std::memcpy(&debug_snapshot.nametables[page * 0x400], memory_pages[8 + page], 0x400);
+	}
+
+	std::memcpy(debug_snapshot.palette, palette_ram, sizeof(palette_ram));
+	std::memcpy(debug_snapshot.oam, object_attribute_memory.data(), 0x100);
+
+	debug_snapshot.ppu_ctrl = ppu_ctrl;
+	debug_snapshot.ppu_mask = ppu_mask;
+	debug_snapshot.ppu_address = ppu_address;
+	debug_snapshot.temp_address = temp_address;
+	debug_snapshot.fine_x_scroll = fine_x_scroll;
+	debug_snapshot.scanline = current_scanline;
+	debug_snapshot.frame_number = frame_count;
+
+	debug_snapshot_ready = true;
 }
 
-void PPU::SetMirroringMode() {
+void PPU::MapNametablePage(uint8_t page, uint8_t* memory, bool writable) {
+
+	if(memory == nullptr) {
+		memory = unmapped_page;
+		writable = false;
+	}
+
+	/* 0x3000 - 0x3EFF mirrors 0x2000 - 0x2EFF. */
+	memory_pages[8 + (page & 0x03)] = memory;
+	memory_pages[12 + (page & 0x03)] = memory;
+	writable_pages[8 + (page & 0x03)] = writable;
+	writable_pages[12 + (page & 0x03)] = writable;
+	recorded_pages[8 + (page & 0x03)] = nullptr;
+
+	sprite_zero_prediction_valid = false;
+}
 
+void PPU::SetMirroringMode(mirroring_mode_t mode) {
+
+	uint8_t* lower = &vram[0x000];
+	uint8_t* upper = &vram[0x400];
+
+	switch(mode) {
+		case MirroringMode::HORIZONTAL:
+			MapNametablePage(0, lower);
+			MapNametablePage(1, lower);
+			MapNametablePage(2, upper);
+			MapNametablePage(3, upper);
+			break;
+		case MirroringMode::VERTICAL:
+			MapNametablePage(0, lower);
+			MapNametablePage(1, upper);
+			MapNametablePage(2, lower);
+			MapNametablePage(3, upper);
+			break;
+		case MirroringMode::SINGLE_SCREEN_LOWER:
+			MapNametablePage(0, lower);
+			MapNametablePage(1, lower);
+			MapNametablePage(2, lower);
+			MapNametablePage(3, lower);
+			break;
+		case MirroringMode::SINGLE_SCREEN_UPPER:
+			MapNametablePage(0, upper);
+			MapNametablePage(1, upper);
+			MapNametablePage(2, upper);
+			MapNametablePage(3, upper);
+			break;
+		case MirroringMode::FOUR_SCREEN:
+			/* The cartridge provides the other 2kB. */
+			MapNametablePage(0, lower);
+			MapNametablePage(1, upper);
+			MapNametablePage(2, &nes_system->GetCartridge()->GetFourScreenVRAM()[0x000]);
+			MapNametablePage(3, &nes_system->GetCartridge()->GetFourScreenVRAM()[0x400]);
+			break;
+	}
 }
 
 void PPU::ProcessPrerenderScanline() {
@@ -193,14 +488,24 @@ void PPU::ProcessPrerenderScanline() {
 		BitClear(ppu_status, PPU_STATUS_VBLANK);
 	}
 
-	if(current_cycle == 321 || current_cycle == 329) {
-		
-	}
+	if(IsRenderingEnabled()) {
 
-	/* Set new frame at the end of the pre-render line. */
-	if(current_cycle == 340) {
-		current_scanline = 0;
-		frame_count++;
+		if(current_cycle == 256) {
+			IncrementScrollY();
+
+			/* No sprite evaluation happens on the pre-render line, so scanline 0 never has sprites. */
+			sprite_count = 0;
+			sprite_zero_in_line = false;
+		}
+
+		if(current_cycle == 257) {
+			CopyScrollX();
+		}
+
+		/* Vertical scroll bits are reloaded from cycle 280 to 304. */
+		if(current_cycle == 280) {
+			CopyScrollY();
+		}
 	}
 
 	// TODO: Skip 1 cycle at cycle 340 for odd frames that have rendering enabled.
@@ -209,41 +514,67 @@ void PPU::ProcessPrerenderScanline() {
 
 void PPU::ProcessVisibleScanline() {
 
-	if(current_cycle == 0) {
-		/* Idle Scanline. */
-	}
-
-	/* Visible portion of the screen. */
-	if(current_cycle >= 1   && current_cycle <= 256) {
+	/* The whole scanline is produced at once, on the first visible dot. */
+	if(current_cycle == 1) {
+		/* First, so whatever the mapper changes at the start of the scanline is drawn on it. */
+		if(scanlines_watched) {
+			nes_system->GetCartridge()->GetMapper()->ClockScanline(IsRenderingEnabled());
+		}
 
-		/* Generate a new test color every frame just to test VBlank stuff. */
-		/*if(frame_count % 2 == 0) {
-			DrawPixel(current_cycle, current_scanline, 0xFF00FFFF);
-		} else {
-			DrawPixel(current_cycle, current_scanline, 0xFFFF00FF);
-		}*/
+		const scanline_state_t state = CaptureScanlineState();
 
-		DrawPixel(current_cycle, current_scanline, palette[(current_cycle + frame_count) % 64]);
+		if(!skip_rendering && frame_record == nullptr) {
+			RenderBackgroundLine(state, background_line);
+			RenderSpriteLine(state, sprite_line);
 
-	}
+			if(IsRenderingEnabled()) {
+				DetectSpriteZeroHit();
+			}
 
-	/* No longer visible. */
-	if(current_cycle >= 257 && current_cycle <= 320) {
+			if(ComposeLine(state, background_line, sprite_line)) {
+				dirty_lines.set(current_scanline);
+			}
+		} else if(sprite_zero_in_line && IsRenderingEnabled()) {
+			/* Skipped and recorded frames only need the scanlines sprite 0 could hit on. */
+			RenderBackgroundLine(state, background_line);
+			RenderSpriteLine(state, sprite_line);
+			DetectSpriteZeroHit();
+		}
 
+		if(frame_record != nullptr && !skip_rendering) {
+			RecordScanline();
+		}
 	}
 
-	if(current_cycle >= 321 && current_cycle <= 336) {
+	/* Sprite 0 hit is raised on the dot its pixel is output, not when the line is produced. Dot 0 means no hit is pending. */
+	if(sprite_zero_hit_dot != 0 && current_cycle == sprite_zero_hit_dot) {
+		BitSet(ppu_status, PPU_STATUS_SPRITE_0_HIT);
+		sprite_zero_hit_dot = 0;
+	}
 
+	if(current_cycle == 256 && IsRenderingEnabled()) {
+		/* Sprites found here are drawn on the next scanline. */
+		EvaluateSprites();
+		IncrementScrollY();
 	}
 
-	if(current_cycle >= 337 && current_cycle <= 340) {
-		ReadPPU(0x00);
-		ReadPPU(0x00);
+	if(current_cycle == 257 && IsRenderingEnabled()) {
+		CopyScrollX();
 	}
 }
 
 void PPU::ProcessPostrenderScanline() {
 
+	/* The last visible scanline has been drawn, the frame is complete. */
+	if(current_scanline == 240 && current_cycle == 0 && frame_hashing && frame_record == nullptr) {
+		frame_hash = Hash64(ppu_buffer.data(), ScreenWidth * ScreenHeight * sizeof(uint32_t));
+	}
+
+	/* Nothing is fetched after the last visible scanline. */
+	if(current_scanline == 240 && current_cycle == 1 && scanlines_watched) {
+		nes_system->GetCartridge()->GetMapper()->ClockScanline(false);
+	}
+
 	/* VBlank flag and NMI gets generated on cycle 1 of second post render scanline. */
 	if(current_scanline == 241 && current_cycle == 1) {
 		
@@ -252,28 +583,11 @@ void PPU::ProcessPostrenderScanline() {
 
 		/* Generate NMI if flag in PPUCTRL set. */
 		if(BitCheck(ppu_ctrl, PPU_CTRL_NMI_ENABLE)) {
-			nes_system->GetCPU()->Interrupt(INTERRUPT_NMI);
+			nes_system->GetCPU()->RequestInterrupt(INTERRUPT_NMI);
 		}
 	}
 }
 
-void PPU::ReadTile() {
-	uint16_t tile_address = (0x2000 + (ppu_address & 0x0FFF));
-}
-
-void PPU::DrawPixel() {
-
-	uint32_t buffer_position = (current_scanline * ScreenWidth) + current_cycle;
-
-	uint8_t pallete = 0;
-
-	//uint8_t pixel_color = pattern_table_shift_register_1;
-
-	ppu_buffer[buffer_position];
-
-	return;
-}
-
 void PPU::DrawPixel(int x, int y, uint32_t color) {
 
 #ifdef _DEBUG
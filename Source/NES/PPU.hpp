@@ -21,10 +21,14 @@
 #ifndef __PPU_HPP__
 #define __PPU_HPP__
 
+#include <array>
 #include <bitset>
 #include <cstdint>
+#include <deque>
 #include <vector>
 
+#include "../BitOps.hpp"
+
 #define PPU_CTRL_NAMETABLE_SELECT1  0
 #define PPU_CTRL_NAMETABLE_SELECT2  1
 #define PPU_CTRL_INCREMENT_MODE     2
@@ -49,6 +53,89 @@
 
 class NESSystem;
 
+/* Copy of PPU memory and registers at the start of a scanline, for debug views. See PPU::SetDebugSnapshotScanline. */
+typedef struct ppu_snapshot {
+	uint8_t chr[0x2000] { 0 };
+	uint8_t nametables[0x1000] { 0 };
+	uint8_t palette[0x20] { 0 };
+	uint8_t oam[0x100] { 0 };
+
+	uint8_t ppu_ctrl { 0 };
+	uint8_t ppu_mask { 0 };
+	uint16_t ppu_address { 0 };
+	uint16_t temp_address { 0 };
+	uint8_t fine_x_scroll { 0 };
+
+	uint16_t scanline { 0 };
+	uint64_t frame_number { 0 };
+
+	/* 16 byte tiles of chr written or banked in since the snapshot was last cleared. Only these are copied again. */
+	std::bitset<512> dirty_tiles;
+} ppu_snapshot_t;
+
+/* Background tile fetches taken over by the cartridge, like the MMC5's extended attributes and vertical split. The mapper keeps
+   this up to date and the PPU copies it into each scanline's state, so drawing reads it directly instead of asking the mapper
+   for every fetch. See PPU::SetBackgroundFetch. */
+typedef struct background_fetch {
+	/* 1KB pattern table pages background tiles are fetched from while sprites are 8x16, or nullptr to use the sprites' pages. */
+	const uint8_t* pattern_pages[8] { nullptr };
+
+	/* 1KB of mapper memory the extended attributes and the split nametable are read from. */
+	const uint8_t* expansion { nullptr };
+
+	/* CHR memory the 4KB banks below are picked from, chr_banks of them. Read live, even by recorded scanlines. */
+	const uint8_t* chr { nullptr };
+	uint16_t chr_banks { 0 };
+
+	/* Each tile takes its 4KB CHR bank from bits 0 - 5 and its palette from bits 6 - 7 of the expansion byte at the tile's
+	   nametable offset, with extended_bank_high above the bank bits. */
+	bool extended_attributes { false };
+	uint8_t extended_bank_high { 0 };
+
+	/* Tiles left of split_tile, or from it on with split_right, are fetched from the expansion memory as a nametable instead.
+	   Counting from the leftmost tile, scrolled vertically by split_scroll on their own and patterned from 4KB bank split_bank. */
+	bool split { false };
+	bool split_right { false };
+	uint8_t split_tile { 0 };
+	uint8_t split_scroll { 0 };
+	uint16_t split_bank { 0 };
+} background_fetch_t;
+
+/* Everything drawing a scanline depends on, captured at its first dot. See PPU::RasterizeScanline. */
+typedef struct scanline_state {
+	/* Pattern table and nametable pages (0x0000 - 0x2FFF), either live PPU memory or copies in a frame_record_t. */
+	const uint8_t* pages[12] { nullptr };
+	uint8_t palette[0x20] { 0 };
+
+	/* Only used when mapper_fetch is set, then with expansion pointing at a copy for recorded scanlines. */
+	background_fetch_t background;
+	bool mapper_fetch { false };
+
+	/* Secondary OAM, filled by sprite evaluation on the previous scanline. */
+	uint8_t sprites[32] { 0 };
+	uint8_t sprite_count { 0 };
+	bool sprite_zero_in_line { false };
+
+	uint8_t ppu_ctrl { 0 };
+	uint8_t ppu_mask { 0 };
+	uint16_t ppu_address { 0 };
+	uint8_t fine_x_scroll { 0 };
+
+	uint16_t scanline { 0 };
+} scanline_state_t;
+
+/* A frame's visible scanlines recorded for drawing later, possibly on other threads. See PPU::SetFrameRecord. */
+typedef struct frame_record {
+	scanline_state_t lines[240];
+	std::bitset<240> recorded;
+
+	/* Copies of PPU memory pages. A copy is only made once a page has changed, so scanlines share them until written or banked out. */
+	std::deque<std::array<uint8_t, 0x400>> pages;
+	size_t pages_used { 0 };
+
+	uint64_t frame_number { 0 };
+} frame_record_t;
+
 /**
  * PPU TODO LIST:
  *
@@ -59,6 +146,15 @@ class NESSystem;
 
 class PPU {
 
+	public:
+		typedef enum class MirroringMode {
+			HORIZONTAL,
+			VERTICAL,
+			SINGLE_SCREEN_LOWER,
+			SINGLE_SCREEN_UPPER,
+			FOUR_SCREEN
+		} mirroring_mode_t;
+
 	public:
 		PPU(NESSystem* nes_system);
 		~PPU();
@@ -68,9 +164,85 @@ class PPU {
 		void Reset(bool hard);
 		void Step();
 
+		/* Run the PPU until its cycle count reaches target_cycle. The PPU only runs when the CPU needs it to. */
+		void CatchUp(uint64_t target_cycle);
+
+		/* Cycle count by which the PPU must be caught up for the next event visible to the CPU. */
+		uint64_t GetNextEventCycle();
+
+		/* Cycle count once the next VBlank flag has been raised. */
+		uint64_t GetNextVBlankCycle();
+
+		/* Cycle count once the next sprite 0 hit has been raised, or NoEvent if none is coming this frame. Predicted from current OAM, scroll and pattern data. */
+		uint64_t GetSpriteZeroHitCycle();
+
+		/* Throw away the sprite 0 hit prediction. Needed whenever OAM, scroll, nametables or CHR banks change. */
+		void InvalidateSpriteZeroHit() { sprite_zero_prediction_valid = false; };
+
+		/* Call the mapper's ClockA12 on every rise of PPU address line A12 an MMC3 style scanline counter counts. */
+		void WatchA12(bool watch) { a12_watched = watch; };
+
+		/* Cycle count once the mapper has been given clocks more A12 clocks, assuming nothing is written to the PPU in the meantime,
+		   or NoEvent with rendering off. Only looks a frame ahead, further than that the cycle count a frame from now is returned
+		   to be asked again then. Only rises from rendering are predicted, PPUADDR and PPUDATA clock the mapper as they happen. */
+		uint64_t GetA12ClockCycle(uint16_t clocks);
+
+		/* Call the mapper's ClockScanline at the start of scanlines 0 - 240, where an MMC5 style scanline counter sees the PPU
+		   start fetching a scanline, or stop fetching after the last one. */
+		void WatchScanlines(bool watch) { scanlines_watched = watch; };
+
+		/* Cycle count once ClockScanline has been called for a scanline, as long as rendering stays on, or NoEvent with it off. */
+		uint64_t GetScanlineStartCycle(uint16_t scanline);
+
+		/* Take background fetches from fetch, which the mapper keeps up to date while the PPU reads it at the start of every
+		   scanline, or draw the background normally again with nullptr. */
+		void SetBackgroundFetch(const background_fetch_t* fetch);
+
 		/* Used by CPU during OAM DMA. */
 		void WriteOAM(uint8_t value);
 
+		/* 256 WriteOAM calls at once, starting at OAMADDR and wrapping around, for OAM DMA from plain memory. */
+		void WriteOAMPage(const uint8_t* data);
+
+		/* Stop producing pixels for visible scanlines. Timing, sprite 0 hit and sprite overflow stay exact, the video buffer keeps the last drawn frame. */
+		void SetSkipRendering(bool skip) { skip_rendering = skip; };
+		bool IsSkippingRendering() { return skip_rendering; };
+
+		/* Hash each frame as it is completed. Off by default, as it costs a pass over the video buffer. */
+		void SetFrameHashing(bool enable) { frame_hashing = enable; };
+
+		/* Hash of the last completed frame's pixels, see Hash64. */
+		uint64_t GetFrameHash() { return frame_hash; };
+
+		/* Sprite 0 hit flag in PPUSTATUS, without the side effects of reading the register. */
+		bool IsSpriteZeroHit() { return BitCheck(ppu_status, PPU_STATUS_SPRITE_0_HIT); };
+
+		/* Take a debug snapshot at the start of this scanline (0 - 261) every frame, or -1 for none. */
+		void SetDebugSnapshotScanline(int16_t scanline);
+
+		/* Whether a snapshot was taken since ClearDebugSnapshot, the snapshot, and clearing it once used. */
+		bool IsDebugSnapshotReady() { return debug_snapshot_ready; };
+		const ppu_snapshot_t& GetDebugSnapshot() { return debug_snapshot; };
+		void ClearDebugSnapshot();
+
+		/* The NES master palette, 0xRRGGBB. */
+		const uint32_t* GetMasterPalette() { return palette; };
+
+		/* Render the background of the scanline v points at without changing any state, 8 pixels at a time or one dot at a time like the
+		 * hardware shift registers. Only used to benchmark the two against each other, returns the 256 background pixels. */
+		const uint8_t* BenchmarkBackgroundLine(bool per_dot);
+
+		/* Record visible scanlines into record instead of drawing them, or draw them as they happen again with nullptr. Sprite 0 hit
+		 * is still found as the frame runs. The record must not be touched until the frame's last visible scanline has passed. */
+		void SetFrameRecord(frame_record_t* record);
+
+		/* Draw one recorded scanline into the video buffers, returns whether it changed. Only touches that scanline's part of the
+		 * buffers, so different scanlines can be drawn on different threads while the PPU carries on with the next frame. */
+		bool RasterizeScanline(const scanline_state_t& state);
+
+		/* Called on the emulation thread once a recorded frame has been drawn, with the scanlines RasterizeScanline said changed. */
+		void FinishRecordedFrame(const std::bitset<240>& changed_lines);
+
 		/* I/O functions located in PPU_IO.cpp ----------------------------------------------------------- */
 
 		uint8_t ReadPPU(uint16_t address);              /* Internal reads from the PPU are routed here. */
@@ -79,32 +251,147 @@ class PPU {
 		uint8_t ReadCPU(uint16_t address);              /* Reads from the CPU are routed here. */
 		void WriteCPU(uint16_t address, uint8_t value); /* Writes from the CPU are routed here. */
 
-		/* ----------------------------------------------------------------------------------------------- */
-
-		void SetMirroringMode();
+		/* Palette memory is 32 bytes mirrored through 0x3F00 - 0x3FFF, with 0x3F10/14/18/1C mirroring 0x3F00/04/08/0C. */
+		uint8_t PaletteIndex(uint16_t address) {
+			uint8_t index = address & 0x1F;
+			if((index & 0x13) == 0x10) {
+				index &= 0x0F;
+			}
+			return index;
+		};
 
 		/* Read from PPU memory without causing any emulation side effects. */
-		uint8_t PeekMemory(uint16_t address) { return ppu_memory[address]; };
+		uint8_t PeekMemory(uint16_t address);
+
+		/* count PPUDATA writes or reads in a row, for CPU loops streaming data through PPUDATA. The caller must have caught the
+		   PPU up, and made sure all of them happen before GetDataStreamWindowEnd. */
+		void WriteDataBlock(const uint8_t* values, uint16_t count);
+		void ReadDataBlock(uint8_t* values, uint16_t count);
+
+		/* Cycle count until which PPUDATA accesses go unnoticed by everything but VRAM, v and the read buffer, so a run of them can be
+		   applied at once. That is VBlank up to the pre-render scanline, or the rest of a scanline with rendering off, and never past
+		   the next VBlank flag or a debug snapshot. */
+		uint64_t GetDataStreamWindowEnd();
+
+		/* Point a 1KB page of pattern table space (0x0000 - 0x1FFF) at mapper memory. Pages without memory read as 0. */
+		void MapCHRPage(uint8_t page, uint8_t* memory, bool writable);
+
+		/* Point one of the four 1KB nametables (0x2000 - 0x2FFF, mirrored to 0x3EFF) at memory. Read only pages ignore writes, and
+		   pages without memory read as 0. */
+		void MapNametablePage(uint8_t page, uint8_t* memory, bool writable = true);
+
+		/* Point one of the four nametables at either 1KB half of internal VRAM. */
+		void MapNametableVRAM(uint8_t page, uint8_t vram_page) { MapNametablePage(page, &vram[(vram_page & 0x01) * 0x400]); };
+
+		/* Arrange internal VRAM (and cartridge VRAM for four screen) in the nametable pages. */
+		void SetMirroringMode(mirroring_mode_t mode);
+
+		/* The CPU wrote to 1KB of mapper memory the PPU might be showing as a nametable or reading background fetches from. */
+		void MapperMemoryWritten(const uint8_t* page);
+
+		/* ----------------------------------------------------------------------------------------------- */
 
 		/* Get a pointer to PPU buffer, needed for SDL. */
 		uint32_t* GetVideoBuffer() { return ppu_buffer.data(); };
 
+		/* Same frame as palette indexes, for filters that make their own colors (see NTSCFilter). */
+		const uint16_t* GetIndexedBuffer() { return indexed_buffer.data(); };
+
+		/* Scanlines of the video buffer that changed since ClearDirtyLines was last called. */
+		const std::bitset<240>& GetDirtyLines() { return dirty_lines; };
+		bool IsFrameDirty() { return dirty_lines.any(); };
+		void ClearDirtyLines() { dirty_lines.reset(); };
+
 		uint16_t GetCurrentCycle() { return current_cycle; };
 		uint16_t GetCurrentScanline() { return current_scanline; };
 
 		uint64_t CycleCount() { return cycle_count; };
+		uint64_t FrameCount() { return frame_count; };
 
 		static const uint16_t ScreenWidth { 256 };
 		static const uint16_t ScreenHeight { 240 };
 
+		static const uint16_t CyclesPerScanline { 341 };
+		static const uint16_t ScanlinesPerFrame { 262 };
+
+		static const uint64_t NoEvent { UINT64_MAX };
+
 	private:
 		void ProcessPrerenderScanline();
 		void ProcessVisibleScanline();
 		void ProcessPostrenderScanline();
 
-		void ReadTile();
+		/* Functions located in PPU_Render.cpp ----------------------------------------------------------- */
+
+		/* Fill secondary OAM with up to 8 sprites for the next scanline, and set the sprite overflow flag. */
+		void EvaluateSprites();
+
+		/* Copy of the state the current scanline is drawn from, pointing at live PPU memory. */
+		scanline_state_t CaptureScanlineState();
+
+		/* Add the current scanline to frame_record, copying any memory pages changed since the last recorded scanline. */
+		void RecordScanline();
+
+		/* A page was written, so frame_record needs new copies of it and any page showing the same memory. */
+		void InvalidateRecordedPages(uint8_t page);
+
+		/* One PPUDATA write or read: access VRAM at v, then step v by 1 or 32. */
+		void WriteData(uint8_t value);
+		uint8_t ReadData();
+
+		/* v was changed through PPUADDR or PPUDATA. Outside rendering the address bus follows v, so this can clock the mapper. */
+		void UpdateA12(uint16_t address);
+
+		/* Render a scanline's background into background, 8 pixels at a time. */
+		void RenderBackgroundLine(const scanline_state_t& state, uint8_t* background);
+
+		/* The same as RenderBackgroundLine, but shifting out one pixel per dot. Kept as a reference for the batched version. */
+		void RenderBackgroundLinePerDot(const scanline_state_t& state, uint8_t* background);
+
+		/* Render the sprites in a scanline's secondary OAM into sprites. */
+		void RenderSpriteLine(const scanline_state_t& state, uint8_t* sprites);
+
+		/* Merge background and sprite pixels into the scanline's part of the video buffers, returns whether anything changed. */
+		bool ComposeLine(const scanline_state_t& state, const uint8_t* background, const uint8_t* sprites);
+
+		/* Find the dot sprite 0 hit happens on in the current scanline, if any. */
+		void DetectSpriteZeroHit();
+
+		/* Work out when the next sprite 0 hit happens, assuming nothing is written to the PPU in the meantime. */
+		uint64_t PredictSpriteZeroHit();
+
+		/* Fill a12_line_rises from PPUCTRL and OAM. */
+		void PredictA12Rises();
+
+		/* ----------------------------------------------------------------------------------------------- */
+
+		/* Cycle count once the dot at the given scanline and cycle has been processed. */
+		uint64_t CycleCountAt(uint16_t scanline, uint16_t cycle) {
+			const uint32_t frame_length = CyclesPerScanline * ScanlinesPerFrame;
+			const uint32_t target       = (scanline * CyclesPerScanline) + cycle;
+			const uint32_t position     = (current_scanline * CyclesPerScanline) + current_cycle;
+			return cycle_count + ((target + frame_length - position) % frame_length) + 1;
+		};
+
+		/* Bring debug_snapshot up to date with PPU memory. */
+		void TakeDebugSnapshot();
+
+		/* Scroll register (v/t) updates done by the rendering hardware. */
+		void IncrementScrollX();
+		void IncrementScrollY();
+		void CopyScrollX();
+		void CopyScrollY();
+
+		bool IsRenderingEnabled() {
+			return BitCheck(ppu_mask, PPU_MASK_SHOW_BACKGROUND) || BitCheck(ppu_mask, PPU_MASK_SHOW_SPRITES);
+		};
+
+		/* Whether the mapper's background_fetch changes anything with the current PPUCTRL. */
+		bool IsBackgroundFetchActive() {
+			return background_fetch != nullptr && (background_fetch->extended_attributes || background_fetch->split ||
+				(background_fetch->pattern_pages[0] != nullptr && BitCheck(ppu_ctrl, PPU_CTRL_SPRITE_HEIGHT)));
+		};
 
-		void DrawPixel();
 		void DrawPixel(int x, int y, uint32_t color);
 		void DrawPixel(int x, int y, uint8_t red, uint8_t green, uint8_t blue, uint8_t alpha);
 
@@ -124,18 +411,25 @@ class PPU {
 		/* Internal PPU buffer that holds screen data. */
 		std::vector<uint32_t> ppu_buffer { 0 };
 
-		/* The NES PPU can address up to 16kB (0x4000 bytes) of memory.
-		   However only 2kB is stored directly on the PPU, with the rest depending on cartridge mapping.
-		   It is emulated as full 16kB here for now.*/
-		std::vector<uint8_t> ppu_memory { 0 };
+		/* Screen data before the master palette: 6 bit color in bits 0 - 5, PPUMASK emphasis bits in 6 - 8. */
+		std::vector<uint16_t> indexed_buffer { 0 };
+
+		/* One bit per scanline, set when a scanline is drawn different to what was in ppu_buffer. */
+		std::bitset<240> dirty_lines;
 
-		/* BACKGROUND RENDERING----------------------------------------------------------------- */
+		/* The NES PPU can address up to 16kB (0x4000 bytes) of memory, split here into 16 pages of 1KB.
+		   Pages 0 - 7 are pattern tables provided by the mapper, pages 8 - 11 are the nametables, and pages 12 - 15 mirror them.
+		   Palette RAM at 0x3F00 - 0x3FFF sits on top of the last page and is handled separately. */
+		uint8_t* memory_pages[16] { nullptr };
+		bool writable_pages[16] { false };
 
-		uint16_t pattern_table_shift_register_1 { 0 };
-		uint16_t pattern_table_shift_register_2 { 0 };
+		/* Only 2kB of nametable memory is stored directly on the PPU. */
+		uint8_t vram[0x800] { 0 };
 
-		uint8_t pattern_attribute_shift_register_1 { 0 };
-		uint8_t pattern_attribute_shift_register_2 { 0 };
+		uint8_t palette_ram[0x20] { 0 };
+
+		/* Backing for unmapped pattern table pages. Never writable, so always reads 0. */
+		uint8_t unmapped_page[0x400] { 0 };
 
 		/* SPRITE RENDERING -------------------------------------------------------------------- */
 
@@ -144,25 +438,87 @@ class PPU {
 		/* This secondary OAM is used internally by the PPU to hold 8 sprites being rendered that scanline. */
 		std::vector<uint8_t> second_attribute_memory { 0 };
 
-		uint8_t pattern_table_shift_register_oam_1[8] { 0 };
-		uint8_t pattern_table_shift_register_oam_2[8] { 0 };
+		/* Number of sprites copied to secondary OAM, and whether sprite 0 is one of them. */
+		uint8_t sprite_count { 0 };
+		bool sprite_zero_in_line { false };
+
+		/* DEBUG SNAPSHOTS --------------------------------------------------------------------- */
+
+		ppu_snapshot_t debug_snapshot;
+		int16_t debug_snapshot_scanline { -1 };
+		bool debug_snapshot_ready { false };
+
+		/* Pattern table tiles changed since the last snapshot, by CHR RAM writes or bank switches. */
+		std::bitset<512> chr_dirty_tiles;
+
+		/* DEFERRED RENDERING ------------------------------------------------------------------- */
+
+		/* Frame being recorded, nullptr when scanlines are drawn as they happen. */
+		frame_record_t* frame_record { nullptr };
+
+		/* Copy of each page in frame_record as of the last recorded scanline, nullptr once the page has been written or banked out. */
+		const uint8_t* recorded_pages[12] { nullptr };
+
+		/* Set while frames are being skipped. */
+		bool skip_rendering { false };
+
+		bool frame_hashing { false };
+		uint64_t frame_hash { 0 };
+
+		/* Dot on the current scanline at which sprite 0 hit is raised, 0 if none. */
+		uint16_t sprite_zero_hit_dot { 0 };
+
+		/* Cached sprite 0 hit prediction, recalculated once invalidated or once the expiry cycle count passes. */
+		uint64_t sprite_zero_hit_cycle { NoEvent };
+		uint64_t sprite_zero_prediction_expires { 0 };
+		bool sprite_zero_prediction_valid { false };
 
-		uint8_t attribute_latch[8]  { 0 };
+		/* MAPPER SCANLINE COUNTERS ------------------------------------------------------------ */
 
-		uint8_t x_position_counter[8] { 0 };
+		bool a12_watched { false };
+
+		/* The A12 rises a scanline counter sees on each rendering scanline, a bit per 4 dots from dot 256. Worked out from PPUCTRL
+		   and OAM, so thrown away when either is written. */
+		std::array<uint32_t, ScanlinesPerFrame> a12_line_rises { 0 };
+		bool a12_rises_valid { false };
+
+		/* Rises still to come on the current scanline, picked up from a12_line_rises at dot 256. */
+		uint32_t a12_rises { 0 };
+
+		/* A12 as last set by v outside rendering. */
+		bool a12_high { false };
+
+		bool scanlines_watched { false };
+
+		/* MAPPER BACKGROUND FETCHES ----------------------------------------------------------- */
+
+		/* Owned by the mapper, nullptr when it draws nothing of the background. */
+		const background_fetch_t* background_fetch { nullptr };
+
+		/* Copy of background_fetch->expansion in frame_record as of the last recorded scanline, nullptr once written. */
+		const uint8_t* recorded_expansion { nullptr };
+
+		/* SCANLINE BUFFERS -------------------------------------------------------------------- */
+
+		/* Background palette index (0 - 15) for each pixel of the current scanline. Index 0 of each palette is transparent. */
+		uint8_t background_line[ScreenWidth] { 0 };
+
+		/* Sprite pixels of the current scanline. Bits 0 - 4 are the palette index (0x10 - 0x1F), 0 when transparent. */
+		uint8_t sprite_line[ScreenWidth] { 0 };
 
 		/* PPU REGISTERS ----------------------------------------------------------------------- */
 
 		uint8_t ppu_ctrl { 0 };     /* General PPU control register. Controls NMI, Master/Slave, Sprite Height, Background Select, Sprite Tile Select, Increment Mode and Nametable Select. */
 		uint8_t ppu_mask { 0 };     /* Rendering PPU control register. Controls Color Emphasis, Sprite Priority, Background Enable, Sprite Left Column Enable, Background Left Column Enable and Greyscale. */
 		uint8_t ppu_status { 0 };   /* General PPU status register. Normally read only. Informs of VBlank Start, Sprite 0 Hit, and the buggy Sprite Overflow flag. */
-		uint8_t ppu_scroll_x { 0 }; /* Latch/Register controlling PPU scrolling. Takes 2 successive writes. Write 1 is X value, write 2 is Y value (X value stored here). */
-		uint8_t ppu_scroll_y { 0 }; /* Latch/Register controlling PPU scrolling. Takes 2 successive writes. Write 1 is X value, write 2 is Y value (Y value stored here). */
-		uint16_t ppu_address { 0 }; /* Latch/Register containing PPU read/write address. Takes 2 successive writes. Write 1 is MSB, write 2 is LSB. */
+		uint16_t ppu_address { 0 }; /* Current VRAM address ("v"). Set through PPUADDR, also holds the scroll position while rendering. */
 		uint8_t oam_address { 0 };  /* Latch/Register containing OAM read/write address. Takes 1 write. */
 
-		uint8_t ppu_scroll_write_counter { 0 };  /* Internal counter keeping track of writes to PPUSCROLL. */
-		uint8_t ppu_address_write_counter { 0 }; /* Internal counter keeping track of writes to PPUADDR. */
+		uint16_t temp_address { 0 }; /* Temporary VRAM address ("t"). PPUCTRL, PPUSCROLL and PPUADDR writes are staged here. */
+		uint8_t fine_x_scroll { 0 }; /* Fine X scroll (0 - 7), set by the first PPUSCROLL write. */
+		bool write_toggle { false }; /* First/second write toggle shared by PPUSCROLL and PPUADDR. Cleared by reading PPUSTATUS. */
+
+		uint8_t ppu_data_buffer { 0 }; /* PPUDATA reads outside palette memory return this buffer, then refill it. */
 
 		uint16_t current_scanline { 0 }; /* Internal counter keeping track of the current scanline. */
 		uint16_t current_cycle { 0 };    /* Internal counter keeping track of the current cycle inside the scanline. */
@@ -20,6 +20,8 @@
 
 /* PPU reading/writing functions located here to ease readability. */
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 
 #include "../BitOps.hpp"
@@ -34,31 +36,50 @@
 
 uint8_t PPU::ReadPPU(uint16_t address) {
 
-	uint8_t value = nes_system->GetFloatingBus();
+	address &= 0x3FFF;
 
-         if(address >= 0x0000 && address <= 0x1FFF) { value = nes_system->GetCartridge()->GetMapper()->ReadPPU(address); } /* Normally mapped to CHR-ROM or CHR-RAM. Often bankswitched. */
-    else if(address >= 0x2000 && address <= 0x2FFF) { value = ppu_memory[address - 0x2000]; }                              /* Normally mapped to 2kB PPU RAM, but can be partly or fulled remapped to cartridge. */
-    else if(address >= 0x3000 && address <= 0x3EFF) { value = ppu_memory[address - 0x2000]; }                              /* "Usually" a mirror of 0x2000 to 0x2FFF. */
-    else if(address >= 0x3F00 && address <= 0x3FFF) { value = ppu_memory[address - 0x2000]; }                              /* Always mapped to PPU internal pallete control. */
-	else {
-		std::cout << "PPU tried to read from address outside it's memory map: " << HEX4(address) << "\n";
-		value = nes_system->GetFloatingBus();
+	/* Palette RAM is always inside the PPU. */
+	if(address >= 0x3F00) {
+		return palette_ram[PaletteIndex(address)];
 	}
 
-	nes_system->SetFloatingBus(value);
-	return value;
+	/* Pattern tables and nametables, wherever the cartridge has mapped them. */
+	return memory_pages[address >> 10][address & 0x3FF];
+}
+
+uint8_t PPU::PeekMemory(uint16_t address) {
+
+	address &= 0x3FFF;
+
+	if(address >= 0x3F00) {
+		return palette_ram[PaletteIndex(address)];
+	}
+
+	return memory_pages[address >> 10][address & 0x3FF];
 }
 
 void PPU::WritePPU(uint16_t address, uint8_t value) {
 
 	nes_system->SetFloatingBus(value);
 
-         if(address >= 0x0000 && address <= 0x1FFF) { nes_system->GetCartridge()->GetMapper()->WritePPU(address, value); } /* Normally mapped to CHR-ROM or CHR-RAM. Often bankswitched. */
-    else if(address >= 0x2000 && address <= 0x2FFF) { ppu_memory[address - 0x2000] = value; }                              /* Normally mapped to 2kB PPU RAM, but can be partly or fulled remapped to cartridge. */
-    else if(address >= 0x3000 && address <= 0x3EFF) { ppu_memory[address - 0x2000] = value; }                              /* "Usually" a mirror of 0x2000 to 0x2FFF. */
-    else if(address >= 0x3F00 && address <= 0x3FFF) { ppu_memory[address - 0x2000] = value; }                              /* Always mapped to PPU internal pallete control. */
-	else {
-		std::cout << "PPU tried to write to an address outside it's memory map (" << HEX4(address) << ") with value: " << HEX2(value) << "\n";	 
+	address &= 0x3FFF;
+
+	if(address >= 0x3F00) {
+		palette_ram[PaletteIndex(address)] = value;
+		return;
+	}
+
+	/* Writes to CHR ROM are dropped. */
+	if(writable_pages[address >> 10]) {
+		memory_pages[address >> 10][address & 0x3FF] = value;
+
+		if(address < 0x2000) {
+			chr_dirty_tiles.set(address >> 4);
+		}
+
+		if(frame_record != nullptr) {
+			InvalidateRecordedPages(address >> 10);
+		}
 	}
 
 	return;
@@ -66,6 +87,9 @@ void PPU::WritePPU(uint16_t address, uint8_t value) {
 
 uint8_t PPU::ReadCPU(uint16_t address) {
 
+	/* Bring the PPU up to date before the CPU observes it. */
+	nes_system->SyncPPU();
+
 	uint8_t value = 0x00;
 
 	/* PPUCTRL */
@@ -82,14 +106,10 @@ uint8_t PPU::ReadCPU(uint16_t address) {
 	if(address == 0x2002) {
 		// TODO: Fill lower 5 bits with data from last register write.
 		value = ppu_status;
-		ppu_status = ppu_status ^ 0x80;
+		BitClear(ppu_status, PPU_STATUS_VBLANK);
 
-		/* Reading from PPUSTATUS clears both PPUSCROLL and PPUADDR latches. */
-		ppu_scroll_x = 0;
-		ppu_scroll_y = 0;
-		ppu_address  = 0;
-		ppu_address_write_counter = 0;
-		ppu_scroll_write_counter  = 0;
+		/* Reading from PPUSTATUS resets the write toggle shared by PPUSCROLL and PPUADDR. */
+		write_toggle = false;
 	}
 
 	/* OAMADDR */
@@ -116,17 +136,7 @@ uint8_t PPU::ReadCPU(uint16_t address) {
 
 	/* PPUDATA */
 	if(address == 0x2007) {
-	
-		if(ppu_address >= 0x1000) {
-			return 0;
-		}
-		
-		value = ppu_memory[ppu_address];
-
-		/* Check if bit 2 is set to increment VRAM address. */
-		if(ppu_ctrl & 0x02) {
-			ppu_address++;
-		}
+		value = ReadData();
 	}
 
 	nes_system->SetFloatingBus(value);
@@ -135,6 +145,9 @@ uint8_t PPU::ReadCPU(uint16_t address) {
 
 void PPU::WriteCPU(uint16_t address, uint8_t value) {
 
+	/* Bring the PPU up to date before the CPU changes it. */
+	nes_system->SyncPPU();
+
 	nes_system->SetFloatingBus(value);
 
 	/* According to NESdev wiki, writing to certain PPU registers before 29658 CPU clocks is ignored. */
@@ -144,6 +157,9 @@ void PPU::WriteCPU(uint16_t address, uint8_t value) {
 	/* PPUCTRL */
 	if(address == 0x2000 && unlock_registers) {
 		ppu_ctrl = value;
+
+		/* Nametable select goes to bits 10 and 11 of t. */
+		temp_address = (temp_address & ~0x0C00) | ((value & 0x03) << 10);
 	}
 
 	/* PPUMASK */
@@ -169,55 +185,148 @@ void PPU::WriteCPU(uint16_t address, uint8_t value) {
 
 	/* PPUSCROLL */
 	if(address == 0x2005 && unlock_registers) {
-		switch(ppu_scroll_write_counter) {
-			case 0x00: // First write, X
-				ppu_address = (ppu_address + (value << 8));
-				ppu_address_write_counter++;
-				break;
-			case 0x01: // Second write, Y, reset counter.
-				ppu_address = (ppu_address + (value << 8));
-				ppu_address_write_counter = 0;
-				break;
-			default: // wut
-				ppu_address_write_counter = 0;
-				return;
+		if(!write_toggle) {
+			/* First write, X. Coarse X goes to t, fine X to its own register. */
+			temp_address = (temp_address & ~0x001F) | (value >> 3);
+			fine_x_scroll = value & 0x07;
+		} else {
+			/* Second write, Y. Fine Y goes to bits 12 - 14 of t, coarse Y to bits 5 - 9. */
+			temp_address = (temp_address & ~0x73E0) | ((value & 0x07) << 12) | ((value & 0xF8) << 2);
 		}
+
+		write_toggle = !write_toggle;
 	}
 
 	/* PPUADDR */
 	if(address == 0x2006 && unlock_registers) {
-
-		switch(ppu_address_write_counter) {
-			case 0x00: // First write, MSB
-				ppu_address = (value << 8);
-				ppu_address_write_counter++;
-				break;
-			case 0x01: // Second write, LSB, reset counter.
-				ppu_address += value;
-				ppu_address_write_counter = 0;
-				break;
-			default: // wut
-				ppu_address_write_counter = 0;
-				return;
+		if(!write_toggle) {
+			/* First write, MSB. Bit 14 is cleared. */
+			temp_address = (temp_address & 0x00FF) | ((value & 0x3F) << 8);
+		} else {
+			/* Second write, LSB, after which t is copied to v. */
+			temp_address = (temp_address & 0xFF00) | value;
+			ppu_address = temp_address;
+
+			UpdateA12(ppu_address);
 		}
+
+		write_toggle = !write_toggle;
 	}
 
 	/* PPUDATA */
 	if(address == 0x2007) {
-	
-		// TODO: Commented out until CPU is fully working.
-		ppu_memory[ppu_address] = value;
+		WriteData(value);
+	}
+
+	/* Any register write can move, hide or redraw sprite 0 or the background under it. */
+	sprite_zero_prediction_valid = false;
+
+	/* PPUCTRL picks the pattern tables, and OAMDATA the sprite tiles, that A12 follows. */
+	if(address == 0x2000 || address == 0x2004) {
+		a12_rises_valid = false;
+	}
+
+	/* Rendering switched on or off, or the tables changed, moves the mapper's next scanline clock. */
+	if((a12_watched && (address == 0x2000 || address == 0x2001 || address == 0x2004)) || (scanlines_watched && address == 0x2001)) {
+		nes_system->ScheduleNextEvent();
+	}
+
+	return;
+}
+
+void PPU::WriteData(uint8_t value) {
 
-		/* Check if bit 2 is set to increment VRAM address. */
-		if(ppu_ctrl & 0x02) {
-			ppu_address++;
+	WritePPU(ppu_address & 0x3FFF, value);
 
-			// HACK: This is a temporary hack to prevent access beyond what PPU memory should allow. NOT CORRECT AT ALL.
-			if(ppu_address == 0x4000) {
-				ppu_address = 0;
+	/* Bit 2 of PPUCTRL selects going across (+1) or down (+32). */
+	ppu_address = (ppu_address + (BitCheck(ppu_ctrl, PPU_CTRL_INCREMENT_MODE) ? 32 : 1)) & 0x7FFF;
+
+	UpdateA12(ppu_address);
+}
+
+uint8_t PPU::ReadData() {
+
+	uint8_t value;
+
+	/* Reads are delayed through an internal buffer, except for palette memory which is returned immediately. */
+	if((ppu_address & 0x3FFF) >= 0x3F00) {
+		value = ReadPPU(ppu_address & 0x3FFF);
+		/* The buffer is filled with the nametable byte "underneath" the palette. */
+		ppu_data_buffer = ReadPPU(ppu_address & 0x2FFF);
+	} else {
+		value = ppu_data_buffer;
+		ppu_data_buffer = ReadPPU(ppu_address & 0x3FFF);
+	}
+
+	/* Bit 2 of PPUCTRL selects going across (+1) or down (+32). */
+	ppu_address = (ppu_address + (BitCheck(ppu_ctrl, PPU_CTRL_INCREMENT_MODE) ? 32 : 1)) & 0x7FFF;
+
+	UpdateA12(ppu_address);
+
+	return value;
+}
+
+void PPU::UpdateA12(uint16_t address) {
+
+	/* While rendering, A12 follows the fetches instead, see PredictA12Rises. */
+	if(!a12_watched || (IsRenderingEnabled() && (current_scanline < 240 || current_scanline == 261))) {
+		return;
+	}
+
+	const bool high = BitCheck(address, 12);
+
+	/* Unlike the clocks from rendering, nothing predicted this one, so the mapper's next IRQ can move. */
+	if(high && !a12_high) {
+		nes_system->GetCartridge()->GetMapper()->ClockA12();
+		nes_system->ScheduleNextEvent();
+	}
+
+	a12_high = high;
+}
+
+void PPU::WriteDataBlock(const uint8_t* values, uint16_t count) {
+
+	uint16_t i = 0;
+
+	while(i < count) {
+		const uint16_t address = ppu_address & 0x3FFF;
+
+		/* Runs going across one writable page are copied in one go, stopping short of palette RAM. */
+		if(!BitCheck(ppu_ctrl, PPU_CTRL_INCREMENT_MODE) && address < 0x3F00 && writable_pages[address >> 10]) {
+			const uint16_t run = std::min<uint16_t>({ static_cast<uint16_t>(count - i), static_cast<uint16_t>(0x400 - (address & 0x3FF)), static_cast<uint16_t>(0x3F00 - address) });
+
+			std::memcpy(&memory_pages[address >> 10][address & 0x3FF], &values[i], run);
+
+			if(address < 0x2000) {
+				for(uint16_t tile = address >> 4; tile <= (address + run - 1) >> 4; tile++) {
+					chr_dirty_tiles.set(tile);
+				}
+			}
+
+			if(frame_record != nullptr) {
+				InvalidateRecordedPages(address >> 10);
 			}
+
+			ppu_address = (ppu_address + run) & 0x7FFF;
+			i += run;
+
+			/* A run never crosses A12 until the address after it. */
+			UpdateA12(ppu_address);
+		} else {
+			WriteData(values[i]);
+			i++;
 		}
 	}
 
-	return;
+	nes_system->SetFloatingBus(values[count - 1]);
+	sprite_zero_prediction_valid = false;
+}
+
+void PPU::ReadDataBlock(uint8_t* values, uint16_t count) {
+
+	for(uint16_t i = 0; i < count; i++) {
+		values[i] = ReadData();
+	}
+
+	nes_system->SetFloatingBus(values[count - 1]);
 }
\ No newline at end of file
@@ -0,0 +1,754 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* PPU scanline rendering functions located here to ease readability. */
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+
+#include "../BitOps.hpp"
+#include "NESSystem.hpp"
+
+#include "PPU.hpp"
+
+void PPU::EvaluateSprites() {
+
+	const uint8_t sprite_height = BitCheck(ppu_ctrl, PPU_CTRL_SPRITE_HEIGHT) ? 16 : 8;
+
+	sprite_count = 0;
+	sprite_zero_in_line = false;
+
+	uint8_t n = 0;
+
+	/* Copy the first 8 sprites in range of this scanline into secondary OAM. */
+	for(; n < 64 && sprite_count < 8; n++) {
+
+		uint16_t row = current_scanline - object_attribute_memory[n * 4];
+
+		if(row >= sprite_height) {
+			continue;
+		}
+
+		if(n == 0) {
+			sprite_zero_in_line = true;
+		}
+
+		std::memcpy(&second_attribute_memory[sprite_count * 4], &object_attribute_memory[n * 4], 4);
+		sprite_count++;
+	}
+
+	/* With secondary OAM full, hardware keeps checking for overflow, but buggily increments both the sprite and byte index on a miss. */
+	uint8_t m = 0;
+
+	for(; n < 64; n++) {
+
+		uint16_t row = current_scanline - object_attribute_memory[(n * 4) + m];
+
+		if(row < sprite_height) {
+			BitSet(ppu_status, PPU_STATUS_SPRITE_OVERFLOW);
+			break;
+		}
+
+		m = (m + 1) & 0x03;
+	}
+}
+
+/* Each bit of a pattern byte spread out to its own byte, with the leftmost pixel (bit 7) in the low byte. */
+static constexpr std::array<uint64_t, 256> MakePatternSpread() {
+
+	std::array<uint64_t, 256> spread {};
+
+	for(uint32_t value = 0; value < 256; value++) {
+		for(uint32_t bit = 0; bit < 8; bit++) {
+			spread[value] |= static_cast<uint64_t>((value >> (7 - bit)) & 0x01) << (bit * 8);
+		}
+	}
+
+	return spread;
+}
+
+static constexpr std::array<uint64_t, 256> pattern_spread = MakePatternSpread();
+
+/* Read from the pattern tables or nametables as a scanline saw them. */
+static inline uint8_t ReadScanlineMemory(const scanline_state_t& state, uint16_t address) {
+	return state.pages[address >> 10][address & 0x3FF];
+}
+
+/* Coarse X increment of v, wrapping from 31 to 0 into the horizontally adjacent nametable. */
+static inline uint16_t NextTileAddress(uint16_t address) {
+	return ((address & 0x001F) == 31) ? ((address & ~0x001F) ^ 0x0400) : (address + 1);
+}
+
+/* Pattern table row and palette bits of a tile fetched the way the mapper's background_fetch_t says. tile counts the scanline's
+   fetches from 0, the leftmost tile. */
+static void FetchMapperTile(const scanline_state_t& state, uint16_t address, uint8_t tile, uint8_t& pattern_low, uint8_t& pattern_high, uint8_t& palette_select) {
+
+	const background_fetch_t& fetch = state.background;
+	const uint8_t* pattern;
+
+	if(fetch.split && ((tile < fetch.split_tile) != fetch.split_right)) {
+		/* The split ignores v, its rows go down the expansion memory one per scanline from the split scroll, and its columns
+		   follow the fetches. Scrolling past the bottom wraps back to the top like coarse Y does. */
+		uint16_t row = fetch.split_scroll + state.scanline;
+
+		if(row >= 240) {
+			row -= 240;
+		}
+
+		const uint8_t column = tile & 0x1F;
+		const uint8_t tile_index = fetch.expansion[((row & 0xF8) << 2) | column];
+		const uint8_t attribute = fetch.expansion[0x3C0 | ((row & 0xE0) >> 2) | (column >> 2)];
+
+		palette_select = (attribute >> (((row >> 2) & 0x04) | (column & 0x02))) & 0x03;
+		pattern = &fetch.chr[((fetch.split_bank % fetch.chr_banks) * 0x1000) + (tile_index * 16) + (row & 0x07)];
+	} else {
+		const uint8_t fine_y = (state.ppu_address >> 12) & 0x07;
+		const uint8_t tile_index = ReadScanlineMemory(state, 0x2000 | (address & 0x0FFF));
+
+		if(fetch.extended_attributes) {
+			/* Bank and palette for every tile from the expansion byte at its nametable offset, the attribute table goes unused. */
+			const uint8_t extended = fetch.expansion[address & 0x3FF];
+			const uint16_t bank = ((fetch.extended_bank_high << 6) | (extended & 0x3F)) % fetch.chr_banks;
+
+			palette_select = extended >> 6;
+			pattern = &fetch.chr[(bank * 0x1000) + (tile_index * 16) + fine_y];
+		} else {
+			const uint8_t attribute = ReadScanlineMemory(state, 0x23C0 | (address & 0x0C00) | ((address >> 4) & 0x38) | ((address >> 2) & 0x07));
+			const uint16_t pattern_address = (BitCheck(state.ppu_ctrl, PPU_CTRL_BACKG_TILE_SELECT) ? 0x1000 : 0x0000) + (tile_index * 16) + fine_y;
+
+			palette_select = (attribute >> (((address >> 4) & 0x04) | (address & 0x02))) & 0x03;
+
+			if(fetch.pattern_pages[0] != nullptr && BitCheck(state.ppu_ctrl, PPU_CTRL_SPRITE_HEIGHT)) {
+				pattern = &fetch.pattern_pages[pattern_address >> 10][pattern_address & 0x3FF];
+			} else {
+				pattern = &state.pages[pattern_address >> 10][pattern_address & 0x3FF];
+			}
+		}
+	}
+
+	pattern_low  = pattern[0];
+	pattern_high = pattern[8];
+}
+
+/* Pattern table row and palette bits of the tile at address, the scanline's tile'th fetch. */
+static inline void FetchTile(const scanline_state_t& state, uint16_t address, uint8_t tile, uint8_t& pattern_low, uint8_t& pattern_high, uint8_t& palette_select) {
+
+	if(state.mapper_fetch) {
+		FetchMapperTile(state, address, tile, pattern_low, pattern_high, palette_select);
+		return;
+	}
+
+	const uint16_t pattern_table = BitCheck(state.ppu_ctrl, PPU_CTRL_BACKG_TILE_SELECT) ? 0x1000 : 0x0000;
+	const uint8_t fine_y = (state.ppu_address >> 12) & 0x07;
+
+	uint8_t tile_index = ReadScanlineMemory(state, 0x2000 | (address & 0x0FFF));
+	uint8_t attribute  = ReadScanlineMemory(state, 0x23C0 | (address & 0x0C00) | ((address >> 4) & 0x38) | ((address >> 2) & 0x07));
+
+	/* Each attribute byte covers 4x4 tiles, pick the 2x2 quadrant this tile is in. */
+	palette_select = (attribute >> (((address >> 4) & 0x04) | (address & 0x02))) & 0x03;
+
+	uint16_t pattern_address = pattern_table + (tile_index * 16) + fine_y;
+	pattern_low  = ReadScanlineMemory(state, pattern_address);
+	pattern_high = ReadScanlineMemory(state, pattern_address + 8);
+}
+
+/* The tile's 8 pixels packed one per byte, leftmost in the low byte, with the palette applied. */
+static inline uint64_t FetchTilePixels(const scanline_state_t& state, uint16_t address, uint8_t tile) {
+
+	uint8_t pattern_low, pattern_high, palette_select;
+	FetchTile(state, address, tile, pattern_low, pattern_high, palette_select);
+
+	/* Both planes at once, then the palette goes on the opaque pixels: a byte is 0 - 3 here, so multiplying can't carry into the next. */
+	uint64_t pixels = pattern_spread[pattern_low] | (pattern_spread[pattern_high] << 1);
+	uint64_t opaque = (pixels | (pixels >> 1)) & 0x0101010101010101;
+
+	return pixels | (opaque * (palette_select << 2));
+}
+
+scanline_state_t PPU::CaptureScanlineState() {
+
+	scanline_state_t state;
+
+	std::memcpy(state.pages, memory_pages, sizeof(state.pages));
+	std::memcpy(state.palette, palette_ram, sizeof(state.palette));
+	std::memcpy(state.sprites, second_attribute_memory.data(), sizeof(state.sprites));
+
+	state.sprite_count = sprite_count;
+	state.sprite_zero_in_line = sprite_zero_in_line;
+	state.ppu_ctrl = ppu_ctrl;
+	state.ppu_mask = ppu_mask;
+	state.ppu_address = ppu_address;
+	state.fine_x_scroll = fine_x_scroll;
+	state.scanline = current_scanline;
+
+	if(IsBackgroundFetchActive()) {
+		state.background = *background_fetch;
+		state.mapper_fetch = true;
+	}
+
+	return state;
+}
+
+void PPU::RecordScanline() {
+
+	scanline_state_t& state = frame_record->lines[current_scanline];
+	state = CaptureScanlineState();
+
+	auto copy_page = [this](const uint8_t* memory) -> const uint8_t* {
+		if(frame_record->pages_used == frame_record->pages.size()) {
+			frame_record->pages.emplace_back();
+		}
+
+		uint8_t* copy = frame_record->pages[frame_record->pages_used++].data();
+		std::memcpy(copy, memory, 0x400);
+		return copy;
+	};
+
+	/* Games rarely touch VRAM while rendering, so most frames copy each page once, on the first scanline. */
+	for(uint8_t page = 0; page < 12; page++) {
+
+		if(recorded_pages[page] == nullptr) {
+			recorded_pages[page] = copy_page(memory_pages[page]);
+		}
+
+		state.pages[page] = recorded_pages[page];
+	}
+
+	/* The mapper's expansion memory is written during rendering far more often than VRAM, but still only needs a copy per write. */
+	if(state.mapper_fetch && state.background.expansion != nullptr) {
+		if(recorded_expansion == nullptr) {
+			recorded_expansion = copy_page(state.background.expansion);
+		}
+
+		state.background.expansion = recorded_expansion;
+	}
+
+	frame_record->recorded.set(current_scanline);
+}
+
+void PPU::InvalidateRecordedPages(uint8_t page) {
+
+	/* Mirroring and CHR banking can show the same memory in several pages, a recorded frame needs new copies of all of them. */
+	for(uint8_t other = 0; other < 12; other++) {
+		if(memory_pages[other] == memory_pages[page]) {
+			recorded_pages[other] = nullptr;
+		}
+	}
+
+	/* Expansion memory can be shown as a nametable too. */
+	if(background_fetch != nullptr && background_fetch->expansion == memory_pages[page]) {
+		recorded_expansion = nullptr;
+	}
+}
+
+void PPU::RenderBackgroundLine(const scanline_state_t& state, uint8_t* background) {
+
+	if(!BitCheck(state.ppu_mask, PPU_MASK_SHOW_BACKGROUND)) {
+		std::memset(background, 0, ScreenWidth);
+		return;
+	}
+
+	/* Walk a copy of v across the scanline, the real v is only updated per line. */
+	uint16_t address = state.ppu_address;
+
+	/* Pixels of the tile being drawn and the one after it, a 16 pixel window standing in for the hardware's per dot pattern and
+	 * attribute shift registers. The first two tiles are in it before the first dot, as with the fetches at the end of the previous scanline. */
+	uint64_t shift_register_1 = FetchTilePixels(state, address, 0);
+	address = NextTileAddress(address);
+	uint64_t shift_register_2 = FetchTilePixels(state, address, 1);
+	address = NextTileAddress(address);
+
+	/* Fine X picks 8 pixels out of the window with one shift. The second register is shifted in two steps so a fine X of 0 doesn't
+	 * shift by 64, and pixels are stored little endian so the leftmost ends up first in the line. */
+	const uint32_t shift = state.fine_x_scroll * 8;
+
+	for(uint32_t x = 0; x < ScreenWidth; x += 8) {
+		uint64_t pixels = (shift_register_1 >> shift) | ((shift_register_2 << 1) << (63 - shift));
+		std::memcpy(&background[x], &pixels, sizeof(pixels));
+
+		if(x + 8 < ScreenWidth) {
+			shift_register_1 = shift_register_2;
+			shift_register_2 = FetchTilePixels(state, address, (x / 8) + 2);
+			address = NextTileAddress(address);
+		}
+	}
+
+	if(!BitCheck(state.ppu_mask, PPU_MASK_BACKGROUND_LEFT_COLUMN_ENABLE)) {
+		std::memset(background, 0, 8);
+	}
+}
+
+void PPU::RenderBackgroundLinePerDot(const scanline_state_t& state, uint8_t* background) {
+
+	if(!BitCheck(state.ppu_mask, PPU_MASK_SHOW_BACKGROUND)) {
+		std::memset(background, 0, ScreenWidth);
+		return;
+	}
+
+	const uint8_t fine_x = state.fine_x_scroll;
+	uint16_t address = state.ppu_address;
+
+	/* 16 bit pattern shift registers with the next tile in the low byte, and 8 bit attribute shift registers fed from a latch. */
+	uint16_t pattern_shift_low = 0;
+	uint16_t pattern_shift_high = 0;
+	uint8_t attribute_shift_low = 0;
+	uint8_t attribute_shift_high = 0;
+	uint8_t attribute_latch = 0;
+	uint8_t tile = 0;
+
+	auto load_tile = [&]() {
+		uint8_t pattern_low, pattern_high;
+		FetchTile(state, address, tile++, pattern_low, pattern_high, attribute_latch);
+
+		pattern_shift_low  = (pattern_shift_low & 0xFF00) | pattern_low;
+		pattern_shift_high = (pattern_shift_high & 0xFF00) | pattern_high;
+
+		address = NextTileAddress(address);
+	};
+
+	auto shift = [&]() {
+		pattern_shift_low  <<= 1;
+		pattern_shift_high <<= 1;
+		attribute_shift_low  = (attribute_shift_low << 1) | (attribute_latch & 0x01);
+		attribute_shift_high = (attribute_shift_high << 1) | (attribute_latch >> 1);
+	};
+
+	/* Dots 321 - 336 of the previous scanline: the first tile is loaded and shifted into place, then the second one is loaded. */
+	load_tile();
+
+	for(uint8_t dot = 0; dot < 8; dot++) {
+		shift();
+	}
+
+	load_tile();
+
+	for(uint32_t x = 0; x < ScreenWidth; x++) {
+
+		if(x > 0 && (x % 8) == 0) {
+			load_tile();
+		}
+
+		uint8_t pixel = ((pattern_shift_low >> (15 - fine_x)) & 0x01) | (((pattern_shift_high >> (15 - fine_x)) & 0x01) << 1);
+		uint8_t palette_select = ((attribute_shift_low >> (7 - fine_x)) & 0x01) | (((attribute_shift_high >> (7 - fine_x)) & 0x01) << 1);
+
+		background[x] = pixel ? ((palette_select << 2) | pixel) : 0;
+
+		shift();
+	}
+
+	if(!BitCheck(state.ppu_mask, PPU_MASK_BACKGROUND_LEFT_COLUMN_ENABLE)) {
+		std::memset(background, 0, 8);
+	}
+}
+
+const uint8_t* PPU::BenchmarkBackgroundLine(bool per_dot) {
+
+	const scanline_state_t state = CaptureScanlineState();
+
+	if(per_dot) {
+		RenderBackgroundLinePerDot(state, background_line);
+	} else {
+		RenderBackgroundLine(state, background_line);
+	}
+
+	return background_line;
+}
+
+void PPU::RenderSpriteLine(const scanline_state_t& state, uint8_t* sprites) {
+
+	std::memset(sprites, 0, ScreenWidth);
+
+	if(!BitCheck(state.ppu_mask, PPU_MASK_SHOW_SPRITES)) {
+		return;
+	}
+
+	const bool tall_sprites = BitCheck(state.ppu_ctrl, PPU_CTRL_SPRITE_HEIGHT);
+	const uint8_t sprite_height = tall_sprites ? 16 : 8;
+
+	for(uint8_t i = 0; i < state.sprite_count; i++) {
+
+		const uint8_t* sprite = &state.sprites[i * 4];
+
+		const uint8_t y          = sprite[0];
+		const uint8_t tile_index = sprite[1];
+		const uint8_t attributes = sprite[2];
+		const uint8_t x          = sprite[3];
+
+		/* Sprites were evaluated on the previous scanline, and are drawn one line below their Y coordinate. */
+		uint8_t row = (state.scanline - 1) - y;
+
+		/* Flip vertically. */
+		if(BitCheck(attributes, 7)) {
+			row = (sprite_height - 1) - row;
+		}
+
+		uint16_t pattern_address;
+
+		if(tall_sprites) {
+			/* 8x16 sprites take their pattern table from bit 0 of the tile index, and use two consecutive tiles. */
+			pattern_address = ((tile_index & 0x01) << 12) + ((tile_index & 0xFE) * 16) + ((row & 0x08) << 1) + (row & 0x07);
+		} else {
+			pattern_address = (BitCheck(state.ppu_ctrl, PPU_CTRL_SPRITE_TILE_SELECT) ? 0x1000 : 0x0000) + (tile_index * 16) + row;
+		}
+
+		uint8_t pattern_low  = ReadScanlineMemory(state, pattern_address);
+		uint8_t pattern_high = ReadScanlineMemory(state, pattern_address + 8);
+
+		/* Bits 0 - 4 palette index, bit 6 set when behind the background, bit 7 set for sprite 0. */
+		const uint8_t flags = 0x10 | ((attributes & 0x03) << 2) | (BitCheck(attributes, 5) << 6) | ((i == 0 && state.sprite_zero_in_line) << 7);
+
+		for(uint8_t bit = 0; bit < 8; bit++) {
+
+			if(x + bit >= ScreenWidth) {
+				break;
+			}
+
+			/* Flip horizontally. */
+			uint8_t shift = BitCheck(attributes, 6) ? bit : (7 - bit);
+			uint8_t pixel = ((pattern_low >> shift) & 0x01) | (((pattern_high >> shift) & 0x01) << 1);
+
+			/* Lower sprite indexes are in front, so only the first opaque pixel at each X is kept, even if it is behind the background. */
+			if(pixel && !sprites[x + bit]) {
+				sprites[x + bit] = flags | pixel;
+			}
+		}
+	}
+
+	if(!BitCheck(state.ppu_mask, PPU_MASK_SPRITE_LEFT_COLUMN_ENABLE)) {
+		std::memset(sprites, 0, 8);
+	}
+}
+
+bool PPU::ComposeLine(const scanline_state_t& state, const uint8_t* background, const uint8_t* sprites) {
+
+	uint32_t* output = &ppu_buffer[state.scanline * ScreenWidth];
+	uint16_t* indexed = &indexed_buffer[state.scanline * ScreenWidth];
+
+	/* Emphasis bits go above the 6 bit color in the indexed buffer. */
+	const uint16_t emphasis = (state.ppu_mask & 0xE0) << 1;
+
+	if(!BitCheck(state.ppu_mask, PPU_MASK_SHOW_BACKGROUND) && !BitCheck(state.ppu_mask, PPU_MASK_SHOW_SPRITES)) {
+		const uint16_t backdrop = (state.palette[0] & 0x3F) | emphasis;
+		uint16_t changed = 0;
+
+		for(uint16_t x = 0; x < ScreenWidth; x++) {
+			changed |= indexed[x] ^ backdrop;
+			indexed[x] = backdrop;
+			output[x] = palette[backdrop & 0x3F];
+		}
+
+		return changed != 0;
+	}
+
+	/* Pick the winning palette index for each pixel, without branching so the compiler can vectorize it. */
+	uint8_t palette_index[ScreenWidth];
+
+	for(uint16_t x = 0; x < ScreenWidth; x++) {
+		const uint8_t background_pixel = background[x];
+		const uint8_t sprite_pixel     = sprites[x];
+
+		const bool sprite_wins = (sprite_pixel & 0x03) && (!(background_pixel & 0x03) || !(sprite_pixel & 0x40));
+
+		palette_index[x] = sprite_wins ? (sprite_pixel & 0x1F) : background_pixel;
+	}
+
+	/* Resolve palette RAM, then the NES master palette. */
+	uint16_t palette_colors[32];
+
+	for(uint8_t i = 0; i < 32; i++) {
+		palette_colors[i] = (state.palette[PaletteIndex(i)] & (BitCheck(state.ppu_mask, PPU_MASK_GREYSCALE) ? 0x30 : 0x3F)) | emphasis;
+	}
+
+	/* Note whether anything changed since the last frame, so unchanged lines aren't uploaded again.
+	   Compared on the indexed color so emphasis changes count too. */
+	uint16_t changed = 0;
+
+	for(uint16_t x = 0; x < ScreenWidth; x++) {
+		const uint16_t color = palette_colors[palette_index[x]];
+		changed |= indexed[x] ^ color;
+		indexed[x] = color;
+		output[x] = palette[color & 0x3F];
+	}
+
+	return changed != 0;
+}
+
+bool PPU::RasterizeScanline(const scanline_state_t& state) {
+
+	/* Worker threads each need their own scanline buffers. */
+	uint8_t background[ScreenWidth];
+	uint8_t sprites[ScreenWidth];
+
+	RenderBackgroundLine(state, background);
+	RenderSpriteLine(state, sprites);
+
+	return ComposeLine(state, background, sprites);
+}
+
+void PPU::DetectSpriteZeroHit() {
+
+	if(!sprite_zero_in_line) {
+		return;
+	}
+
+	/* Sprite 0 hit, when an opaque sprite 0 pixel overlaps an opaque background pixel. Never at X = 255. Pixel X is output on dot X + 1. */
+	for(uint16_t x = 0; x < ScreenWidth - 1; x++) {
+		if((sprite_line[x] & 0x80) && (sprite_line[x] & 0x03) && (background_line[x] & 0x03)) {
+			sprite_zero_hit_dot = x + 1;
+			break;
+		}
+	}
+}
+
+uint64_t PPU::PredictSpriteZeroHit() {
+
+	/* Nothing found means nothing can happen until the next frame starts drawing, unless the PPU is written to. */
+	sprite_zero_prediction_expires = CycleCountAt(240, 0);
+
+	if(!IsRenderingEnabled() || !BitCheck(ppu_mask, PPU_MASK_SHOW_BACKGROUND) || !BitCheck(ppu_mask, PPU_MASK_SHOW_SPRITES)) {
+		return NoEvent;
+	}
+
+	/* Backgrounds the mapper fetches aren't worth predicting, polling loops just run until the hit is drawn. */
+	if(IsBackgroundFetchActive()) {
+		return NoEvent;
+	}
+
+	/* Already hit this frame, the flag stays set until the pre-render scanline. */
+	if(current_scanline < 240 && BitCheck(ppu_status, PPU_STATUS_SPRITE_0_HIT)) {
+		return NoEvent;
+	}
+
+	/* This scanline has already been produced and has a hit still to come. */
+	if(current_scanline < 240 && sprite_zero_hit_dot > current_cycle) {
+		sprite_zero_prediction_expires = CycleCountAt(current_scanline, sprite_zero_hit_dot);
+		return sprite_zero_prediction_expires;
+	}
+
+	/* Find the next scanline to be produced, and what v will be when it is. */
+	const uint16_t saved_address = ppu_address;
+	uint16_t line = 0;
+
+	if(current_scanline < 240) {
+		line = current_scanline;
+
+		if(current_cycle > 1) {
+			if(current_cycle <= 256) { IncrementScrollY(); }
+			if(current_cycle <= 257) { CopyScrollX(); }
+			line++;
+		}
+	} else if(current_scanline < 261 || current_cycle <= 280) {
+		/* The pre-render scanline copies all of t back into v. */
+		ppu_address = temp_address;
+	}
+
+	const bool tall_sprites = BitCheck(ppu_ctrl, PPU_CTRL_SPRITE_HEIGHT);
+	const uint8_t sprite_height = tall_sprites ? 16 : 8;
+
+	const uint16_t background_table = BitCheck(ppu_ctrl, PPU_CTRL_BACKG_TILE_SELECT) ? 0x1000 : 0x0000;
+	const uint8_t first_x = (BitCheck(ppu_mask, PPU_MASK_BACKGROUND_LEFT_COLUMN_ENABLE) && BitCheck(ppu_mask, PPU_MASK_SPRITE_LEFT_COLUMN_ENABLE)) ? 0 : 8;
+
+	uint64_t hit_cycle = NoEvent;
+
+	for(; line < 240 && hit_cycle == NoEvent; line++) {
+
+		/* Sprites already picked by evaluation on the previous scanline come from secondary OAM. */
+		const bool evaluated = (current_scanline < 240) && ((line == current_scanline && current_cycle <= 1) || (line == current_scanline + 1 && current_cycle > 256));
+		const uint8_t* sprite = evaluated ? &second_attribute_memory[0] : &object_attribute_memory[0];
+
+		uint8_t row = (line - 1) - sprite[0];
+
+		if(line == 0 || row >= sprite_height || (evaluated && !sprite_zero_in_line)) {
+			IncrementScrollY();
+			CopyScrollX();
+			continue;
+		}
+
+		if(BitCheck(sprite[2], 7)) {
+			row = (sprite_height - 1) - row;
+		}
+
+		uint16_t pattern_address;
+
+		if(tall_sprites) {
+			pattern_address = ((sprite[1] & 0x01) << 12) + ((sprite[1] & 0xFE) * 16) + ((row & 0x08) << 1) + (row & 0x07);
+		} else {
+			pattern_address = (BitCheck(ppu_ctrl, PPU_CTRL_SPRITE_TILE_SELECT) ? 0x1000 : 0x0000) + (sprite[1] * 16) + row;
+		}
+
+		const uint8_t sprite_low  = PeekMemory(pattern_address);
+		const uint8_t sprite_high = PeekMemory(pattern_address + 8);
+
+		for(uint8_t bit = 0; bit < 8; bit++) {
+
+			const uint16_t x = sprite[3] + bit;
+
+			if(x >= ScreenWidth - 1) {
+				break;
+			}
+
+			const uint8_t sprite_shift = BitCheck(sprite[2], 6) ? bit : (7 - bit);
+
+			if(x < first_x || !(((sprite_low | sprite_high) >> sprite_shift) & 0x01)) {
+				continue;
+			}
+
+			/* Fetch only the background tile under this pixel. */
+			const uint16_t position = fine_x_scroll + x;
+			uint16_t coarse_x = (ppu_address & 0x001F) + (position >> 3);
+			uint16_t nametable = ppu_address & 0x0C00;
+
+			if(coarse_x >= 32) {
+				coarse_x -= 32;
+				nametable ^= 0x0400;
+			}
+
+			const uint8_t tile_index = PeekMemory(0x2000 | nametable | (ppu_address & 0x03E0) | coarse_x);
+			const uint16_t background_address = background_table + (tile_index * 16) + ((ppu_address >> 12) & 0x07);
+			const uint8_t background = PeekMemory(background_address) | PeekMemory(background_address + 8);
+
+			if((background >> (7 - (position & 0x07))) & 0x01) {
+				hit_cycle = CycleCountAt(line, x + 1);
+				break;
+			}
+		}
+
+		IncrementScrollY();
+		CopyScrollX();
+	}
+
+	ppu_address = saved_address;
+
+	if(hit_cycle != NoEvent) {
+		sprite_zero_prediction_expires = hit_cycle;
+	}
+
+	return hit_cycle;
+}
+
+void PPU::PredictA12Rises() {
+
+	const bool background_high = BitCheck(ppu_ctrl, PPU_CTRL_BACKG_TILE_SELECT);
+	const bool sprites_high = BitCheck(ppu_ctrl, PPU_CTRL_SPRITE_TILE_SELECT);
+	const bool tall_sprites = BitCheck(ppu_ctrl, PPU_CTRL_SPRITE_HEIGHT);
+
+	for(uint16_t scanline = 0; scanline < ScanlinesPerFrame; scanline++) {
+
+		if(scanline >= 240 && scanline != 261) {
+			a12_line_rises[scanline] = 0;
+			continue;
+		}
+
+		/* Pattern table half each of the 8 sprite fetches after dot 256 reads, for the sprites evaluated on this scanline. Empty
+		   slots fetch tile 0xFF, which for 8x16 sprites is in the 0x1000 table. */
+		bool slot_high[8];
+		std::fill(std::begin(slot_high), std::end(slot_high), tall_sprites || sprites_high);
+
+		if(tall_sprites && scanline != 261) {
+			uint8_t slot = 0;
+
+			for(uint8_t n = 0; n < 64 && slot < 8; n++) {
+				const uint16_t row = scanline - object_attribute_memory[n * 4];
+
+				if(row < 16) {
+					slot_high[slot++] = BitCheck(object_attribute_memory[(n * 4) + 1], 0);
+				}
+			}
+		}
+
+		/* Walk the fetches 4 dots at a time, where nametable and attribute fetches (A12 low) take turns with pattern fetches.
+		   The MMC3 only counts a rise once A12 has been low for a few CPU cycles, taken as 3 of these steps, so pattern fetches
+		   with only a nametable fetch between them count once. */
+		uint32_t rises = 0;
+		uint8_t low_steps = background_high ? 1 : 3;
+
+		for(uint8_t step = 0; step < 85; step++) {
+			bool high = false;
+
+			if(step & 0x01) {
+				high = (step < 64 || step >= 80) ? background_high : slot_high[(step - 64) / 2];
+			}
+
+			if(!high) {
+				low_steps = std::min<uint8_t>(low_steps + 1, 3);
+				continue;
+			}
+
+			if(low_steps >= 3 && step >= 64) {
+				rises |= 1u << (step - 64);
+			}
+
+			low_steps = 0;
+		}
+
+		a12_line_rises[scanline] = rises;
+	}
+
+	a12_rises_valid = true;
+}
+
+void PPU::IncrementScrollX() {
+
+	/* Wrap coarse X from 31 to 0 and switch horizontal nametable. */
+	if((ppu_address & 0x001F) == 31) {
+		ppu_address &= ~0x001F;
+		ppu_address ^= 0x0400;
+	} else {
+		ppu_address++;
+	}
+}
+
+void PPU::IncrementScrollY() {
+
+	/* Fine Y is incremented first, overflowing into coarse Y. */
+	if((ppu_address & 0x7000) != 0x7000) {
+		ppu_address += 0x1000;
+		return;
+	}
+
+	ppu_address &= ~0x7000;
+
+	uint8_t coarse_y = (ppu_address & 0x03E0) >> 5;
+
+	if(coarse_y == 29) {
+		/* Row 29 is the last row of tiles, switch vertical nametable. */
+		coarse_y = 0;
+		ppu_address ^= 0x0800;
+	} else if(coarse_y == 31) {
+		/* Coarse Y set out of bounds wraps without switching nametable. */
+		coarse_y = 0;
+	} else {
+		coarse_y++;
+	}
+
+	ppu_address = (ppu_address & ~0x03E0) | (coarse_y << 5);
+}
+
+void PPU::CopyScrollX() {
+	/* Coarse X and horizontal nametable. */
+	ppu_address = (ppu_address & ~0x041F) | (temp_address & 0x041F);
+}
+
+void PPU::CopyScrollY() {
+	/* Fine Y, coarse Y and vertical nametable. */
+	ppu_address = (ppu_address & ~0x7BE0) | (temp_address & 0x7BE0);
+}
@@ -0,0 +1,107 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+#include "ROMDatabase.hpp"
+#include "ROMDatabaseData.hpp"
+
+/* Each record is 16 little endian bytes:
+     0-3   CRC32 of PRG and CHR ROM
+     4-5   PRG ROM size in 16kB units
+     6-7   CHR ROM size in 8kB units
+     8-9   mapper number (bits 0-11) and submapper (bits 12-15)
+     10    mirroring (bits 0-1), battery (bit 2), region (bits 4-5)
+     11    PRG RAM (bits 0-3) and PRG NVRAM (bits 4-7) sizes
+     12    CHR RAM (bits 0-3) and CHR NVRAM (bits 4-7) sizes
+     13-15 unused
+   RAM sizes are shift counts like in NES 2.0 headers, 64 << n bytes or none for 0. */
+static constexpr size_t RecordSize = 16;
+
+static_assert(rom_database_blob.size() % RecordSize == 0, "ROM database blob isn't a whole number of records.");
+
+static uint32_t ReadRecord(size_t record, size_t offset, size_t bytes) {
+
+	uint32_t value = 0;
+
+	for(size_t i = 0; i < bytes; i++) {
+		value |= rom_database_blob[record * RecordSize + offset + i] << (i * 8);
+	}
+
+	return value;
+}
+
+static uint32_t RAMSize(uint8_t shift) {
+	return shift == 0 ? 0 : 64 << shift;
+}
+
+bool ROMDatabase::Find(uint32_t crc32, size_t rom_size, rom_database_entry_t* entry) {
+
+	const size_t count = GetEntryCount();
+
+	/* First record with a CRC32 not below the one wanted. Dumps sharing a CRC32 sit next to each other. */
+	size_t low = 0;
+	size_t high = count;
+
+	while(low < high) {
+		const size_t middle = low + (high - low) / 2;
+
+		if(ReadRecord(middle, 0, 4) < crc32) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	for(size_t record = low; record < count && ReadRecord(record, 0, 4) == crc32; record++) {
+		const uint32_t prg_rom_size = ReadRecord(record, 4, 2) * 0x4000;
+		const uint32_t chr_rom_size = ReadRecord(record, 6, 2) * 0x2000;
+
+		if(prg_rom_size + chr_rom_size != rom_size) {
+			continue;
+		}
+
+		const uint16_t mapper = ReadRecord(record, 8, 2);
+		const uint8_t flags = ReadRecord(record, 10, 1);
+		const uint8_t prg_ram = ReadRecord(record, 11, 1);
+		const uint8_t chr_ram = ReadRecord(record, 12, 1);
+
+		entry->crc32          = crc32;
+		entry->prg_rom_size   = prg_rom_size;
+		entry->chr_rom_size   = chr_rom_size;
+		entry->mapper_number  = mapper & 0xFFF;
+		entry->mapper_variant = mapper >> 12;
+		entry->prg_ram_size   = RAMSize(prg_ram & 0xF);
+		entry->prg_nvram_size = RAMSize(prg_ram >> 4);
+		entry->chr_ram_size   = RAMSize(chr_ram & 0xF);
+		entry->chr_nvram_size = RAMSize(chr_ram >> 4);
+		entry->mirroring      = flags & 0x3;
+		entry->battery        = (flags & 0x4) != 0;
+		entry->region         = (flags >> 4) & 0x3;
+		return true;
+	}
+
+	return false;
+}
+
+size_t ROMDatabase::GetEntryCount() {
+	return rom_database_blob.size() / RecordSize;
+}
\ No newline at end of file
@@ -0,0 +1,74 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __ROM_DATABASE_HPP__
+#define __ROM_DATABASE_HPP__
+
+#include <cstddef>
+#include <cstdint>
+
+/* What the database knows about a ROM, for correcting its iNES 1.0 header. Sizes are in bytes. */
+typedef struct rom_database_entry {
+	uint32_t crc32;
+
+	uint32_t prg_rom_size;
+	uint32_t chr_rom_size;
+
+	uint16_t mapper_number;
+	uint8_t  mapper_variant;
+
+	uint32_t prg_ram_size;
+	uint32_t prg_nvram_size;
+	uint32_t chr_ram_size;
+	uint32_t chr_nvram_size;
+
+	uint8_t  mirroring;
+	uint8_t  region;
+	bool     battery;
+} rom_database_entry_t;
+
+/* Known ROMs, keyed by the CRC32 of their PRG and CHR ROM (everything after the header and trainer). The database is a
+   compact blob of fixed size records sorted by CRC32, generated from the NES 2.0 XML database by MakeROMDatabase.py, so
+   a lookup is a binary search with nothing to load or parse first. */
+class ROMDatabase {
+
+	public:
+		typedef enum Mirroring {
+			MIRRORING_HORIZONTAL,
+			MIRRORING_VERTICAL,
+			MIRRORING_FOUR_SCREEN,
+			MIRRORING_MAPPER      /* Mapper controlled, or something the header can't describe. */
+		} mirroring_t;
+
+		typedef enum Region {
+			REGION_NTSC,
+			REGION_PAL,
+			REGION_MULTIPLE,
+			REGION_DENDY
+		} region_t;
+
+		/* Find the entry for a ROM. The size has to match as well, so a CRC32 collision between different sized ROMs can't
+		   give the wrong entry. */
+		static bool Find(uint32_t crc32, size_t rom_size, rom_database_entry_t* entry);
+
+		static size_t GetEntryCount();
+};
+
+#endif /* __ROM_DATABASE_HPP__ */
\ No newline at end of file
@@ -0,0 +1,32 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Generated by MakeROMDatabase.py, don't edit by hand. 0 ROMs. */
+
+#ifndef __ROM_DATABASE_DATA_HPP__
+#define __ROM_DATABASE_DATA_HPP__
+
+#include <array>
+#include <cstdint>
+
+inline constexpr std::array<uint8_t, 0> rom_database_blob = {
+};
+
+#endif /* __ROM_DATABASE_DATA_HPP__ */
\ No newline at end of file
@@ -34,4 +34,10 @@ typedef struct unif_header {
 	uint32_t padding6;
 } unif_header_t;
 
+/* Everything after the header is chunks, a four character ID and the little endian length of the data following it. */
+typedef struct unif_chunk_header {
+	char     id[4];
+	uint32_t length;
+} unif_chunk_header_t;
+
 #endif /* __UNIF_HEADER_HPP__ */
\ No newline at end of file
@@ -37,14 +37,17 @@ typedef struct iNES_header {
 	uint8_t  flags4;         // Byte 10
 
 	/* iNES 2.0 */
-	uint8_t  mapper_variant;
-	uint8_t  rom_size_bits_upper;
-	uint8_t  ram_size;
-	uint8_t  vram_size;
-	uint8_t  tv_system;
-	uint8_t  vs_system;
-	uint8_t  misc_roms;
-	uint8_t  reserved;
+	uint8_t  mapper_variant;      // Byte 8 upper nibble (submapper)
+	uint8_t  rom_size_bits_upper; // Byte 9
+	uint8_t  ram_size;            // Byte 10
+	uint8_t  vram_size;           // Byte 11
+	uint8_t  tv_system;           // Byte 12 (CPU/PPU timing)
+	uint8_t  vs_system;           // Byte 13
+	uint8_t  misc_roms;           // Byte 14
+	uint8_t  expansion_device;    // Byte 15
+
+	/* Full mapper number from bytes 6-8, 12 bits for iNES 2.0 and 8 bits otherwise. */
+	uint16_t mapper_number;
 
 	bool is_iNES2;
 	bool has_trainer;
@@ -0,0 +1,291 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "BitOps.hpp"
+#include "PPUViewer.hpp"
+
+/* Canvas areas, see the layout in PPUViewer.hpp. */
+static const int NametablesX { 0 };
+static const int NametablesY { 0 };
+static const int PatternTablesX { 512 };
+static const int PatternTablesY { 0 };
+static const int PaletteX { 512 };
+static const int PaletteY { 136 };
+static const int OAMX { 512 };
+static const int OAMY { 176 };
+
+static const uint32_t BackgroundColor { 0x202020 };
+static const uint32_t ViewportColor { 0xFFFFFF };
+
+PPUViewer::PPUViewer(const uint32_t* master_palette) : master_palette(master_palette) {
+
+	canvas.assign(CanvasWidth * CanvasHeight, BackgroundColor);
+
+	for(uint8_t nametable = 0; nametable < 4; nametable++) {
+		std::fill(drawn_cells[nametable], drawn_cells[nametable] + 960, 0xFFFF);
+	}
+
+	draw_thread = std::thread(&PPUViewer::DrawLoop, this);
+}
+
+PPUViewer::~PPUViewer() {
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	snapshot_ready.notify_one();
+	draw_thread.join();
+}
+
+void PPUViewer::Submit(const ppu_snapshot_t& snapshot) {
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		pending = snapshot;
+		pending_dirty_tiles |= snapshot.dirty_tiles;
+		has_pending = true;
+	}
+
+	snapshot_ready.notify_one();
+}
+
+bool PPUViewer::GetCanvas(std::vector<uint32_t>& pixels) {
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if(!has_finished) {
+		return false;
+	}
+
+	/* The caller's old buffer becomes the next one to finish into. */
+	pixels.swap(finished);
+	has_finished = false;
+
+	return true;
+}
+
+uint64_t PPUViewer::GetSnapshotsDrawn() {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return snapshots_drawn;
+}
+
+void PPUViewer::DrawLoop() {
+
+	ppu_snapshot_t snapshot;
+
+	while(true) {
+		std::unique_lock<std::mutex> lock(mutex);
+		snapshot_ready.wait(lock, [this] { return stopping || has_pending; });
+
+		if(stopping) {
+			return;
+		}
+
+		snapshot = pending;
+		snapshot.dirty_tiles = pending_dirty_tiles;
+		pending_dirty_tiles.reset();
+		has_pending = false;
+
+		lock.unlock();
+
+		const bool palette_changed = first_draw || std::memcmp(drawn_palette, snapshot.palette, sizeof(drawn_palette)) != 0;
+
+		DecodeTiles(snapshot);
+		DrawNametables(snapshot, palette_changed);
+		DrawPatternTables(snapshot, palette_changed);
+		DrawPalette(snapshot);
+		DrawOAM(snapshot);
+
+		std::memcpy(drawn_palette, snapshot.palette, sizeof(drawn_palette));
+		first_draw = false;
+
+		lock.lock();
+
+		finished = canvas;
+		DrawViewport(snapshot, finished);
+		has_finished = true;
+		snapshots_drawn++;
+	}
+}
+
+void PPUViewer::DecodeTiles(const ppu_snapshot_t& snapshot) {
+
+	for(uint16_t tile = 0; tile < 512; tile++) {
+		if(!first_draw && !snapshot.dirty_tiles.test(tile)) {
+			continue;
+		}
+
+		for(uint8_t row = 0; row < 8; row++) {
+			const uint8_t plane_low = snapshot.chr[tile * 16 + row];
+			const uint8_t plane_high = snapshot.chr[tile * 16 + 8 + row];
+
+			for(uint8_t column = 0; column < 8; column++) {
+				tile_pixels[tile][row * 8 + column] = ((plane_low >> (7 - column)) & 0x01) | (((plane_high >> (7 - column)) & 0x01) << 1);
+			}
+		}
+	}
+}
+
+void PPUViewer::DrawTile(uint16_t tile, const uint32_t* colors, int x, int y, int scale, bool flip_x, bool flip_y, bool transparent) {
+
+	for(uint8_t row = 0; row < 8; row++) {
+		for(uint8_t column = 0; column < 8; column++) {
+			const uint8_t pixel = tile_pixels[tile][(flip_y ? 7 - row : row) * 8 + (flip_x ? 7 - column : column)];
+
+			if(pixel == 0 && transparent) {
+				continue;
+			}
+
+			for(int scale_y = 0; scale_y < scale; scale_y++) {
+				std::fill_n(&canvas[(y + row * scale + scale_y) * CanvasWidth + x + column * scale], scale, colors[pixel]);
+			}
+		}
+	}
+}
+
+void PPUViewer::DrawNametables(const ppu_snapshot_t& snapshot, bool palette_changed) {
+
+	const uint16_t table = BitCheck(snapshot.ppu_ctrl, PPU_CTRL_BACKG_TILE_SELECT) ? 256 : 0;
+
+	for(uint8_t nametable = 0; nametable < 4; nametable++) {
+		const uint8_t* memory = &snapshot.nametables[nametable * 0x400];
+
+		for(uint16_t cell = 0; cell < 960; cell++) {
+			const uint8_t row = cell / 32;
+			const uint8_t column = cell % 32;
+
+			/* Each attribute byte covers 4x4 cells, 2 bits per 2x2 of them. */
+			const uint8_t attribute_shift = ((row & 0x02) << 1) | (column & 0x02);
+			const uint8_t attribute = (memory[0x3C0 + (row / 4) * 8 + (column / 4)] >> attribute_shift) & 0x03;
+
+			const uint16_t tile = table + memory[cell];
+			const uint16_t drawn = memory[cell] | (attribute << 8) | ((table ? 1 : 0) << 10);
+
+			if(drawn == drawn_cells[nametable][cell] && !palette_changed && !snapshot.dirty_tiles.test(tile)) {
+				continue;
+			}
+
+			const uint32_t colors[4] = { Color(snapshot, 0), Color(snapshot, attribute * 4 + 1), Color(snapshot, attribute * 4 + 2), Color(snapshot, attribute * 4 + 3) };
+
+			DrawTile(tile, colors, NametablesX + (nametable & 0x01) * 256 + column * 8, NametablesY + (nametable >> 1) * 240 + row * 8, 1, false, false, false);
+
+			drawn_cells[nametable][cell] = drawn;
+		}
+	}
+}
+
+void PPUViewer::DrawPatternTables(const ppu_snapshot_t& snapshot, bool palette_changed) {
+
+	const uint32_t colors[4] = { Color(snapshot, 0), Color(snapshot, 1), Color(snapshot, 2), Color(snapshot, 3) };
+
+	for(uint16_t tile = 0; tile < 512; tile++) {
+		if(!palette_changed && !snapshot.dirty_tiles.test(tile)) {
+			continue;
+		}
+
+		DrawTile(tile, colors, PatternTablesX + (tile / 256) * 128 + (tile % 16) * 8, PatternTablesY + ((tile % 256) / 16) * 8, 1, false, false, false);
+	}
+}
+
+void PPUViewer::DrawPalette(const ppu_snapshot_t& snapshot) {
+
+	for(uint8_t index = 0; index < 32; index++) {
+		const int x = PaletteX + (index % 16) * 16;
+		const int y = PaletteY + (index / 16) * 16;
+
+		for(int row = 0; row < 16; row++) {
+			std::fill_n(&canvas[(y + row) * CanvasWidth + x], 16, Color(snapshot, index));
+		}
+	}
+}
+
+void PPUViewer::DrawOAM(const ppu_snapshot_t& snapshot) {
+
+	const bool tall_sprites = BitCheck(snapshot.ppu_ctrl, PPU_CTRL_SPRITE_HEIGHT);
+	const uint16_t table = BitCheck(snapshot.ppu_ctrl, PPU_CTRL_SPRITE_TILE_SELECT) ? 256 : 0;
+
+	for(uint8_t sprite = 0; sprite < 64; sprite++) {
+		const uint8_t* entry = &snapshot.oam[sprite * 4];
+
+		const int cell_x = OAMX + (sprite % 8) * 32;
+		const int cell_y = OAMY + (sprite / 8) * 32;
+
+		for(int row = 0; row < 32; row++) {
+			std::fill_n(&canvas[(cell_y + row) * CanvasWidth + cell_x], 32, BackgroundColor);
+		}
+
+		const uint8_t palette = 4 + (entry[2] & 0x03);
+		const uint32_t colors[4] = { BackgroundColor, Color(snapshot, palette * 4 + 1), Color(snapshot, palette * 4 + 2), Color(snapshot, palette * 4 + 3) };
+
+		const bool flip_x = BitCheck(entry[2], 6);
+		const bool flip_y = BitCheck(entry[2], 7);
+
+		if(tall_sprites) {
+			/* 8x16 sprites take their pattern table from bit 0 of the tile number, and flip as one. */
+			const uint16_t top = ((entry[1] & 0x01) ? 256 : 0) + (entry[1] & 0xFE);
+
+			DrawTile(flip_y ? top + 1 : top, colors, cell_x + 8, cell_y, 2, flip_x, flip_y, true);
+			DrawTile(flip_y ? top : top + 1, colors, cell_x + 8, cell_y + 16, 2, flip_x, flip_y, true);
+		} else {
+			DrawTile(table + entry[1], colors, cell_x + 8, cell_y + 8, 2, flip_x, flip_y, true);
+		}
+	}
+}
+
+void PPUViewer::DrawViewport(const ppu_snapshot_t& snapshot, std::vector<uint32_t>& pixels) {
+
+	/* Scroll as nametable coordinates, 0 - 511 across and 0 - 479 down. */
+	int scroll_x, scroll_y;
+
+	if(snapshot.scanline < PPU::ScreenHeight && (snapshot.ppu_mask & 0x18)) {
+		/* Mid frame v holds this line's position, two tiles ahead for the tiles fetched at the end of the last line. */
+		const uint16_t v = snapshot.ppu_address;
+		scroll_x = ((v >> 10) & 0x01) * 256 + (v & 0x1F) * 8 + snapshot.fine_x_scroll - 16;
+		scroll_y = ((v >> 11) & 0x01) * 240 + ((v >> 5) & 0x1F) * 8 + ((v >> 12) & 0x07) - snapshot.scanline;
+	} else {
+		/* Otherwise t holds what the next frame starts from. */
+		const uint16_t t = snapshot.temp_address;
+		scroll_x = ((t >> 10) & 0x01) * 256 + (t & 0x1F) * 8 + snapshot.fine_x_scroll;
+		scroll_y = ((t >> 11) & 0x01) * 240 + ((t >> 5) & 0x1F) * 8 + ((t >> 12) & 0x07);
+	}
+
+	auto plot = [&](int x, int y) {
+		x = ((x % 512) + 512) % 512;
+		y = ((y % 480) + 480) % 480;
+		pixels[(NametablesY + y) * CanvasWidth + NametablesX + x] = ViewportColor;
+	};
+
+	for(int x = 0; x < PPU::ScreenWidth; x++) {
+		plot(scroll_x + x, scroll_y);
+		plot(scroll_x + x, scroll_y + PPU::ScreenHeight - 1);
+	}
+
+	for(int y = 0; y < PPU::ScreenHeight; y++) {
+		plot(scroll_x, scroll_y + y);
+		plot(scroll_x + PPU::ScreenWidth - 1, scroll_y + y);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __PPU_VIEWER_HPP__
+#define __PPU_VIEWER_HPP__
+
+#include <bitset>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "NES/PPU.hpp"
+
+/**
+ * Debug views of PPU memory: all four nametables with the scroll viewport, both pattern tables, the palettes and OAM.
+ *
+ * Views are drawn from PPU snapshots (see PPU::SetDebugSnapshotScanline) on a thread of their own, so the emulator only pays
+ * for copying the snapshot. Drawing is incremental: tiles are decoded once and again only when the snapshot marks them dirty,
+ * and nametable cells are redrawn only when their tile, attribute or pattern data changed.
+ *
+ * Canvas layout, CanvasWidth x CanvasHeight:
+ *   0,0     Nametables 0 - 3 (512x480), with the visible area outlined.
+ *   512,0   Pattern tables 0 and 1 (256x128), in background palette 0.
+ *   512,136 Palette RAM (256x32), background palettes on the first row and sprite palettes on the second.
+ *   512,176 OAM (256x256), the 64 sprites at double size, 8 to a row.
+ */
+class PPUViewer {
+
+	public:
+		PPUViewer(const uint32_t* master_palette);
+		~PPUViewer();
+
+		/* Queue a snapshot to be drawn. If the last one hasn't been drawn yet it is replaced, keeping its dirty tiles. */
+		void Submit(const ppu_snapshot_t& snapshot);
+
+		/* Swap the latest finished canvas into pixels. Returns false, leaving pixels alone, if nothing new was drawn since the last call. */
+		bool GetCanvas(std::vector<uint32_t>& pixels);
+
+		/* Snapshots drawn so far. */
+		uint64_t GetSnapshotsDrawn();
+
+		static const uint16_t CanvasWidth { 768 };
+		static const uint16_t CanvasHeight { 480 };
+
+	private:
+		void DrawLoop();
+
+		/* Decode dirty tiles to 2 bit pixels, and draw each part of the canvas. */
+		void DecodeTiles(const ppu_snapshot_t& snapshot);
+		void DrawNametables(const ppu_snapshot_t& snapshot, bool palette_changed);
+		void DrawPatternTables(const ppu_snapshot_t& snapshot, bool palette_changed);
+		void DrawPalette(const ppu_snapshot_t& snapshot);
+		void DrawOAM(const ppu_snapshot_t& snapshot);
+
+		/* Outline the part of the nametables on screen. Drawn on the finished copy, as the canvas is kept between snapshots. */
+		void DrawViewport(const ppu_snapshot_t& snapshot, std::vector<uint32_t>& pixels);
+
+		/* Draw tile with a palette (4 master palette colors), at scale, with pixel 0 transparent or in the first color. */
+		void DrawTile(uint16_t tile, const uint32_t* colors, int x, int y, int scale, bool flip_x, bool flip_y, bool transparent);
+
+		/* Master palette color of a palette RAM entry, with 0x10/14/18/1C mirroring 0x00/04/08/0C. */
+		uint32_t Color(const ppu_snapshot_t& snapshot, uint8_t palette_index) {
+			palette_index &= 0x1F;
+			if((palette_index & 0x13) == 0x10) {
+				palette_index &= 0x0F;
+			}
+			return master_palette[snapshot.palette[palette_index] & 0x3F];
+		};
+
+		const uint32_t* master_palette;
+
+		std::thread draw_thread;
+		std::mutex mutex;
+		std::condition_variable snapshot_ready;
+		bool stopping { false };
+
+		/* Waiting snapshot, and the tiles dirty in it and any it replaced. */
+		ppu_snapshot_t pending;
+		std::bitset<512> pending_dirty_tiles;
+		bool has_pending { false };
+
+		/* Finished canvas handed out by GetCanvas. */
+		std::vector<uint32_t> finished;
+		bool has_finished { false };
+		uint64_t snapshots_drawn { 0 };
+
+		/* Owned by the draw thread. ---------------------------------------------------------- */
+
+		std::vector<uint32_t> canvas;
+
+		/* Every tile decoded to 2 bit pixels. */
+		uint8_t tile_pixels[512][64] { { 0 } };
+
+		/* What each nametable cell was last drawn with (tile, attribute and pattern table), 0xFFFF when never drawn. */
+		uint16_t drawn_cells[4][960];
+
+		/* Palette RAM the tables were last drawn with. */
+		uint8_t drawn_palette[0x20] { 0 };
+		bool first_draw { true };
+};
+
+#endif /* __PPU_VIEWER_HPP__ */
\ No newline at end of file
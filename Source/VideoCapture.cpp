@@ -0,0 +1,290 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <csignal>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VIDEO_CAPTURE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "VideoCapture.hpp"
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#endif
+
+/* BT.601 limited range coefficients, scaled by 256, in the byte order of ARGB8888 in memory (blue, green, red). */
+static const int YWeights[3] { 25, 129, 66 };
+static const int UWeights[3] { 112, -74, -38 };
+static const int VWeights[3] { -18, -94, 112 };
+
+VideoCapture::VideoCapture() {
+
+}
+
+VideoCapture::~VideoCapture() {
+
+	Close();
+}
+
+bool VideoCapture::Open(const std::string& output, uint16_t width, uint16_t height) {
+
+	this->width = width;
+	this->height = height;
+
+	if(!output.empty() && output[0] == '|') {
+#ifdef _WIN32
+		file = popen(output.substr(1).c_str(), "wb");
+#else
+		file = popen(output.substr(1).c_str(), "w");
+#endif
+		is_pipe = true;
+	} else {
+		file = std::fopen(output.c_str(), "wb");
+	}
+
+	if(file == nullptr) {
+		std::cout << "ERROR: Couldn't open \"" << output << "\" for video capture.\n";
+		return false;
+	}
+
+#ifndef _WIN32
+	/* A reader going away (ffmpeg exiting, say) should end the capture, not the emulator. */
+	std::signal(SIGPIPE, SIG_IGN);
+#endif
+
+	/* NES pixels are 8:7, and NTSC runs at 39375000 / 655171 (about 60.0988) frames a second. */
+	std::fprintf(file, "YUV4MPEG2 W%u H%u F39375000:655171 Ip A8:7 C420jpeg XCOLORRANGE=LIMITED\n", width, height);
+
+	queue.assign(QueueCapacity, std::vector<uint8_t>(width * height + (width / 2) * (height / 2) * 2));
+	queue_head = 0;
+	queue_count = 0;
+	closing = false;
+
+	writer_thread = std::thread(&VideoCapture::WriterLoop, this);
+
+	return true;
+}
+
+void VideoCapture::Close() {
+
+	if(file == nullptr) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		closing = true;
+	}
+
+	frame_ready.notify_one();
+	writer_thread.join();
+
+	if(is_pipe) {
+		pclose(file);
+	} else {
+		std::fclose(file);
+	}
+
+	file = nullptr;
+}
+
+void VideoCapture::SubmitFrame(const uint32_t* pixels) {
+
+	if(file == nullptr) {
+		return;
+	}
+
+	size_t slot;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(queue_count == QueueCapacity || write_failed) {
+			frames_dropped++;
+			return;
+		}
+
+		slot = (queue_head + queue_count) % QueueCapacity;
+	}
+
+	/* The writer never touches slots past the end of the queue, so this can be filled without holding the lock. */
+	ConvertFrame(pixels, queue[slot].data());
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue_count++;
+		max_queue_depth = std::max(max_queue_depth, queue_count);
+	}
+
+	frame_ready.notify_one();
+}
+
+size_t VideoCapture::GetQueueDepth() {
+
+	std::lock_guard<std::mutex> lock(mutex);
+	return queue_count;
+}
+
+void VideoCapture::WriterLoop() {
+
+	while(true) {
+		std::unique_lock<std::mutex> lock(mutex);
+		frame_ready.wait(lock, [this] { return closing || queue_count > 0; });
+
+		/* Only finish once everything queued is written. */
+		if(queue_count == 0) {
+			return;
+		}
+
+		const std::vector<uint8_t>& frame = queue[queue_head];
+		lock.unlock();
+
+		if(!write_failed) {
+			if(std::fputs("FRAME\n", file) < 0 || std::fwrite(frame.data(), 1, frame.size(), file) != frame.size()) {
+				std::cout << "ERROR: Video capture output closed, dropping the rest of the frames.\n";
+				write_failed = true;
+			} else {
+				frames_written++;
+			}
+		}
+
+		lock.lock();
+		queue_head = (queue_head + 1) % QueueCapacity;
+		queue_count--;
+
+		if(write_failed) {
+			frames_dropped++;
+		}
+	}
+}
+
+#ifdef VIDEO_CAPTURE_SSE2
+/* Weighted sum of the blue, green and red of 4 pixels, one 32 bit result per pixel. weights holds 16 bit blue, green, red, 0 twice. */
+static inline __m128i WeightedSum(__m128i pixels, __m128i weights) {
+
+	const __m128i zero = _mm_setzero_si128();
+
+	/* madd leaves blue + green and red + alpha (weighted 0) side by side for each pixel. */
+	const __m128 low  = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), weights));
+	const __m128 high = _mm_castsi128_ps(_mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), weights));
+
+	return _mm_add_epi32(_mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0))), _mm_castps_si128(_mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1))));
+}
+
+/* (sum + 128) / 256 + offset, for 8 sums, packed into 8 bytes. */
+static inline __m128i ScaleAndPack(__m128i sum_a, __m128i sum_b, int offset) {
+
+	const __m128i round = _mm_set1_epi32(128);
+	const __m128i add = _mm_set1_epi32(offset);
+
+	sum_a = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(sum_a, round), 8), add);
+	sum_b = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(sum_b, round), 8), add);
+
+	return _mm_packus_epi16(_mm_packs_epi32(sum_a, sum_b), _mm_setzero_si128());
+}
+
+/* Average each 2x2 block of 8 pixels from two rows, into 4 pixels. */
+static inline __m128i Average2x2(const uint32_t* top, const uint32_t* bottom) {
+
+	const __m128 left  = _mm_castsi128_ps(_mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom))));
+	const __m128 right = _mm_castsi128_ps(_mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top + 4)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + 4))));
+
+	return _mm_avg_epu8(_mm_castps_si128(_mm_shuffle_ps(left, right, _MM_SHUFFLE(2, 0, 2, 0))), _mm_castps_si128(_mm_shuffle_ps(left, right, _MM_SHUFFLE(3, 1, 3, 1))));
+}
+#endif
+
+/* Scalar versions, for the ends of rows and machines without SSE2. Rounding matches the SSE2 code. */
+static inline uint8_t WeightedPixel(uint32_t pixel, const int* weights, int offset) {
+
+	const int sum = weights[0] * (pixel & 0xFF) + weights[1] * ((pixel >> 8) & 0xFF) + weights[2] * ((pixel >> 16) & 0xFF);
+	return static_cast<uint8_t>(std::min(std::max(((sum + 128) >> 8) + offset, 0), 255));
+}
+
+static inline uint32_t AveragePixels(uint32_t a, uint32_t b) {
+
+	uint32_t average = 0;
+
+	for(uint8_t shift = 0; shift < 24; shift += 8) {
+		average |= ((((a >> shift) & 0xFF) + ((b >> shift) & 0xFF) + 1) >> 1) << shift;
+	}
+
+	return average;
+}
+
+void VideoCapture::ConvertFrame(const uint32_t* pixels, uint8_t* yuv) {
+
+	uint8_t* luma = yuv;
+	uint8_t* chroma_u = yuv + width * height;
+	uint8_t* chroma_v = chroma_u + (width / 2) * (height / 2);
+
+	for(uint16_t y = 0; y < height; y++) {
+		const uint32_t* row = &pixels[y * width];
+		uint16_t x = 0;
+
+#ifdef VIDEO_CAPTURE_SSE2
+		const __m128i weights = _mm_setr_epi16(YWeights[0], YWeights[1], YWeights[2], 0, YWeights[0], YWeights[1], YWeights[2], 0);
+
+		for(; x + 8 <= width; x += 8) {
+			const __m128i sum_a = WeightedSum(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&row[x])), weights);
+			const __m128i sum_b = WeightedSum(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&row[x + 4])), weights);
+
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(&luma[y * width + x]), ScaleAndPack(sum_a, sum_b, 16));
+		}
+#endif
+
+		for(; x < width; x++) {
+			luma[y * width + x] = WeightedPixel(row[x], YWeights, 16);
+		}
+	}
+
+	/* Chroma is one sample for each 2x2 block, centred between them. */
+	const uint16_t chroma_width = width / 2;
+
+	for(uint16_t y = 0; y < height / 2; y++) {
+		const uint32_t* top = &pixels[(y * 2) * width];
+		const uint32_t* bottom = top + width;
+		uint16_t x = 0;
+
+#ifdef VIDEO_CAPTURE_SSE2
+		const __m128i u_weights = _mm_setr_epi16(UWeights[0], UWeights[1], UWeights[2], 0, UWeights[0], UWeights[1], UWeights[2], 0);
+		const __m128i v_weights = _mm_setr_epi16(VWeights[0], VWeights[1], VWeights[2], 0, VWeights[0], VWeights[1], VWeights[2], 0);
+
+		for(; x + 8 <= chroma_width; x += 8) {
+			const __m128i average_a = Average2x2(&top[x * 2], &bottom[x * 2]);
+			const __m128i average_b = Average2x2(&top[x * 2 + 8], &bottom[x * 2 + 8]);
+
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(&chroma_u[y * chroma_width + x]), ScaleAndPack(WeightedSum(average_a, u_weights), WeightedSum(average_b, u_weights), 128));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(&chroma_v[y * chroma_width + x]), ScaleAndPack(WeightedSum(average_a, v_weights), WeightedSum(average_b, v_weights), 128));
+		}
+#endif
+
+		for(; x < chroma_width; x++) {
+			const uint32_t average = AveragePixels(AveragePixels(top[x * 2], bottom[x * 2]), AveragePixels(top[x * 2 + 1], bottom[x * 2 + 1]));
+
+			chroma_u[y * chroma_width + x] = WeightedPixel(average, UWeights, 128);
+			chroma_v[y * chroma_width + x] = WeightedPixel(average, VWeights, 128);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __VIDEO_CAPTURE_HPP__
+#define __VIDEO_CAPTURE_HPP__
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Records PPU frames as a YUV4MPEG2 (Y4M) stream, for recording runs without a display.
+ *
+ * Frames are converted to YUV 4:2:0 on the emulation thread (with SSE2 where available) into a bounded queue, and a writer
+ * thread takes them from there to the file. When the writer falls behind and the queue is full, frames are dropped and counted
+ * rather than holding up emulation.
+ *
+ * The output can be a file, a named pipe, or a command to pipe into when the name starts with '|', for example "|ffmpeg -i - out.mp4".
+ */
+class VideoCapture {
+
+	public:
+		VideoCapture();
+		~VideoCapture();
+
+		/* Open output and start the writer thread. Returns false if output couldn't be opened. */
+		bool Open(const std::string& output, uint16_t width, uint16_t height);
+
+		/* Write out everything still queued, stop the writer thread and close the output. */
+		void Close();
+
+		/* Queue a frame of ARGB8888 pixels, width * height. Never blocks on the writer. */
+		void SubmitFrame(const uint32_t* pixels);
+
+		uint64_t GetFramesWritten() { return frames_written; };
+		uint64_t GetFramesDropped() { return frames_dropped; };
+
+		/* Frames waiting for the writer now, and the most there have been. */
+		size_t GetQueueDepth();
+		size_t GetMaxQueueDepth() { return max_queue_depth; };
+		size_t GetQueueCapacity() { return QueueCapacity; };
+
+		/* Frames the queue holds before dropping, about a quarter of a second. */
+		static const size_t QueueCapacity { 16 };
+
+	private:
+		void WriterLoop();
+
+		/* Convert a frame to planar Y, then U and V at half size in each direction. */
+		void ConvertFrame(const uint32_t* pixels, uint8_t* yuv);
+
+		std::FILE* file { nullptr };
+		bool is_pipe { false };
+
+		uint16_t width { 0 };
+		uint16_t height { 0 };
+
+		std::thread writer_thread;
+
+		/* Ring of converted frames, queue_count of them waiting from queue_head on. */
+		std::vector<std::vector<uint8_t>> queue;
+		size_t queue_head { 0 };
+		size_t queue_count { 0 };
+
+		std::mutex mutex;
+		std::condition_variable frame_ready;
+		bool closing { false };
+
+		/* Set by the writer when output stops taking data, after which frames are dropped. */
+		std::atomic<bool> write_failed { false };
+
+		std::atomic<uint64_t> frames_written { 0 };
+		uint64_t frames_dropped { 0 };
+		size_t max_queue_depth { 0 };
+};
+
+#endif /* __VIDEO_CAPTURE_HPP__ */
\ No newline at end of file
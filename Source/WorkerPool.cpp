@@ -0,0 +1,129 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+
+#include "WorkerPool.hpp"
+
+WorkerPool::WorkerPool(unsigned thread_count) {
+
+	if(thread_count == 0) {
+		thread_count = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	/* The thread calling Run() works too. */
+	for(unsigned i = 1; i < thread_count; i++) {
+		threads.emplace_back(&WorkerPool::WorkerLoop, this);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shutting_down = true;
+	}
+
+	work_ready.notify_all();
+
+	for(std::thread& thread : threads) {
+		thread.join();
+	}
+}
+
+void WorkerPool::Run(size_t job_count, const std::function<void(size_t)>& job) {
+
+	if(job_count == 0) {
+		return;
+	}
+
+	/* Not worth waking anyone for a single job. */
+	if(threads.empty() || job_count == 1) {
+		for(size_t i = 0; i < job_count; i++) {
+			job(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		batch_job = &job;
+		batch_size = job_count;
+		next_job = 0;
+		jobs_finished = 0;
+		batch_number++;
+	}
+
+	work_ready.notify_all();
+
+	RunJobs();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	work_done.wait(lock, [this] { return jobs_finished == batch_size; });
+
+	batch_job = nullptr;
+}
+
+void WorkerPool::WorkerLoop() {
+
+	uint64_t last_batch = 0;
+
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			work_ready.wait(lock, [&] { return shutting_down || (batch_job != nullptr && batch_number != last_batch); });
+
+			if(shutting_down) {
+				return;
+			}
+
+			last_batch = batch_number;
+		}
+
+		RunJobs();
+	}
+}
+
+void WorkerPool::RunJobs() {
+
+	while(true) {
+		size_t index;
+		const std::function<void(size_t)>* job;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			if(batch_job == nullptr || next_job >= batch_size) {
+				return;
+			}
+
+			index = next_job++;
+			job = batch_job;
+		}
+
+		(*job)(index);
+
+		std::lock_guard<std::mutex> lock(mutex);
+
+		if(++jobs_finished == batch_size) {
+			work_done.notify_one();
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+/**
+ * Copyright (C) 2023 by Matthew Edgmon
+ * matthewedgmon@gmail.com
+ *
+ * This file is part of mattNES.
+ *
+ * mattNES is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * mattNES is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with mattNES.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __WORKER_POOL_HPP__
+#define __WORKER_POOL_HPP__
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Small fixed pool of threads for splitting per-frame work (video filters) into independent jobs.
+ *
+ * Run() hands out job indexes to the workers and the calling thread, and returns once every job is done.
+ */
+class WorkerPool {
+
+	public:
+		/* Zero threads picks one per hardware thread, minus the calling thread. */
+		WorkerPool(unsigned thread_count = 0);
+		~WorkerPool();
+
+		/* Call job(0) to job(job_count - 1), spread across all threads. Jobs must not depend on each other. */
+		void Run(size_t job_count, const std::function<void(size_t)>& job);
+
+		/* Threads working on a Run(), including the calling thread. */
+		unsigned GetThreadCount() { return static_cast<unsigned>(threads.size()) + 1; };
+
+	private:
+		void WorkerLoop();
+
+		/* Take and run jobs from the current batch until none are left. */
+		void RunJobs();
+
+		std::vector<std::thread> threads;
+
+		std::mutex mutex;
+		std::condition_variable work_ready;
+		std::condition_variable work_done;
+
+		/* Current batch. batch_number changes every Run() so sleeping workers know there is new work. */
+		const std::function<void(size_t)>* batch_job { nullptr };
+		size_t batch_size { 0 };
+		size_t next_job { 0 };
+		size_t jobs_finished { 0 };
+		uint64_t batch_number { 0 };
+
+		bool shutting_down { false };
+};
+
+#endif /* __WORKER_POOL_HPP__ */
\ No newline at end of file